@@ -0,0 +1,36 @@
+/* Host benchmarks: shared helpers */
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "host_stub.h"
+
+#define BENCH_CHECK(cond, fmt, ...) do {                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: " fmt "\n", __FILE__, __LINE__, ##__VA_ARGS__); \
+            exit(1);                                                            \
+        }                                                                       \
+    } while (0)
+
+static inline void bench_title(const char *title)
+{
+    printf("\n== %s ==\n", title);
+}
+
+static inline void bench_report(const char *what, uint64_t ops, uint64_t cycles)
+{
+    printf("  %-44s %12.1f cycles/op  (%llu ops)\n", what, ops ? (double)cycles / ops : 0.0,
+           (unsigned long long)ops);
+}
+
+static inline void bench_report_value(const char *what, double value, const char *unit)
+{
+    printf("  %-44s %12.2f %s\n", what, value, unit);
+}
+
+/* Per-op cost of a stub counter since the last stub_reset_counters() */
+static inline double bench_per(stub_event_t event, uint64_t ops)
+{
+    return ops ? (double)stub_counter(event)->units / ops : 0.0;
+}
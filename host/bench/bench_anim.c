@@ -0,0 +1,291 @@
+/* Host benchmark: LED animation frame rendering
+ *
+ * Compares the brightness LUT and Q16 interpolation against the float and
+ * double math they replaced in app_driver.c, times one 25 fps frame of the
+ * original spinner and pulse against the effect engine, then reports the
+ * render cost of every registered effect as recorded by the player.
+ * Rendering only: the refresh that follows is measured by bench_ws2812.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <driver/rmt.h>
+#include <led_strip.h>
+#include <led_color.h>
+#include <led_effect.h>
+#include <esp_cpu.h>
+#include <esp_rmaker_core.h>
+#include "app_priv.h"
+#include "bench.h"
+
+#define FRAMES   20000
+#define FRAME_US (DEFAULT_REFRESH_ANIM_PERIOD_RGBPIXEL * 1000)
+
+static const uint32_t rgbpixel_spin_blue_bg = 0x0000FF;
+static const uint32_t rgbpixel_spin_blue_fg = 0x00FFFF;
+static const uint32_t rgbpixel_pulse_blue_min = 0x0000FF;
+static const uint32_t rgbpixel_pulse_blue_max = 0x00FFFF;
+static const uint32_t rgbpixel_pulse_red_min = 0x281100;
+static const uint32_t rgbpixel_pulse_red_max = 0xFF1100;
+static const uint32_t rgbpixel_pulse_green_min = 0x001100;
+static const uint32_t rgbpixel_pulse_green_max = 0x00FF00;
+
+/* The renderer formerly in app_driver.c, kept verbatim as reference */
+static led_strip_t *g_rgbpixel_strip;
+static uint8_t g_rgbpixel_strip_pixels = DEFAULT_RGBPIXEL_STRIP_PIXELS;
+static uint16_t g_rgbpixel_value = DEFAULT_RGBPIXEL_BRIGHTNESS;
+
+static esp_err_t ref_set_pixel(uint16_t n, uint32_t c)
+{
+	uint8_t r = (uint8_t)(c >> 16);
+	uint8_t g = (uint8_t)(c >> 8);
+	uint8_t b = (uint8_t)c;
+	r = r * g_rgbpixel_value * 0.01f;
+	g = g * g_rgbpixel_value * 0.01f;
+	b = b * g_rgbpixel_value * 0.01f;
+	g_rgbpixel_strip->set_pixel(g_rgbpixel_strip, n, r, g, b);
+    return ESP_OK;
+}
+
+static esp_err_t ref_anim_fill(uint32_t c)
+{
+	for (int i=0; i<g_rgbpixel_strip_pixels; i++) {
+		ref_set_pixel(i, c);
+	}
+	return ESP_OK;
+}
+
+static esp_err_t ref_anim_spinner(uint32_t cbg, uint32_t cfg, uint8_t pos)
+{
+	ref_anim_fill(cbg);
+	for (int i=pos; i<pos+2; i++) {
+		ref_set_pixel(i % g_rgbpixel_strip_pixels, cfg);
+	}
+    return ESP_OK;
+}
+
+static uint32_t ref_interpolate(uint32_t cmin, uint32_t cmax, double t)
+{
+	uint8_t r = (cmin >> 16 & 0xFF)*(1-t) + (cmax >> 16 & 0xFF)*t;
+	uint8_t g = (cmin >> 8  & 0xFF)*(1-t) + (cmax >> 8  & 0xFF)*t;
+	uint8_t b = (cmin       & 0xFF)*(1-t) + (cmax       & 0xFF)*t;
+	return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+static esp_err_t ref_anim_pulse(uint32_t cmin, uint32_t cmax, double ratio, bool up)
+{
+	double t = (up) ? ratio : 1 - ratio;
+	uint32_t c = ref_interpolate(cmin, cmax, t);
+	ref_anim_fill(c);
+    return ESP_OK;
+}
+
+static void check_scale(void)
+{
+    uint8_t lut[256];
+    for (uint32_t v = 0; v <= 100; v++) {
+        led_color_scale_lut(lut, v, false);
+        for (uint32_t x = 0; x < 256; x++) {
+            uint8_t r = x;
+            uint16_t value = v;
+            r = r * value * 0.01f;
+            BENCH_CHECK(lut[x] == r, "scale %u by %u%%: float %u, lut %u", x, v, r, lut[x]);
+        }
+    }
+    bench_report_value("brightness LUT, max error over 101 levels", 0, "LSB");
+}
+
+static int channel_error(uint32_t a, uint32_t b)
+{
+    int err = 0;
+    for (int shift = 0; shift <= 16; shift += 8) {
+        int d = (int)(a >> shift & 0xFF) - (int)(b >> shift & 0xFF);
+        d = d < 0 ? -d : d;
+        err = d > err ? d : err;
+    }
+    return err;
+}
+
+static void check_interpolate(void)
+{
+    const uint32_t pairs[][2] = {
+        { rgbpixel_pulse_blue_min, rgbpixel_pulse_blue_max },
+        { rgbpixel_pulse_red_min, rgbpixel_pulse_red_max },
+        { rgbpixel_pulse_green_min, rgbpixel_pulse_green_max },
+    };
+    int max_err = 0;
+    for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++) {
+        for (int counter = 0; counter <= 24; counter++) {
+            for (int up = 0; up <= 1; up++) {
+                double ratio = counter * 0.041;
+                uint32_t ref = ref_interpolate(pairs[p][0], pairs[p][1], up ? ratio : 1 - ratio);
+                uint32_t q16 = counter * 2687;
+                uint32_t c = led_color_lerp(pairs[p][0], pairs[p][1], up ? q16 : 65536 - q16);
+                int err = channel_error(ref, c);
+                max_err = err > max_err ? err : max_err;
+            }
+        }
+    }
+    BENCH_CHECK(max_err <= 1, "interpolation off by %d", max_err);
+    bench_report_value("Q16 pulse interpolation, max error", max_err, "LSB");
+}
+
+static led_strip_t *new_strip(rmt_channel_t channel, uint32_t pixels)
+{
+    led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(pixels, (led_strip_dev_t)channel);
+    led_strip_t *strip = led_strip_new_rmt_ws2812(&strip_config);
+    BENCH_CHECK(strip, "led_strip_new_rmt_ws2812 failed");
+    return strip;
+}
+
+static uint8_t s_scale[256];
+
+static void bench_frames(rmt_channel_t channel)
+{
+    led_effect_player_t player = {
+        .strip = new_strip(channel, g_rgbpixel_strip_pixels),
+        .num_pixels = g_rgbpixel_strip_pixels,
+        .scale = s_scale,
+    };
+    const led_effect_params_t spin = { rgbpixel_spin_blue_bg, rgbpixel_spin_blue_fg, 1000 };
+    const led_effect_params_t pulse = { rgbpixel_pulse_red_min, rgbpixel_pulse_red_max, 2000 };
+
+    uint64_t start = stub_cycles();
+    for (int i = 0; i < FRAMES; i++) {
+        ref_anim_spinner(rgbpixel_spin_blue_bg, rgbpixel_spin_blue_fg, i % 25);
+    }
+    uint64_t ref_spin = stub_cycles() - start;
+
+    led_effect_start(&player, LED_EFFECT_SPINNER, &spin, 0);
+    start = stub_cycles();
+    for (int i = 0; i < FRAMES; i++) {
+        led_effect_render(&player, (int64_t)i * FRAME_US);
+    }
+    uint64_t lut_spin = stub_cycles() - start;
+
+    start = stub_cycles();
+    for (int i = 0; i < FRAMES; i++) {
+        ref_anim_pulse(rgbpixel_pulse_red_min, rgbpixel_pulse_red_max, (i % 25) * 0.041, (i / 25) & 1);
+    }
+    uint64_t ref_pulse = stub_cycles() - start;
+
+    led_effect_start(&player, LED_EFFECT_PULSE, &pulse, 0);
+    start = stub_cycles();
+    for (int i = 0; i < FRAMES; i++) {
+        led_effect_render(&player, (int64_t)i * FRAME_US);
+    }
+    uint64_t lut_pulse = stub_cycles() - start;
+
+    // The player reads the cycle counter twice per frame: one instruction on target, far more on a host
+    static volatile uint32_t sink;
+    start = stub_cycles();
+    for (int i = 0; i < FRAMES; i++) {
+        uint32_t c0 = esp_cpu_get_ccount();
+        sink += esp_cpu_get_ccount() - c0;
+    }
+    uint64_t probe = stub_cycles() - start;
+    lut_spin = lut_spin > probe ? lut_spin - probe : 0;
+    lut_pulse = lut_pulse > probe ? lut_pulse - probe : 0;
+
+    bench_report("cycle counter reads (excluded below)", FRAMES, probe);
+    bench_report("spinner: float per pixel", FRAMES, ref_spin);
+    bench_report("spinner: effect engine", FRAMES, lut_spin);
+    bench_report_value("speedup", (double)ref_spin / lut_spin, "x");
+    bench_report("pulse: double lerp + float per pixel", FRAMES, ref_pulse);
+    bench_report("pulse: effect engine", FRAMES, lut_pulse);
+    bench_report_value("speedup", (double)ref_pulse / lut_pulse, "x");
+    player.strip->del(player.strip);
+}
+
+/* Render cost of every registered effect, from the player's own statistics */
+static void bench_effects(rmt_channel_t channel, uint32_t pixels)
+{
+    led_effect_player_t player = {
+        .strip = new_strip(channel, pixels),
+        .num_pixels = pixels,
+        .scale = s_scale,
+    };
+    const led_effect_params_t params = { 0x0000FF, 0x00FFFF, 1000 };
+    for (led_effect_id_t id = 0; id < LED_EFFECT_MAX; id++) {
+        BENCH_CHECK(led_effect_start(&player, id, &params, 0) == ESP_OK, "start %s failed", led_effect_name(id));
+        for (int i = 0; i < FRAMES / 10; i++) {
+            led_effect_render(&player, (int64_t)i * FRAME_US);
+        }
+        char what[64];
+        snprintf(what, sizeof(what), "%u px: %s", pixels, led_effect_name(id));
+        bench_report(what, player.stats[id].frames, player.stats[id].cycles);
+    }
+    player.strip->del(player.strip);
+}
+
+/* Cached replay against live rendering: same frames, cost per frame and memory */
+static void bench_cache(rmt_channel_t channel, uint32_t pixels, uint32_t budget)
+{
+    static uint8_t cache[32768];
+    uint8_t *live_frame = malloc(pixels * 3);
+    uint8_t *cached_frame = malloc(pixels * 3);
+    led_effect_player_t live = {
+        .strip = new_strip(channel, pixels),
+        .num_pixels = pixels,
+        .scale = s_scale,
+    };
+    led_effect_player_t cached = live;
+    cached.cache = cache;
+    cached.cache_size = budget;
+    cached.frame_us = FRAME_US;
+
+    const led_effect_params_t params = { 0x0000FF, 0x00FFFF, 1000 };
+    for (led_effect_id_t id = 0; id < LED_EFFECT_MAX; id++) {
+        led_effect_start(&live, id, &params, 0);
+        led_effect_start(&cached, id, &params, 0);
+        for (int i = 0; i < FRAMES / 10; i++) {
+            int64_t now_us = (int64_t)i * FRAME_US;
+            led_effect_render(&live, now_us);
+            live.strip->read(live.strip, 0, live_frame, pixels);
+            led_effect_render(&cached, now_us);
+            cached.strip->read(cached.strip, 0, cached_frame, pixels);
+            BENCH_CHECK(memcmp(live_frame, cached_frame, pixels * 3) == 0, "%s frame %d differs", led_effect_name(id), i);
+        }
+        const led_effect_stats_t *ls = &live.stats[id];
+        const led_effect_stats_t *cs = &cached.stats[id];
+        char what[64];
+        snprintf(what, sizeof(what), "%u px %s: live", pixels, led_effect_name(id));
+        bench_report(what, ls->frames, ls->cycles);
+        if (cached.cache_over_budget) {
+            bench_report_value("  over budget, rendered live", cached.cache_size, "bytes");
+            continue;
+        }
+        snprintf(what, sizeof(what), "%u px %s: cached", pixels, led_effect_name(id));
+        bench_report(what, cs->frames, cs->cycles);
+        bench_report_value("  cache used", cached.cache_used, "bytes");
+        bench_report_value("  first frame, cache build", cs->max_cycles, "cycles");
+    }
+    free(live_frame);
+    free(cached_frame);
+    live.strip->del(live.strip);
+}
+
+int main(void)
+{
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(18, RMT_CHANNEL_1);
+    config.clk_div = 2;
+    ESP_ERROR_CHECK(rmt_config(&config));
+    ESP_ERROR_CHECK(rmt_driver_install(config.channel, 0, 0));
+    g_rgbpixel_strip = new_strip(config.channel, g_rgbpixel_strip_pixels);
+    led_color_scale_lut(s_scale, g_rgbpixel_value, false);
+
+    bench_title("Animation color math");
+    check_scale();
+    check_interpolate();
+
+    bench_title("Animation frame render (24 px)");
+    bench_frames(config.channel);
+
+    bench_title("Effect render cost per frame");
+    bench_effects(config.channel, 24);
+    bench_effects(config.channel, 300);
+
+    bench_title("Frame cache, 2048 byte budget");
+    bench_cache(config.channel, 24, 2048);
+    bench_cache(config.channel, 300, 2048);
+    return 0;
+}
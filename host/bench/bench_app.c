@@ -0,0 +1,688 @@
+/* Host benchmark: whole application on the stub layer
+ *
+ * Runs app_main() against simulated sensors and reports the cost of the
+ * three hot paths: a RainMaker command through write_cb, one LED animation
+ * frame and one sensor sample, switches the SHT31 repeatability, steps the
+ * BH1750 through its ranges, counts the reports published on change,
+ * samples both sensors alternately, runs the sensor scheduler through
+ * an hour and a bus outage, follows light switches and an opened window
+ * with adaptive sampling, then logs the samples to flash through an MQTT
+ * outage and uploads them once it is back.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <esp_log.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_params.h>
+#include <esp_rmaker_standard_types.h>
+#include <bh1750.h>
+#include <sht3x.h>
+#include <sensor_sched.h>
+#include "app_priv.h"
+#include "bench.h"
+
+#define COMMANDS 2000
+#define FRAMES   2000
+#define SAMPLES  200
+#define GAP_US   40000  /* virtual time between commands and frames, the ISR catches up meanwhile */
+#define SAMPLE_GAP_US 2100000  /* between sensor samples, longer than the SHT31 measurement period */
+#define LOG_FILE "bench_app_log.bin"
+#define FIXED_PERIOD_BH1750 60   /* seconds, the sampling periods before they adapted */
+#define FIXED_PERIOD_SHT31  305
+#define SWITCHES 20
+
+void app_main(void);
+
+static void settle(void);
+
+static void bench_command(const char *device, const char *param, int modulo)
+{
+    char what[64];
+    snprintf(what, sizeof(what), "%s / %s%s", device, param, modulo == 1 ? " (repeated)" : "");
+
+    stub_reset_counters();
+    uint64_t blocked_us = 0;
+    uint64_t cycles = 0;
+    for (int i = 0; i < COMMANDS; i++) {
+        esp_rmaker_param_val_t val = esp_rmaker_int(i % modulo);
+        uint64_t start_us = stub_now_us();
+        uint64_t start = stub_cycles();
+        BENCH_CHECK(stub_rmaker_write(device, param, val) == ESP_OK, "write %s failed", what);
+        cycles += stub_cycles() - start;
+        blocked_us += stub_now_us() - start_us;
+        settle();
+        stub_block_us(GAP_US);
+    }
+    bench_report(what, COMMANDS, cycles);
+    bench_report_value("  caller blocked per command", (double)blocked_us / COMMANDS, "us");
+    bench_report_value("  LED frames sent per command", (double)stub_counter(STUB_EV_RMT_WRITE)->count / COMMANDS, "");
+    bench_report_value("  RainMaker publishes per command",
+                       (double)stub_counter(STUB_EV_RMAKER_PUBLISH)->count / COMMANDS, "");
+    bench_report_value("  params per publish", (double)stub_counter(STUB_EV_RMAKER_PARAM)->units /
+                       stub_counter(STUB_EV_RMAKER_PUBLISH)->count, "");
+}
+
+/* Run the I2C bus task until its queue is empty, then the scheduler task on the samples it completed:
+ * virtual time and host cycles they took */
+static uint64_t s_bus_us;
+static uint64_t s_bus_cycles;
+static uint64_t s_done_cycles;
+
+static void pump_bus(void)
+{
+    uint64_t start_us = stub_now_us();
+    uint64_t start = stub_cycles();
+    while (i2cdev_bus_step(I2C_NUM_0)) {
+    }
+    s_bus_cycles += stub_cycles() - start;
+    s_bus_us += stub_now_us() - start_us;
+    start = stub_cycles();
+    sensor_sched_process();
+    s_done_cycles += stub_cycles() - start;
+}
+
+/* Run the bus, the sensor fetch timers, the report flush and the sensor log task until nothing is pending */
+static esp_timer_handle_t s_fetch_timers[3];
+
+static sensor_sched_entry_t *s_log_entry;
+
+static void settle(void)
+{
+    pump_bus();
+    // Hand-run samples come faster than the scheduler flushes the log: flush for it
+    const sensor_log_t *log = app_driver_sensor_get_log();
+    if (log && log->queue_len >= SENSOR_LOG_QUEUE_LEN / 2) {
+        s_log_entry->sample(s_log_entry);
+    }
+    app_driver_sensor_log_step();
+    while (1) {
+        esp_timer_handle_t next = NULL;
+        for (int i = 0; i < 3; i++) {
+            if (esp_timer_is_active(s_fetch_timers[i]) &&
+                (!next || stub_esp_timer_alarm(s_fetch_timers[i]) < stub_esp_timer_alarm(next))) {
+                next = s_fetch_timers[i];
+            }
+        }
+        if (!next) {
+            break;
+        }
+        uint64_t alarm_us = stub_esp_timer_alarm(next);
+        if (alarm_us > stub_now_us()) {
+            stub_block_us(alarm_us - stub_now_us());
+        }
+        stub_esp_timer_fire(next);
+        pump_bus();
+    }
+}
+
+/* Run one sample of a sensor, as the scheduler task would */
+static void sample_sensor(sensor_sched_entry_t *entry)
+{
+    entry->sample(entry);
+}
+
+/* An esp_timer callback or a sensor sample, by timer or sensor name */
+static void bench_timer(const char *title, const char *name, int runs, uint64_t gap_us)
+{
+    esp_timer_handle_t timer = stub_esp_timer_find(name);
+    sensor_sched_entry_t *entry = timer ? NULL : sensor_sched_find(name);
+    BENCH_CHECK(timer || entry, "timer or sensor %s not found", name);
+
+    stub_reset_counters();
+    stub_esp_timer_reset_stats();
+    s_bus_us = s_bus_cycles = s_done_cycles = 0;
+    uint64_t sample_us = 0;
+    uint64_t cycles = 0;
+    for (int i = 0; i < runs; i++) {
+        uint64_t start_us = stub_now_us();
+        uint64_t start = stub_cycles();
+        if (timer) {
+            stub_esp_timer_fire(timer);
+        } else {
+            sample_sensor(entry);
+        }
+        cycles += stub_cycles() - start;
+        settle();
+        sample_us += stub_now_us() - start_us;
+        stub_block_us(gap_us);
+    }
+    uint64_t xfers = stub_counter(STUB_EV_I2C_XFER)->count;
+    uint64_t frames = stub_counter(STUB_EV_RMT_WRITE)->count;
+
+    bench_title(title);
+    bench_report(timer ? "timer callback" : "scheduler sample callback", runs, cycles);
+    if (timer) {
+        bench_report_value("timer task occupied per run", bench_per(STUB_EV_TIMER_CB, runs), "us");
+    } else {
+        bench_report_value("fetch timer callbacks occupied per run", bench_per(STUB_EV_TIMER_CB, runs), "us");
+    }
+    if (frames) {
+        bench_report("  RMT translation (ISR) per frame", frames, stub_counter(STUB_EV_RMT_TRANSLATE)->cycles);
+        bench_report_value("  wire time per frame", bench_per(STUB_EV_RMT_WIRE, frames), "us");
+    }
+    if (xfers) {
+        bench_report_value("bus task occupied per run", (double)s_bus_us / runs, "us");
+        bench_report_value("sample end to end", (double)sample_us / runs, "us");
+        bench_report("  per I2C transaction", xfers, cycles + s_bus_cycles + s_done_cycles);
+        bench_report("  scheduler task processing per run", runs, s_done_cycles);
+        bench_report_value("  I2C transactions per run", (double)xfers / runs, "");
+        bench_report_value("  heap allocations per I2C transaction",
+                           (double)stub_counter(STUB_EV_HEAP_ALLOC)->count / xfers, "");
+        bench_report_value("  I2C bus time per run", bench_per(STUB_EV_I2C_BUS, runs), "us");
+        bench_report_value("  driver reinstalls per run", (double)stub_counter(STUB_EV_I2C_INSTALL)->count / runs, "");
+        bench_report_value("  mutexes created per run", (double)stub_counter(STUB_EV_MUTEX_CREATE)->count / runs, "");
+        bench_report_value("  RainMaker publishes per run",
+                           (double)stub_counter(STUB_EV_RMAKER_PUBLISH)->count / runs, "");
+    }
+}
+
+/* Switch the free running SHT31 to each repeatability and sample it */
+static void bench_repeatability(void)
+{
+    static const char *names[] = { "high", "medium", "low" };
+    sensor_sched_entry_t *sht31 = sensor_sched_find("sht31");
+
+    bench_title("SHT31 repeatability switch");
+    for (int repeat = SHT3X_LOW; repeat >= SHT3X_HIGH; repeat--) {
+        i2cdev_stats_t before, after;
+        i2cdev_get_stats(I2C_NUM_0, &before);
+        stub_reset_counters();
+        uint64_t start_us = stub_now_us();
+        BENCH_CHECK(app_driver_sensor_set_sht31_repeatability(repeat) == ESP_OK, "switch failed");
+        BENCH_CHECK(stub_now_us() == start_us, "the caller blocked");
+        // The next scheduler step switches instead of sampling
+        uint32_t samples = app_driver_sensor_get_report("temperature")->sent +
+                           app_driver_sensor_get_report("temperature")->suppressed;
+        start_us = stub_now_us();
+        sample_sensor(sht31);
+        uint64_t blocked_us = stub_now_us() - start_us;
+        settle();
+        BENCH_CHECK(app_driver_sensor_get_report("temperature")->sent +
+                    app_driver_sensor_get_report("temperature")->suppressed == samples, "sampled while switching");
+        // Sampled right away, the first periodic result is fetched once it is out a period later
+        uint32_t failures = sht31->stats.failures;
+        start_us = stub_now_us();
+        sample_sensor(sht31);
+        settle();
+        uint64_t ready_us = stub_now_us() - start_us;
+        i2cdev_get_stats(I2C_NUM_0, &after);
+        BENCH_CHECK(after.errors == before.errors && sht31->stats.failures == failures,
+                    "sample after switching to %s failed", names[repeat]);
+        BENCH_CHECK(app_driver_sensor_get_report("temperature")->sent +
+                    app_driver_sensor_get_report("temperature")->suppressed == samples + 1, "no sample after switching");
+
+        char what[64];
+        snprintf(what, sizeof(what), "to %s: scheduler step blocked", names[repeat]);
+        bench_report_value(what, blocked_us, "us");
+        snprintf(what, sizeof(what), "to %s: first sample ready after", names[repeat]);
+        bench_report_value(what, ready_us, "us");
+        stub_block_us(SAMPLE_GAP_US);
+    }
+}
+
+/* Step the light from darkness to daylight and back, the range follows */
+static void bench_autorange(void)
+{
+    static const float levels[] = { 0.4f, 3.0f, 40.0f, 250.0f, 1500.0f, 20000.0f, 100000.0f, 250.0f, 0.4f };
+    sensor_sched_entry_t *bh1750 = sensor_sched_find("bh1750");
+    esp_rmaker_param_t *param = esp_rmaker_device_get_param_by_name(luminosity_sensor, "luminosity");
+
+    bench_title("BH1750 auto-ranging, one time mode");
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        sim_bh1750_set_lux(levels[i]);
+        // Three samples: out of range, re-ranged, settled
+        uint64_t sample_us = 0;
+        for (int n = 0; n < 3; n++) {
+            uint64_t start_us = stub_now_us();
+            sample_sensor(bh1750);
+            settle();
+            sample_us = stub_now_us() - start_us;
+            BENCH_CHECK(!sim_bh1750_powered(), "BH1750 left powered on between samples");
+            stub_block_us(SAMPLE_GAP_US);
+        }
+        float lux = esp_rmaker_param_get_val(param)->val.f;
+        // Within 5 % or one count at the finest resolution (0.11 lx)
+        float tolerance = levels[i] * 0.05f > 0.12f ? levels[i] * 0.05f : 0.12f;
+        BENCH_CHECK(fabsf(lux - levels[i]) <= tolerance, "%.2f lx reported as %.2f lx", levels[i], lux);
+
+        char what[64];
+        snprintf(what, sizeof(what), "%g lx: reported, sample end to end", levels[i]);
+        printf("  %-44s %12.2f lx %9.1f ms\n", what, lux, sample_us / 1000.0);
+    }
+}
+
+/* An hour of samples every 2.1 s with slowly drifting, slightly noisy values */
+static void bench_report_on_change(void)
+{
+    static const char *params[] = { "temperature", "humidity", "luminosity" };
+    sensor_sched_entry_t *bh1750 = sensor_sched_find("bh1750");
+    sensor_sched_entry_t *sht31 = sensor_sched_find("sht31");
+    sensor_report_t before[3];
+    for (int i = 0; i < 3; i++) {
+        before[i] = *app_driver_sensor_get_report(params[i]);
+    }
+
+    int runs = 3600000000ULL / SAMPLE_GAP_US;
+    uint32_t x = 12345;
+    uint64_t max_silent_us = 0;
+    stub_reset_counters();
+    for (int i = 0; i < runs; i++) {
+        double phase = 2 * M_PI * i / runs;
+        x = x * 1103515245 + 12345;
+        double noise = ((int)((x >> 16) % 101) - 50) / 1000.0;  // +-0.05
+        sim_sht3x_set(20.0 + 1.5 * sin(phase) + noise, 50.0 + 5.0 * sin(phase) + noise);
+        sim_bh1750_set_lux(250.0 * (1.0 + 0.3 * sin(phase) + noise));
+        sample_sensor(bh1750);
+        settle();
+        sample_sensor(sht31);
+        settle();
+        for (int p = 0; p < 3; p++) {
+            uint64_t silent_us = stub_now_us() - app_driver_sensor_get_report(params[p])->last_us;
+            max_silent_us = silent_us > max_silent_us ? silent_us : max_silent_us;
+        }
+        stub_block_us(SAMPLE_GAP_US);
+    }
+
+    bench_title("Report on change, one hour at 2.1 s");
+    uint32_t sent = 0, suppressed = 0;
+    for (int p = 0; p < 3; p++) {
+        const sensor_report_t *report = app_driver_sensor_get_report(params[p]);
+        char what[64];
+        snprintf(what, sizeof(what), "%s: sent, suppressed", params[p]);
+        printf("  %-44s %12u %u\n", what, report->sent - before[p].sent, report->suppressed - before[p].suppressed);
+        sent += report->sent - before[p].sent;
+        suppressed += report->suppressed - before[p].suppressed;
+    }
+    BENCH_CHECK(sent == stub_counter(STUB_EV_RMAKER_PARAM)->units, "%u reports sent, %llu params published", sent,
+                (unsigned long long)stub_counter(STUB_EV_RMAKER_PARAM)->units);
+    BENCH_CHECK(max_silent_us <= (DEFAULT_REPORT_MAX_SILENT_INTERVAL + 3) * 1000000ULL, "silent for %llu us",
+                (unsigned long long)max_silent_us);
+    bench_report_value("RainMaker publishes per sample",
+                       (double)stub_counter(STUB_EV_RMAKER_PUBLISH)->count / runs, "");
+    bench_report_value("  one per param, without report on change", 3, "");
+    bench_report_value("  params per publish", (double)sent / stub_counter(STUB_EV_RMAKER_PUBLISH)->count, "");
+    bench_report_value("longest silence", max_silent_us / 1e6, "s");
+
+    // History buckets follow the wall clock
+    const sensor_history_t *history = app_driver_sensor_get_history("temperature");
+    const sensor_history_bucket_t *minute = sensor_history_get(history, SENSOR_HISTORY_MINUTE, 0);
+    const sensor_history_bucket_t *hour = sensor_history_get(history, SENSOR_HISTORY_HOUR, 0);
+    time_t now = time(NULL);
+    BENCH_CHECK(minute && minute->start_s == now - now % 60 && hour && hour->start_s == now - now % 3600,
+                "history buckets at %u and %u, time %lld", minute ? minute->start_s : 0, hour ? hour->start_s : 0,
+                (long long)now);
+}
+
+/* BH1750 (400 kHz) and SHT31 (1 MHz) share port 0 */
+static void bench_alternate(int runs)
+{
+    sensor_sched_entry_t *bh1750 = sensor_sched_find("bh1750");
+    sensor_sched_entry_t *sht31 = sensor_sched_find("sht31");
+    i2cdev_stats_t before, after;
+
+    stub_reset_counters();
+    i2cdev_get_stats(I2C_NUM_0, &before);
+    for (int i = 0; i < runs; i++) {
+        sample_sensor(bh1750);
+        settle();
+        stub_block_us(SAMPLE_GAP_US / 2);
+        sample_sensor(sht31);
+        settle();
+        stub_block_us(SAMPLE_GAP_US / 2);
+    }
+    i2cdev_get_stats(I2C_NUM_0, &after);
+
+    bench_title("BH1750 and SHT31 alternating");
+    bench_report_value("I2C transactions per pair", (double)(after.transactions - before.transactions) / runs, "");
+    BENCH_CHECK(after.transactions - before.transactions == stub_counter(STUB_EV_I2C_XFER)->count,
+                "i2cdev counted %u transactions, the bus %llu", after.transactions - before.transactions,
+                (unsigned long long)stub_counter(STUB_EV_I2C_XFER)->count);
+    bench_report_value("driver reinstalls per pair", (double)stub_counter(STUB_EV_I2C_INSTALL)->count / runs, "");
+    BENCH_CHECK(stub_counter(STUB_EV_I2C_PARAM_CONFIG)->count == 0, "%llu i2c_param_config calls on an installed driver",
+                (unsigned long long)stub_counter(STUB_EV_I2C_PARAM_CONFIG)->count);
+    bench_report_value("clock retunes per pair", (double)(after.retunes - before.retunes) / runs, "");
+    bench_report_value("I2C bus time per pair", bench_per(STUB_EV_I2C_BUS, runs), "us");
+}
+
+/* The scheduler task loop: step, let the bus and fetch timers run, sleep whole ticks */
+static void run_scheduler(uint64_t duration_us, int *together)
+{
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+    sensor_sched_entry_t *bh1750 = sensor_sched_find("bh1750");
+    sensor_sched_entry_t *sht31 = sensor_sched_find("sht31");
+    uint64_t end_us = stub_now_us() + duration_us;
+    while (stub_now_us() < end_us) {
+        uint32_t samples = bh1750->stats.samples + sht31->stats.samples;
+        uint32_t bh1750_samples = bh1750->stats.samples;
+        uint64_t woke_us = stub_now_us();
+        uint64_t notified = stub_counter(STUB_EV_TASK_NOTIFY)->count;
+        int64_t wait_us = sensor_sched_step();
+        if (together && bh1750->stats.samples != bh1750_samples &&
+            bh1750->stats.samples + sht31->stats.samples - samples == 2) {
+            (*together)++;
+        }
+        // Bus and fetch timers run on their own tasks meanwhile
+        settle();
+        // A shorter period woke the task
+        if (stub_counter(STUB_EV_TASK_NOTIFY)->count != notified) {
+            continue;
+        }
+        TickType_t ticks = (wait_us + tick_us - 1) / tick_us;
+        uint64_t wake_us = woke_us + (ticks ? ticks : 1) * tick_us;
+        if (wake_us > stub_now_us()) {
+            stub_block_us(wake_us - stub_now_us());
+        }
+    }
+}
+
+/* An hour of the scheduler task, then a bus outage and its recovery */
+static void bench_scheduler(void)
+{
+    sensor_sched_entry_t *entries[] = { sensor_sched_find("bh1750"), sensor_sched_find("sht31") };
+    esp_log_level_t level = stub_log_level;
+
+    // The benches above sampled by hand for a while: drop the deadlines missed meanwhile, let the periods settle
+    stub_log_level = ESP_LOG_NONE;
+    run_scheduler(2 * DEFAULT_SAMPLING_MAX_PERIOD_SHT31 * 1000000ULL, NULL);
+    stub_log_level = level;
+    for (int i = 0; i < 2; i++) {
+        BENCH_CHECK(entries[i], "sensor not scheduled");
+        memset(&entries[i]->stats, 0, sizeof(entries[i]->stats));
+    }
+    BENCH_CHECK(entries[0]->period_ms == DEFAULT_SAMPLING_MAX_PERIOD_BH1750 * 1000U &&
+                entries[1]->period_ms == DEFAULT_SAMPLING_MAX_PERIOD_SHT31 * 1000U,
+                "still values sampled every %u and %u ms", entries[0]->period_ms, entries[1]->period_ms);
+
+    bench_title("Sensor scheduler, one hour");
+    int together = 0;
+    stub_reset_counters();
+    run_scheduler(3600ULL * 1000000, &together);
+    for (int i = 0; i < 2; i++) {
+        const sensor_sched_stats_t *stats = &entries[i]->stats;
+        uint32_t expected = 3600000 / entries[i]->period_ms;
+        BENCH_CHECK(stats->samples >= expected && stats->samples <= expected + 1, "%s: %u samples, %u expected",
+                    entries[i]->name, stats->samples, expected);
+        BENCH_CHECK(!stats->failures && !stats->skipped, "%s: %u failed, %u skipped", entries[i]->name,
+                    stats->failures, stats->skipped);
+        char what[64];
+        snprintf(what, sizeof(what), "%s: samples", entries[i]->name);
+        bench_report_value(what, stats->samples, "");
+        snprintf(what, sizeof(what), "%s: worst lateness", entries[i]->name);
+        bench_report_value(what, stats->max_late_us, "us");
+    }
+    BENCH_CHECK(!together, "sensors sampled together %d times", together);
+    bench_report_value("steps sampling both sensors", together, "");
+    bench_report_value("timer task occupied per hour", bench_per(STUB_EV_TIMER_CB, 1), "us");
+
+    bench_title("Sensor scheduler, 1 h bus outage");
+    stub_log_level = ESP_LOG_NONE;
+    stub_i2c_detach_all();
+    run_scheduler(3600ULL * 1000000, NULL);  // a few samples even at the longest period
+    for (int i = 0; i < 2; i++) {
+        char what[64];
+        snprintf(what, sizeof(what), "%s: failed samples, backoffs", entries[i]->name);
+        printf("  %-44s %12u %u\n", what, entries[i]->stats.failures, entries[i]->stats.backoffs);
+        BENCH_CHECK(entries[i]->stats.backoffs, "%s never backed off", entries[i]->name);
+    }
+    BENCH_CHECK(entries[0]->backoff == SENSOR_SCHED_MAX_BACKOFF, "bh1750 backoff %u", entries[0]->backoff);
+    sim_sht3x_attach(I2C_NUM_0, SHT3X_I2C_ADDR_GND);
+    sim_bh1750_attach(I2C_NUM_0, BH1750_ADDR_LO);
+    stub_log_level = level;
+    // The longest backed off period is 8 x the longest sampling period
+    run_scheduler(2 * 8 * DEFAULT_SAMPLING_MAX_PERIOD_SHT31 * 1000000ULL, NULL);
+    for (int i = 0; i < 2; i++) {
+        BENCH_CHECK(entries[i]->backoff == 1, "%s did not recover", entries[i]->name);
+    }
+    bench_report_value("sensors back at their periods", 2, "");
+}
+
+/* Run the scheduler in one second steps until check() holds: how long it took */
+static uint64_t run_until(bool (*check)(void), uint64_t limit_us)
+{
+    uint64_t start_us = stub_now_us();
+    while (!check() && stub_now_us() - start_us < limit_us) {
+        run_scheduler(1000000, NULL);
+    }
+    BENCH_CHECK(check(), "not published within %llu s", (unsigned long long)(limit_us / 1000000));
+    return stub_now_us() - start_us;
+}
+
+static float s_want;
+
+static bool luminosity_published(void)
+{
+    esp_rmaker_param_t *param = esp_rmaker_device_get_param_by_name(luminosity_sensor, "luminosity");
+    return fabsf(esp_rmaker_param_get_val(param)->val.f - s_want) <= s_want * 0.05f;
+}
+
+static bool temperature_published(void)
+{
+    esp_rmaker_param_t *param = esp_rmaker_device_get_param_by_type(temperature_sensor, ESP_RMAKER_PARAM_TEMPERATURE);
+    return fabsf(esp_rmaker_param_get_val(param)->val.f - s_want) <= 0.2f;
+}
+
+/* Lights switched at random times, then a window opened: the sampling speeds up and backs off */
+static void bench_adaptive(void)
+{
+    sensor_sched_entry_t *bh1750 = sensor_sched_find("bh1750");
+    sensor_sched_entry_t *sht31 = sensor_sched_find("sht31");
+    esp_log_level_t level = stub_log_level;
+    stub_log_level = ESP_LOG_NONE;
+
+    bench_title("Adaptive sampling, still values for an hour");
+    run_scheduler(2 * DEFAULT_SAMPLING_MAX_PERIOD_SHT31 * 1000000ULL, NULL);
+    uint32_t samples = bh1750->stats.samples + sht31->stats.samples;
+    stub_reset_counters();
+    run_scheduler(3600ULL * 1000000, NULL);
+    samples = bh1750->stats.samples + sht31->stats.samples - samples;
+    double fixed = 3600.0 / FIXED_PERIOD_BH1750 + 3600.0 / FIXED_PERIOD_SHT31;
+    BENCH_CHECK(samples < fixed, "%u samples in a still hour", samples);
+    bench_report_value("samples per hour", samples, "");
+    bench_report_value("  at the former fixed periods", fixed, "");
+    bench_report_value("I2C bus time per hour", bench_per(STUB_EV_I2C_BUS, 1) / 1000, "ms");
+    bench_report_value("RainMaker publishes per hour", bench_per(STUB_EV_RMAKER_PUBLISH, 1), "");
+
+    bench_title("Adaptive sampling, light switched every 10 min");
+    uint32_t x = 17;
+    uint64_t total_us = 0, worst_us = 0;
+    samples = bh1750->stats.samples;
+    uint64_t start_us = stub_now_us();
+    for (int i = 0; i < SWITCHES; i++) {
+        x = x * 1103515245 + 12345;
+        run_scheduler(540000000ULL + x % 120000000, NULL);
+        s_want = i % 2 ? 40.0f : 400.0f;
+        sim_bh1750_set_lux(s_want);
+        uint64_t latency_us = run_until(luminosity_published, 600ULL * 1000000);
+        total_us += latency_us;
+        worst_us = latency_us > worst_us ? latency_us : worst_us;
+    }
+    double hours = (stub_now_us() - start_us) / 3600e6;
+    // Fixed periods: the switch lands half a period before a sample on average, the median needs a second one
+    double fixed_avg_s = FIXED_PERIOD_BH1750 / 2.0 + FIXED_PERIOD_BH1750;
+    double avg_s = total_us / 1e6 / SWITCHES;
+    BENCH_CHECK(avg_s < fixed_avg_s, "published %.1f s after a switch on average", avg_s);
+    bench_report_value("switch to publish, average", avg_s, "s");
+    bench_report_value("  at the former fixed period", fixed_avg_s, "s");
+    bench_report_value("switch to publish, worst", worst_us / 1e6, "s");
+    bench_report_value("BH1750 samples per hour", (bh1750->stats.samples - samples) / hours, "");
+    bench_report_value("  at the former fixed period", 3600.0 / FIXED_PERIOD_BH1750, "");
+
+    bench_title("Adaptive sampling, window open: -5 C in 10 min");
+    run_scheduler(2 * DEFAULT_SAMPLING_MAX_PERIOD_SHT31 * 1000000ULL, NULL);
+    samples = sht31->stats.samples;
+    for (int s = 1; s <= 60; s++) {
+        s_want = 21.5f - 5.0f * s / 60;
+        sim_sht3x_set(s_want, 50.0f);
+        run_scheduler(10 * 1000000ULL, NULL);
+    }
+    uint32_t ramp_samples = sht31->stats.samples - samples;
+    uint64_t lag_us = run_until(temperature_published, 3600ULL * 1000000);
+    BENCH_CHECK(ramp_samples > 600 / FIXED_PERIOD_SHT31, "%u samples while the window was open", ramp_samples);
+    bench_report_value("SHT31 samples during the 10 min", ramp_samples, "");
+    bench_report_value("  at the former fixed period", 600.0 / FIXED_PERIOD_SHT31, "");
+    bench_report_value("end of the drop to publish", lag_us / 1e6, "s");
+    bench_report_value("SHT31 period at the end of the drop", sht31->period_ms / 1000.0, "s");
+    stub_log_level = level;
+}
+
+static uint32_t s_uploaded;
+
+static void count_upload(const char *topic, const void *data, size_t len)
+{
+    BENCH_CHECK(!strcmp(topic, "node/hostnode/sensorlog"), "topic %s", topic);
+    for (const char *p = data; (p = strstr(p, "[\"")) != NULL && p < (const char *)data + len; p++) {
+        s_uploaded++;
+    }
+}
+
+/* Two hours without MQTT, samples go to flash; then MQTT is back and the backlog goes up in batches */
+static void bench_sensor_log(void)
+{
+    const sensor_log_t *log = app_driver_sensor_get_log();
+    BENCH_CHECK(log && s_log_entry, "no sensor log");
+    const uint64_t flush_us = DEFAULT_SENSOR_LOG_FLUSH_PERIOD * 1000000ULL;
+    stub_rmaker_mqtt_capture(count_upload);
+
+    // Everything sampled so far was logged offline: catch up first
+    bench_title("Sensor log, catching up with the benches above");
+    stub_reset_counters();
+    stub_rmaker_set_connected(true);
+    uint64_t publishes;
+    do {
+        publishes = stub_counter(STUB_EV_RMAKER_MQTT)->count;
+        run_scheduler(flush_us, NULL);
+    } while (stub_counter(STUB_EV_RMAKER_MQTT)->count != publishes);
+    BENCH_CHECK(log->stats.appended == log->stats.written + log->queue_len && !log->stats.dropped && !log->stats.lost,
+                "%u appended, %u written, %u dropped, %u lost", log->stats.appended, log->stats.written,
+                log->stats.dropped, log->stats.lost);
+    bench_report_value("samples logged", log->stats.written, "");
+    bench_report_value("  uploaded", s_uploaded, "");
+    bench_report_value("  publishes", publishes, "");
+    bench_report_value("flash bytes per sample", (double)log->stats.bytes / log->stats.written, "bytes");
+
+    bench_title("Sensor log, 2 h MQTT outage");
+    stub_rmaker_set_connected(false);
+    uint32_t appended = log->stats.appended;
+    uint32_t bytes = log->stats.bytes;
+    stub_reset_counters();
+    run_scheduler(7200ULL * 1000000, NULL);
+    uint32_t offline = log->stats.appended - appended;
+    BENCH_CHECK(!stub_counter(STUB_EV_RMAKER_MQTT)->count, "published while offline");
+    bench_report_value("samples logged", offline, "");
+    bench_report_value("flash bytes per sample", (double)(log->stats.bytes - bytes) / offline, "bytes");
+    bench_report_value("flash writes", stub_counter(STUB_EV_FLASH_WRITE)->count, "");
+
+    bench_title("Sensor log, reconnect");
+    s_uploaded = 0;
+    appended = log->stats.appended;
+    stub_reset_counters();
+    stub_rmaker_set_connected(true);
+    run_scheduler(2 * flush_us, NULL);
+    publishes = stub_counter(STUB_EV_RMAKER_MQTT)->count;
+    BENCH_CHECK(s_uploaded >= offline && s_uploaded <= offline + log->stats.appended - appended,
+                "%u uploaded, %u logged offline", s_uploaded, offline);
+    BENCH_CHECK(publishes == (s_uploaded + DEFAULT_SENSOR_LOG_UPLOAD_BATCH - 1) / DEFAULT_SENSOR_LOG_UPLOAD_BATCH,
+                "%u samples in %llu publishes", s_uploaded, (unsigned long long)publishes);
+    bench_report_value("samples uploaded", s_uploaded, "");
+    bench_report_value("  publishes", publishes, "");
+    bench_report_value("  payload bytes per sample", bench_per(STUB_EV_RMAKER_MQTT, s_uploaded), "bytes");
+
+    // Online, samples are reported live and only marked uploaded
+    stub_reset_counters();
+    run_scheduler(3600ULL * 1000000, NULL);
+    BENCH_CHECK(!stub_counter(STUB_EV_RMAKER_MQTT)->count, "backlog published while online");
+    bench_report_value("log publishes in the next hour online", stub_counter(STUB_EV_RMAKER_MQTT)->count, "");
+
+    // After a reboot the log picks up where it was, with nothing left to upload
+    static sensor_log_t reopened;
+    sensor_log_cursor_t cursor;
+    sensor_log_sample_t sample[64];
+    BENCH_CHECK(sensor_log_open(&reopened, log->partition) == ESP_OK, "reopen");
+    sensor_log_backlog(&reopened, &cursor);
+    size_t again = sensor_log_read(&reopened, &cursor, sample, 64);
+    BENCH_CHECK(again < 64 && reopened.writer.seq == log->writer.seq && reopened.writer.offset == log->writer.offset,
+                "reopened at %u:%u with %zu to upload", reopened.writer.seq, reopened.writer.offset, again);
+    bench_report_value("backlog after a reboot", again, "samples");
+    BENCH_CHECK(!stub_partition_dirty_writes(log->partition), "wrote over programmed flash");
+    stub_rmaker_mqtt_capture(NULL);
+}
+
+static int s_order[3];
+static int s_completed;
+
+static void record_order(i2c_dev_request_t *req)
+{
+    BENCH_CHECK(req->result == ESP_OK, "request failed: %d", req->result);
+    s_order[s_completed++] = (int)(intptr_t)req->arg;
+}
+
+/* Requests queued while the bus task sleeps run as one batch, by device priority */
+static void check_bus_queue(void)
+{
+    i2c_dev_t low = { .port = I2C_NUM_0, .addr = BH1750_ADDR_LO, .priority = 0 };
+    i2c_dev_t high = low;
+    high.priority = 2;
+    uint8_t buf[3][2];
+    i2c_dev_request_t reqs[3] = {
+        { .dev = &low, .data = buf[0], .size = 2, .callback = record_order, .arg = (void *)0 },
+        { .dev = &high, .data = buf[1], .size = 2, .callback = record_order, .arg = (void *)1 },
+        { .dev = &low, .data = buf[2], .size = 2, .callback = record_order, .arg = (void *)2 },
+    };
+    i2cdev_stats_t before, after;
+    i2cdev_get_stats(I2C_NUM_0, &before);
+    for (int i = 0; i < 3; i++) {
+        BENCH_CHECK(i2c_dev_submit(&reqs[i]) == ESP_OK, "submit failed");
+    }
+    BENCH_CHECK(!reqs[0].done, "request done before the bus task ran");
+    BENCH_CHECK(i2cdev_bus_step(I2C_NUM_0), "nothing queued");
+    BENCH_CHECK(!i2cdev_bus_step(I2C_NUM_0), "queue not drained");
+    i2cdev_get_stats(I2C_NUM_0, &after);
+    BENCH_CHECK(s_completed == 3 && s_order[0] == 1 && s_order[1] == 0 && s_order[2] == 2,
+                "completion order %d %d %d", s_order[0], s_order[1], s_order[2]);
+    BENCH_CHECK(after.batches - before.batches == 1, "%u batches", after.batches - before.batches);
+    bench_report_value("requests queued, run in one batch by priority", 3, "");
+}
+
+int main(void)
+{
+    sim_sht3x_attach(I2C_NUM_0, SHT3X_I2C_ADDR_GND);
+    sim_bh1750_attach(I2C_NUM_0, BH1750_ADDR_LO);
+    // Left free running by the firmware before an OTA or watchdog reboot
+    sim_sht3x_run_periodic();
+    remove(LOG_FILE);
+    BENCH_CHECK(stub_partition_add(DEFAULT_SENSOR_LOG_PARTITION, ESP_PARTITION_TYPE_DATA,
+                                   DEFAULT_SENSOR_LOG_PARTITION_SUBTYPE, 0xBA000, LOG_FILE), "log partition");
+    app_main();
+    i2cdev_stats_t setup;
+    i2cdev_get_stats(I2C_NUM_0, &setup);
+    BENCH_CHECK(!setup.errors, "%u I2C errors setting the sensors up", setup.errors);
+    s_log_entry = sensor_sched_find("sensor_log");
+    s_fetch_timers[0] = stub_esp_timer_find("app_driver_sensor_sht31_fetch_tm");
+    s_fetch_timers[1] = stub_esp_timer_find("app_driver_sensor_bh1750_fetch_tm");
+    s_fetch_timers[2] = stub_esp_timer_find("app_driver_report_flush_tm");
+    BENCH_CHECK(s_fetch_timers[0] && s_fetch_timers[1] && s_fetch_timers[2], "fetch or flush timers not found");
+
+    bench_title("RainMaker commands (write_cb)");
+    bench_command("RGB Light", "Hue", 360);
+    bench_command("RGB Light", "Brightness", 101);
+    bench_command("RGB Light", "Saturation", 1);
+    bench_command("Bedroom Light", "Brightness", 101);
+
+    bench_timer("LED animation frame", "rgbpixel_anim_tm", FRAMES, GAP_US);
+    bench_timer("BH1750 sample", "bh1750", SAMPLES, SAMPLE_GAP_US);
+    bench_timer("SHT31 sample", "sht31", SAMPLES, SAMPLE_GAP_US);
+    bench_repeatability();
+    bench_autorange();
+    bench_report_on_change();
+    bench_alternate(SAMPLES);
+    bench_scheduler();
+    bench_adaptive();
+    bench_sensor_log();
+
+    bench_title("I2C bus task");
+    check_bus_queue();
+    remove(LOG_FILE);
+    return 0;
+}
@@ -0,0 +1,151 @@
+/* Host benchmark: sensor noise filter
+ *
+ * Checks the median stage of sensor_filter.c against a sort of the same
+ * window, then runs a drifting temperature with sample noise, single-sample
+ * spikes and one real step through the report-on-change stage, raw and with
+ * the filter the app uses, and compares what gets published.
+ */
+#include <string.h>
+#include <sensor_filter.h>
+#include <sensor_report.h>
+#include "bench.h"
+
+#define STREAM      20000
+#define PERIOD_S    60
+#define STEP_AT     (STREAM / 2)
+#define STEP        800
+#define UPDATES     2000000
+
+/* The app's temperature filter and report settings, see app_priv.h */
+#define FILTER_TEMPERATURE { .median = 3, .ema_shift = 1, .outlier = 500, .outlier_max = 2 }
+#define REPORT_TEMPERATURE { .deadband = 20, .max_silent_ms = 900 * 1000 }
+
+static int32_t s_truth[STREAM];
+static int32_t s_sample[STREAM];
+static bool s_spike[STREAM];
+static volatile int64_t s_sink;
+
+static uint32_t next_rand(uint32_t *x)
+{
+    *x = *x * 1103515245 + 12345;
+    return *x >> 16;
+}
+
+/* 21.50 C drifting by +-3 C over a day, +-0.2 C of noise, 1 % spikes of 20 to 40 C */
+static void make_stream(void)
+{
+    uint32_t x = 2024;
+    for (int i = 0; i < STREAM; i++) {
+        int32_t phase = i % 1440;
+        s_truth[i] = 2150 + (phase < 720 ? phase : 1440 - phase) * 600 / 720 - 300 + (i >= STEP_AT ? STEP : 0);
+        int32_t noise = (int32_t)(next_rand(&x) % 21) - 10 + (int32_t)(next_rand(&x) % 21) - 10;
+        uint32_t r = next_rand(&x);
+        s_spike[i] = r % 100 == 0 && i != STEP_AT;
+        s_sample[i] = s_truth[i] + noise + (s_spike[i] ? (r & 1 ? 1 : -1) * (2000 + (int32_t)(r % 2000)) : 0);
+    }
+}
+
+static int cmp_int32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void check_median(void)
+{
+    for (uint8_t len = 1; len <= SENSOR_FILTER_MEDIAN_MAX; len += 2) {
+        sensor_filter_t filter = { .median = len };
+        for (int i = 0; i < STREAM; i++) {
+            int32_t out, window[SENSOR_FILTER_MEDIAN_MAX];
+            int n = i + 1 < len ? i + 1 : len;
+            memcpy(window, &s_sample[i + 1 - n], n * sizeof(int32_t));
+            qsort(window, n, sizeof(int32_t), cmp_int32);
+            BENCH_CHECK(sensor_filter_apply(&filter, s_sample[i], &out), "median rejected a sample");
+            BENCH_CHECK(out == window[(n - 1) / 2], "median of %u at %d: %d, want %d", len, i, out,
+                        window[(n - 1) / 2]);
+        }
+    }
+    bench_report_value("median windows 1..7 match a sort", STREAM * (SENSOR_FILTER_MEDIAN_MAX + 1) / 2, "samples");
+}
+
+typedef struct {
+    uint32_t published;
+    uint32_t spikes;        /* published more than 1 C off */
+    int32_t max_error;      /* largest published error outside spikes and the step */
+    int step_delay;         /* samples after the step until it is published */
+} outcome_t;
+
+static outcome_t run(sensor_filter_t *filter)
+{
+    sensor_report_t report = REPORT_TEMPERATURE;
+    outcome_t o = { .step_delay = -1 };
+    for (int i = 0; i < STREAM; i++) {
+        int32_t value = s_sample[i];
+        if (filter && !sensor_filter_apply(filter, value, &value)) {
+            continue;
+        }
+        if (!sensor_report_check(&report, value, (int64_t)i * PERIOD_S * 1000000)) {
+            continue;
+        }
+        o.published++;
+        int32_t error = abs(value - s_truth[i]);
+        if (i >= STEP_AT && o.step_delay < 0 && error < STEP / 2) {
+            o.step_delay = i - STEP_AT;
+        }
+        if (error > 100) {
+            o.spikes += i < STEP_AT || i > STEP_AT + 5;
+        } else if (error > o.max_error) {
+            o.max_error = error;
+        }
+    }
+    return o;
+}
+
+static void bench_publishes(void)
+{
+    sensor_filter_t filter = FILTER_TEMPERATURE;
+    outcome_t raw = run(NULL);
+    outcome_t filtered = run(&filter);
+    BENCH_CHECK(filtered.spikes == 0, "%u spikes published", filtered.spikes);
+    BENCH_CHECK(filtered.published < raw.published, "%u publishes filtered, %u raw", filtered.published,
+                raw.published);
+    BENCH_CHECK(filtered.step_delay >= 0 && filtered.step_delay <= 3, "step published after %d samples",
+                filtered.step_delay);
+    BENCH_CHECK(filter.restarts == 1, "%u restarts for one step", filter.restarts);
+
+    bench_report_value("publishes, raw samples", raw.published, "");
+    bench_report_value("publishes, filtered", filtered.published, "");
+    bench_report_value("spikes published, raw", raw.spikes, "");
+    bench_report_value("spikes published, filtered", filtered.spikes, "");
+    bench_report_value("largest published error, raw", raw.max_error / 100.0, "C");
+    bench_report_value("largest published error, filtered", filtered.max_error / 100.0, "C");
+    bench_report_value("samples rejected as outliers", filter.rejected, "");
+    bench_report_value("8 C step published after", filtered.step_delay, "samples");
+}
+
+static void bench_update(void)
+{
+    sensor_filter_t filter = FILTER_TEMPERATURE;
+    int64_t sum = 0;
+    uint64_t start = stub_cycles();
+    for (int i = 0; i < UPDATES; i++) {
+        int32_t out;
+        if (sensor_filter_apply(&filter, s_sample[i % STREAM], &out)) {
+            sum += out;
+        }
+    }
+    uint64_t cycles = stub_cycles() - start;
+    s_sink += sum;
+    bench_report("sensor_filter_apply, median 3 + EMA", UPDATES, cycles);
+    bench_report_value("filter state per param", sizeof(sensor_filter_t), "bytes");
+}
+
+int main(void)
+{
+    bench_title("Sensor noise filter");
+    make_stream();
+    check_median();
+    bench_publishes();
+    bench_update();
+    return 0;
+}
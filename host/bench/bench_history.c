@@ -0,0 +1,215 @@
+/* Host benchmark: sensor history tiers
+ *
+ * Feeds a stream with irregular gaps into sensor_history.c and compares
+ * every tier against min/max/mean recomputed from all samples, then times
+ * the per-sample update and an hour's summary from the tiers against a
+ * scan of the raw samples.
+ */
+#include <string.h>
+#include <sensor_history.h>
+#include "bench.h"
+
+#define STREAM      200000
+#define UPDATES     2000000
+#define SCAN_LEN    3600
+
+typedef struct {
+    int32_t value;
+    uint32_t t;
+} sample_t;
+
+static sample_t s_stream[STREAM];
+static volatile int64_t s_sink;
+
+static uint32_t next_rand(uint32_t *x)
+{
+    *x = *x * 1103515245 + 12345;
+    return *x >> 16;
+}
+
+static void make_stream(void)
+{
+    uint32_t x = 4321, t = 1000;
+    for (int i = 0; i < STREAM; i++) {
+        uint32_t r = next_rand(&x);
+        // Mostly a few seconds apart, now and then minutes, rarely hours
+        t += r % 100 == 0 ? 3600 + r % 9000 : r % 10 == 0 ? 61 + r % 600 : 1 + r % 5;
+        s_stream[i].t = t;
+        s_stream[i].value = (int32_t)(next_rand(&x) % 8001) - 4000;
+    }
+}
+
+/* Newest-first reference bucket `age` of a tier, from every sample up to `last` */
+static sensor_history_bucket_t reference(int last, uint32_t span_s, size_t age)
+{
+    sensor_history_bucket_t b = { 0 };
+    int64_t sum = 0;
+    size_t seen = 0;
+    for (int i = last; i >= 0; i--) {
+        uint32_t start = span_s ? s_stream[i].t - s_stream[i].t % span_s : s_stream[i].t;
+        if (b.count && (!span_s || start != b.start_s)) {
+            if (seen++ == age) {
+                break;
+            }
+            memset(&b, 0, sizeof(b));
+            sum = 0;
+        }
+        int32_t v = s_stream[i].value;
+        if (!b.count || v < b.min) {
+            b.min = v;
+        }
+        if (!b.count || v > b.max) {
+            b.max = v;
+        }
+        b.start_s = start;
+        b.count++;
+        sum += v;
+        b.mean = (sum >= 0 ? sum + b.count / 2 : sum - (int64_t)b.count / 2) / (int64_t)b.count;
+    }
+    return b;
+}
+
+static void check_tiers(void)
+{
+    static const uint32_t spans[SENSOR_HISTORY_TIERS] = { 0, 60, 3600 };
+    static sensor_history_t history;
+    sensor_history_init(&history);
+    size_t compared = 0;
+    for (int i = 0; i < STREAM; i++) {
+        sensor_history_add(&history, s_stream[i].value, s_stream[i].t);
+        if (i % 9973 != 0 && i != STREAM - 1) {
+            continue;
+        }
+        for (int tier = 0; tier < SENSOR_HISTORY_TIERS; tier++) {
+            size_t count = sensor_history_count(&history, tier);
+            for (size_t age = 0; age < count; age++) {
+                const sensor_history_bucket_t *got = sensor_history_get(&history, tier, age);
+                sensor_history_bucket_t want = reference(i, spans[tier], age);
+                BENCH_CHECK((const void *)got >= (const void *)&history &&
+                            (const void *)got < (const void *)(&history + 1), "bucket outside the history");
+                BENCH_CHECK(!memcmp(got, &want, sizeof(want)),
+                            "tier %d age %zu at %d: %u/%u %d..%d ~%d, want %u/%u %d..%d ~%d", tier, age, i,
+                            got->start_s, got->count, got->min, got->max, got->mean,
+                            want.start_s, want.count, want.min, want.max, want.mean);
+                compared++;
+            }
+            BENCH_CHECK(!sensor_history_get(&history, tier, count), "bucket past the end");
+        }
+    }
+    BENCH_CHECK(sensor_history_count(&history, SENSOR_HISTORY_RAW) == SENSOR_HISTORY_RAW_LEN &&
+                sensor_history_count(&history, SENSOR_HISTORY_MINUTE) == SENSOR_HISTORY_MINUTE_LEN &&
+                sensor_history_count(&history, SENSOR_HISTORY_HOUR) == SENSOR_HISTORY_HOUR_LEN, "tiers not full");
+    bench_report_value("buckets compared, all identical", compared, "");
+    bench_report_value("history size per param", sizeof(sensor_history_t), "bytes");
+}
+
+static void bench_update(void)
+{
+    static sensor_history_t history;
+    sensor_history_init(&history);
+    uint64_t start = stub_cycles();
+    for (int i = 0; i < UPDATES; i++) {
+        const sample_t *s = &s_stream[i % STREAM];
+        // Keep time moving forward across laps of the stream
+        sensor_history_add(&history, s->value, s->t + (uint32_t)(i / STREAM) * s_stream[STREAM - 1].t);
+    }
+    uint64_t cycles = stub_cycles() - start;
+    s_sink += sensor_history_get(&history, SENSOR_HISTORY_HOUR, 0)->mean;
+    bench_report("sensor_history_add, 3 tiers", UPDATES, cycles);
+}
+
+/* Two hours since boot, then the clock is set: the buckets move over, a clock stepped back is held */
+static void check_rebase(void)
+{
+    static sensor_history_t history;
+    const uint32_t boot_s = 7200, offset_s = 1700000000 - boot_s + 37;
+    sensor_history_init(&history);
+    for (uint32_t t = 5; t <= boot_s; t += 7) {
+        sensor_history_add(&history, (int32_t)t, t);
+    }
+    size_t minutes = sensor_history_count(&history, SENSOR_HISTORY_MINUTE);
+    const sensor_history_bucket_t *raw = sensor_history_get(&history, SENSOR_HISTORY_RAW, 0);
+    uint32_t last_s = raw->start_s + offset_s;
+    sensor_history_rebase(&history, offset_s);
+    BENCH_CHECK(raw->start_s == last_s, "raw sample at %u, want %u", raw->start_s, last_s);
+    static const uint32_t spans[] = { 60, 3600 };
+    for (int tier = SENSOR_HISTORY_MINUTE; tier <= SENSOR_HISTORY_HOUR; tier++) {
+        for (size_t age = 0; age < sensor_history_count(&history, tier); age++) {
+            const sensor_history_bucket_t *b = sensor_history_get(&history, tier, age);
+            const sensor_history_bucket_t *newer = age ? sensor_history_get(&history, tier, age - 1) : NULL;
+            BENCH_CHECK(b->start_s % spans[tier - 1] == 0 && (!newer || newer->start_s > b->start_s),
+                        "tier %d bucket %zu at %u", tier, age, b->start_s);
+        }
+    }
+
+    // Same minute on the wall clock, then the clock is stepped back
+    sensor_history_add(&history, 0, last_s + 1);
+    sensor_history_add(&history, 0, last_s - 600);
+    const sensor_history_bucket_t *minute = sensor_history_get(&history, SENSOR_HISTORY_MINUTE, 0);
+    raw = sensor_history_get(&history, SENSOR_HISTORY_RAW, 0);
+    BENCH_CHECK(sensor_history_count(&history, SENSOR_HISTORY_MINUTE) <= minutes + 1 &&
+                minute->start_s == (last_s + 1) - (last_s + 1) % 60 && raw->start_s == last_s + 1,
+                "minute bucket at %u, raw at %u, last %u", minute->start_s, raw->start_s, last_s);
+    bench_report_value("buckets moved to the wall clock, in order", minutes + sensor_history_count(&history,
+                       SENSOR_HISTORY_HOUR), "");
+}
+
+/* Last hour at one sample a second: scan the samples, or read 60 minute buckets */
+static void bench_hour_summary(void)
+{
+    static sensor_history_t history;
+    static int32_t raw[SCAN_LEN];
+    sensor_history_init(&history);
+    for (int i = 0; i < SCAN_LEN; i++) {
+        raw[i] = s_stream[i].value;
+        sensor_history_add(&history, raw[i], 7200 + i);
+    }
+
+    int64_t scan_sum = 0, tier_sum = 0;
+    uint64_t start = stub_cycles();
+    for (int n = 0; n < 1000; n++) {
+        int32_t lo = INT32_MAX, hi = INT32_MIN;
+        int64_t sum = 0;
+        for (int i = 0; i < SCAN_LEN; i++) {
+            lo = raw[i] < lo ? raw[i] : lo;
+            hi = raw[i] > hi ? raw[i] : hi;
+            sum += raw[i];
+        }
+        scan_sum += lo + hi + sum / SCAN_LEN;
+        raw[n] = s_stream[n + 1].value; // a new sample each round, as on the device
+    }
+    uint64_t scan_cycles = stub_cycles() - start;
+
+    start = stub_cycles();
+    for (int n = 0; n < 1000; n++) {
+        int32_t lo = INT32_MAX, hi = INT32_MIN;
+        int64_t sum = 0, count = 0;
+        for (size_t age = 0; age < sensor_history_count(&history, SENSOR_HISTORY_MINUTE); age++) {
+            const sensor_history_bucket_t *b = sensor_history_get(&history, SENSOR_HISTORY_MINUTE, age);
+            lo = b->min < lo ? b->min : lo;
+            hi = b->max > hi ? b->max : hi;
+            sum += (int64_t)b->mean * b->count;
+            count += b->count;
+        }
+        tier_sum += lo + hi + sum / count;
+    }
+    uint64_t tier_cycles = stub_cycles() - start;
+    s_sink += scan_sum + tier_sum;
+
+    const sensor_history_bucket_t *hour = sensor_history_get(&history, SENSOR_HISTORY_HOUR, 0);
+    BENCH_CHECK(hour && hour->count == SCAN_LEN, "hour bucket holds %u samples", hour ? hour->count : 0);
+    bench_report("hour summary, scan of 3600 samples", 1000, scan_cycles);
+    bench_report("hour summary, 60 minute buckets", 1000, tier_cycles);
+    bench_report_value("speedup", (double)scan_cycles / tier_cycles, "x");
+}
+
+int main(void)
+{
+    bench_title("Sensor history");
+    make_stream();
+    check_tiers();
+    check_rebase();
+    bench_update();
+    bench_hour_summary();
+    return 0;
+}
@@ -0,0 +1,159 @@
+/* Host benchmark: HSV to RGB conversion and strip fill
+ *
+ * Compares led_color_hsv2rgb() against the float converter it replaced in
+ * app_driver.c over the whole input domain, then times both converters and
+ * a per-pixel set_pixel() loop against the one-pass fill.
+ */
+#include <string.h>
+#include <driver/rmt.h>
+#include <led_strip.h>
+#include <led_color.h>
+#include "bench.h"
+
+#define CONVERSIONS 1000000
+#define FILLS       20000
+
+/* The float converter formerly in app_driver.c, kept verbatim as reference */
+static void led_strip_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b)
+{
+    h %= 360; // h -> [0,360]
+    uint32_t rgb_max = v * 2.55f;
+    uint32_t rgb_min = rgb_max * (100 - s) / 100.0f;
+
+    uint32_t i = h / 60;
+    uint32_t diff = h % 60;
+
+    // RGB adjustment amount by hue
+    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
+
+    switch (i) {
+    case 0:
+        *r = rgb_max;
+        *g = rgb_min + rgb_adj;
+        *b = rgb_min;
+        break;
+    case 1:
+        *r = rgb_max - rgb_adj;
+        *g = rgb_max;
+        *b = rgb_min;
+        break;
+    case 2:
+        *r = rgb_min;
+        *g = rgb_max;
+        *b = rgb_min + rgb_adj;
+        break;
+    case 3:
+        *r = rgb_min;
+        *g = rgb_max - rgb_adj;
+        *b = rgb_max;
+        break;
+    case 4:
+        *r = rgb_min + rgb_adj;
+        *g = rgb_min;
+        *b = rgb_max;
+        break;
+    default:
+        *r = rgb_max;
+        *g = rgb_min;
+        *b = rgb_max - rgb_adj;
+        break;
+    }
+}
+
+static volatile uint32_t s_sink;
+
+static void check_exact(void)
+{
+    uint64_t checked = 0;
+    for (uint32_t h = 0; h < 720; h++) {
+        for (uint32_t s = 0; s <= 100; s++) {
+            for (uint32_t v = 0; v <= 100; v++) {
+                uint32_t r0, g0, b0;
+                uint8_t r1, g1, b1;
+                led_strip_hsv2rgb(h, s, v, &r0, &g0, &b0);
+                led_color_hsv2rgb(h, s, v, &r1, &g1, &b1);
+                BENCH_CHECK(r0 == r1 && g0 == g1 && b0 == b1,
+                            "hsv(%u,%u,%u): float %u/%u/%u, fixed %u/%u/%u", h, s, v, r0, g0, b0, r1, g1, b1);
+                checked++;
+            }
+        }
+    }
+    bench_report_value("inputs compared, max error 0 LSB", (double)checked, "");
+}
+
+static void bench_convert(void)
+{
+    uint32_t x = 12345;
+    uint64_t start = stub_cycles();
+    for (int i = 0; i < CONVERSIONS; i++) {
+        uint32_t r, g, b;
+        x = x * 1103515245 + 12345;
+        led_strip_hsv2rgb((x >> 8) % 360, (x >> 4) % 101, x % 101, &r, &g, &b);
+        s_sink += r + g + b;
+    }
+    uint64_t float_cycles = stub_cycles() - start;
+
+    x = 12345;
+    start = stub_cycles();
+    for (int i = 0; i < CONVERSIONS; i++) {
+        uint8_t r, g, b;
+        x = x * 1103515245 + 12345;
+        led_color_hsv2rgb((x >> 8) % 360, (x >> 4) % 101, x % 101, &r, &g, &b);
+        s_sink += r + g + b;
+    }
+    uint64_t fixed_cycles = stub_cycles() - start;
+
+    bench_report("float led_strip_hsv2rgb", CONVERSIONS, float_cycles);
+    bench_report("fixed-point led_color_hsv2rgb", CONVERSIONS, fixed_cycles);
+    bench_report_value("speedup", (double)float_cycles / fixed_cycles, "x");
+}
+
+static void bench_fill(led_strip_t *strip, uint32_t pixels)
+{
+    char what[64];
+    uint64_t start = stub_cycles();
+    for (int i = 0; i < FILLS; i++) {
+        uint32_t r, g, b;
+        led_strip_hsv2rgb(i % 360, 100, 50, &r, &g, &b);
+        for (uint32_t p = 0; p < pixels; p++) {
+            strip->set_pixel(strip, p, r, g, b);
+        }
+    }
+    uint64_t loop_cycles = stub_cycles() - start;
+
+    start = stub_cycles();
+    for (int i = 0; i < FILLS; i++) {
+        uint8_t r, g, b;
+        led_color_hsv2rgb(i % 360, 100, 50, &r, &g, &b);
+        strip->fill(strip, r, g, b);
+    }
+    uint64_t fill_cycles = stub_cycles() - start;
+
+    snprintf(what, sizeof(what), "%u px: float + set_pixel loop", pixels);
+    bench_report(what, FILLS, loop_cycles);
+    snprintf(what, sizeof(what), "%u px: fixed + fill", pixels);
+    bench_report(what, FILLS, fill_cycles);
+    bench_report_value("speedup", (double)loop_cycles / fill_cycles, "x");
+}
+
+int main(void)
+{
+    bench_title("HSV to RGB");
+    check_exact();
+    bench_convert();
+
+    bench_title("Whole strip render");
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(5, RMT_CHANNEL_0);
+    config.clk_div = 2;
+    ESP_ERROR_CHECK(rmt_config(&config));
+    ESP_ERROR_CHECK(rmt_driver_install(config.channel, 0, 0));
+    static const uint32_t lengths[] = { 24, 300 };
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(lengths[i], (led_strip_dev_t)config.channel);
+        led_strip_t *strip = led_strip_new_rmt_ws2812(&strip_config);
+        BENCH_CHECK(strip, "led_strip_new_rmt_ws2812 failed");
+        bench_fill(strip, lengths[i]);
+        strip->del(strip);
+    }
+    return 0;
+}
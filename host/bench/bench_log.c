@@ -0,0 +1,223 @@
+/* Host benchmark: flash sensor log
+ *
+ * Runs sensor_log.c on a file-backed partition with NOR flash semantics:
+ * checks that what is read back, from the oldest sample or after seeking
+ * by time, matches what was appended across wrap-arounds, power cuts in the
+ * middle of a write and reboots, and reports the encoded size per sample,
+ * the flash traffic and how evenly the sectors wear.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sensor_log.h>
+#include <esp_log.h>
+#include "bench.h"
+
+#define LOG_FILE        "bench_log.bin"
+#define LOG_SECTORS     16
+#define STREAM          60000
+#define SEEKS           2000
+
+static sensor_log_sample_t s_ref[STREAM];
+static const esp_partition_t *s_part;
+static sensor_log_t s_log;
+
+static uint32_t next_rand(uint32_t *x)
+{
+    *x = *x * 1103515245 + 12345;
+    return *x >> 16;
+}
+
+/* Three slowly moving series sampled in turn every 20 s, luminosity now and then jumping */
+static void make_stream(void)
+{
+    uint32_t x = 99, t = STUB_EPOCH_S;
+    int32_t level[3] = { 12000, 2150, 4500 };
+    for (int i = 0; i < STREAM; i++) {
+        uint8_t ch = i % 3;
+        uint32_t r = next_rand(&x);
+        if (ch == 0) {
+            level[0] = r % 50 == 0 ? (int32_t)(r % 100000) : level[0] + (int32_t)(r % 201) - 100;
+        } else {
+            level[ch] += (int32_t)(r % 7) - 3;
+        }
+        t += 20;
+        s_ref[i] = (sensor_log_sample_t) { .time_s = t, .value = level[ch], .channel = ch };
+    }
+}
+
+static void reboot(void)
+{
+    stub_partition_remove_all();
+    s_part = stub_partition_add("sensorlog", ESP_PARTITION_TYPE_DATA, 0x40, LOG_SECTORS * SENSOR_LOG_SECTOR_SIZE,
+                                LOG_FILE);
+    BENCH_CHECK(s_part, "partition");
+    BENCH_CHECK(sensor_log_open(&s_log, s_part) == ESP_OK, "open");
+}
+
+/* Append samples [from, to), flushing whenever the queue is full */
+static uint64_t append(int from, int to)
+{
+    uint64_t cycles = 0;
+    for (int i = from; i < to; i++) {
+        uint64_t start = stub_cycles();
+        esp_err_t err = sensor_log_append(&s_log, s_ref[i].channel, s_ref[i].value, s_ref[i].time_s);
+        if (s_log.queue_len == SENSOR_LOG_QUEUE_LEN) {
+            BENCH_CHECK(sensor_log_flush(&s_log) == ESP_OK, "flush");
+        }
+        cycles += stub_cycles() - start;
+        BENCH_CHECK(err == ESP_OK, "append %d", i);
+    }
+    BENCH_CHECK(sensor_log_flush(&s_log) == ESP_OK, "flush");
+    return cycles;
+}
+
+/* Everything in the log must be the last samples appended, up to `end`; returns how many */
+static int check_all(int end)
+{
+    static sensor_log_sample_t out[256];
+    sensor_log_cursor_t c;
+    BENCH_CHECK(sensor_log_seek(&s_log, 0, &c) == ESP_OK, "seek to the start");
+    int total = 0;
+    for (size_t n; (n = sensor_log_read(&s_log, &c, out, 256)) > 0;) {
+        total += n;
+    }
+    BENCH_CHECK(total <= end, "%d samples read, %d appended", total, end);
+    BENCH_CHECK(sensor_log_seek(&s_log, 0, &c) == ESP_OK, "seek to the start");
+    for (int i = end - total; i < end;) {
+        size_t n = sensor_log_read(&s_log, &c, out, 256);
+        for (size_t k = 0; k < n; k++, i++) {
+            BENCH_CHECK(out[k].time_s == s_ref[i].time_s && out[k].value == s_ref[i].value &&
+                        out[k].channel == s_ref[i].channel,
+                        "sample %d: ch %u %u %d, want ch %u %u %d", i, out[k].channel, out[k].time_s,
+                        out[k].value, s_ref[i].channel, s_ref[i].time_s, s_ref[i].value);
+        }
+    }
+    return total;
+}
+
+static void bench_append(void)
+{
+    stub_reset_counters();
+    uint64_t cycles = append(0, STREAM);
+    int kept = check_all(STREAM);
+
+    uint32_t min_erase = UINT32_MAX, max_erase = 0;
+    for (int s = 0; s < LOG_SECTORS; s++) {
+        uint32_t n = stub_partition_erase_count(s_part, s);
+        min_erase = n < min_erase ? n : min_erase;
+        max_erase = n > max_erase ? n : max_erase;
+    }
+    BENCH_CHECK(max_erase - min_erase <= 1, "uneven wear, %u to %u erases", min_erase, max_erase);
+    BENCH_CHECK(!stub_partition_dirty_writes(s_part), "wrote over programmed flash");
+    BENCH_CHECK(kept >= (LOG_SECTORS - 1) * 1000, "only %d samples kept", kept);
+
+    bench_report("append + flush", STREAM, cycles);
+    bench_report_value("flash bytes per sample, headers included", (double)s_log.stats.bytes / s_log.stats.written,
+                       "bytes");
+    bench_report_value("  vs sensor_log_sample_t", sizeof(sensor_log_sample_t), "bytes");
+    bench_report_value("samples kept in 16 sectors (64 KB)", kept, "");
+    bench_report_value("samples per flash write", (double)STREAM / stub_counter(STUB_EV_FLASH_WRITE)->count, "");
+    bench_report_value("erases per sector, min", min_erase, "");
+    bench_report_value("erases per sector, max", max_erase, "");
+}
+
+static void bench_seek(void)
+{
+    sensor_log_cursor_t c;
+    sensor_log_sample_t oldest;
+    BENCH_CHECK(sensor_log_seek(&s_log, 0, &c) == ESP_OK && sensor_log_read(&s_log, &c, &oldest, 1) == 1, "oldest");
+    uint32_t span = s_ref[STREAM - 1].time_s - oldest.time_s;
+    uint32_t x = 7;
+    uint64_t cycles = 0;
+    stub_reset_counters();
+    for (int n = 0; n < SEEKS; n++) {
+        uint32_t t = oldest.time_s + next_rand(&x) * 16 % (span + 40);
+        uint64_t start = stub_cycles();
+        BENCH_CHECK(sensor_log_seek(&s_log, t, &c) == ESP_OK, "seek");
+        cycles += stub_cycles() - start;
+        // First reference sample at or after t
+        int lo = 0, hi = STREAM;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (s_ref[mid].time_s < t) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        sensor_log_sample_t got;
+        size_t read = sensor_log_read(&s_log, &c, &got, 1);
+        BENCH_CHECK(lo == STREAM ? read == 0 : read == 1 && got.time_s == s_ref[lo].time_s &&
+                    got.value == s_ref[lo].value, "seek to %u", t);
+    }
+    bench_report("sensor_log_seek", SEEKS, cycles);
+    bench_report_value("flash bytes read per seek", bench_per(STUB_EV_FLASH_READ, SEEKS), "bytes");
+}
+
+/* Lose power 0 to 2 bytes into a record, reboot, and carry on */
+static void check_power_cuts(void)
+{
+    int end = STREAM / 2;
+    remove(LOG_FILE);
+    reboot();
+    append(0, end);
+    int cuts = 0;
+    for (int i = 0; i < 40; i++, cuts++) {
+        stub_partition_fail_after(s_part, i % 3);
+        sensor_log_append(&s_log, s_ref[end].channel, s_ref[end].value, s_ref[end].time_s);
+        BENCH_CHECK(sensor_log_flush(&s_log) != ESP_OK, "write did not fail");
+        // The torn sample is gone, everything before it is intact: append it again and go on
+        reboot();
+        append(end, end + 50);
+        end += 50;
+    }
+    int kept = check_all(end);
+    BENCH_CHECK(!stub_partition_dirty_writes(s_part), "wrote over programmed flash");
+    bench_report_value("power cuts mid-record, recovered", cuts, "");
+    bench_report_value("samples intact afterwards", kept, "");
+}
+
+/* Upload progress survives a reboot, give or take one mark granule */
+static void check_ack(void)
+{
+    remove(LOG_FILE);
+    reboot();
+    append(0, 5000);
+    sensor_log_cursor_t c;
+    sensor_log_sample_t out[64];
+    sensor_log_backlog(&s_log, &c);
+    int uploaded = 0;
+    for (int i = 0; i < 50; i++) {
+        uploaded += sensor_log_read(&s_log, &c, out, 64);
+    }
+    BENCH_CHECK(sensor_log_ack(&s_log, &c) == ESP_OK, "ack");
+    reboot();
+    sensor_log_backlog(&s_log, &c);
+    BENCH_CHECK(sensor_log_read(&s_log, &c, out, 1) == 1, "backlog empty");
+    int resume = -1;
+    for (int i = 0; i < 5000; i++) {
+        if (s_ref[i].time_s == out[0].time_s) {
+            resume = i;
+        }
+    }
+    BENCH_CHECK(resume <= uploaded && uploaded - resume <= SENSOR_LOG_ACK_CHUNK / 2,
+                "backlog resumes at %d, %d were uploaded", resume, uploaded);
+    BENCH_CHECK(!stub_partition_dirty_writes(s_part), "wrote over programmed flash");
+    bench_report_value("samples uploaded before the reboot", uploaded, "");
+    bench_report_value("  sent again after it", uploaded - resume, "");
+}
+
+int main(void)
+{
+    stub_log_level = ESP_LOG_NONE;
+    bench_title("Flash sensor log");
+    make_stream();
+    remove(LOG_FILE);
+    reboot();
+    bench_append();
+    bench_seek();
+    check_ack();
+    check_power_cuts();
+    remove(LOG_FILE);
+    return 0;
+}
@@ -0,0 +1,135 @@
+/* Host benchmark: SHT3x sample decode
+ *
+ * Compares the table CRC-8 and the integer decode in sht3x.c against the
+ * bit-serial CRC and double arithmetic they replaced over every raw value,
+ * then times the per-sample check and decode of both.
+ */
+#include <math.h>
+#include <sht3x.h>
+#include "bench.h"
+
+#define SAMPLES 1000000
+
+/* The bit-serial CRC and double decode formerly in sht3x.c, kept verbatim as reference */
+#define G_POLYNOM 0x31
+
+static uint8_t crc8(uint8_t data[], int len)
+{
+    // initialization value
+    uint8_t crc = 0xff;
+
+    // iterate over all bytes
+    for (int i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int i = 0; i < 8; i++)
+        {
+            bool xor = crc & 0x80;
+            crc = crc << 1;
+            crc = xor ? crc ^ G_POLYNOM : crc;
+        }
+    }
+    return crc;
+}
+
+static esp_err_t sht3x_compute_values_double(sht3x_raw_data_t raw_data, float *temperature, float *humidity)
+{
+    if (temperature)
+        *temperature = ((((raw_data[0] * 256.0) + raw_data[1]) * 175) / 65535.0) - 45;
+
+    if (humidity)
+        *humidity = ((((raw_data[3] * 256.0) + raw_data[4]) * 100) / 65535.0);
+
+    return ESP_OK;
+}
+
+static volatile int32_t s_sink;
+
+static void make_raw(sht3x_raw_data_t raw, uint16_t t, uint16_t h)
+{
+    raw[0] = t >> 8;
+    raw[1] = t & 0xff;
+    raw[2] = crc8(raw, 2);
+    raw[3] = h >> 8;
+    raw[4] = h & 0xff;
+    raw[5] = crc8(raw + 3, 2);
+}
+
+static void check_exact(void)
+{
+    sht3x_t dev = { .mode = SHT3X_PERIODIC_1MPS };
+    double max_t = 0, max_h = 0;
+    for (uint32_t s = 0; s <= 0xffff; s++) {
+        sht3x_raw_data_t raw;
+        make_raw(raw, s, s);
+        BENCH_CHECK(sht3x_check_raw_data(&dev, raw) == ESP_OK, "CRC mismatch for 0x%04x", s);
+
+        int16_t t, h;
+        BENCH_CHECK(sht3x_compute_values_centi(raw, &t, &h) == ESP_OK, "decode failed");
+        double ref_t = 175.0 * s / 65535.0 - 45;
+        double ref_h = 100.0 * s / 65535.0;
+        max_t = fmax(max_t, fabs(t / 100.0 - ref_t));
+        max_h = fmax(max_h, fabs(h / 100.0 - ref_h));
+    }
+    BENCH_CHECK(max_t <= 0.005 + 1e-9 && max_h <= 0.005 + 1e-9, "error %.4f C, %.4f %%RH", max_t, max_h);
+    bench_report_value("raw values compared, CRC identical", 65536, "");
+    bench_report_value("max temperature error, 0.01 C", max_t * 100, "LSB");
+    bench_report_value("max humidity error, 0.01 %RH", max_h * 100, "LSB");
+}
+
+static void bench_decode(void)
+{
+    static sht3x_raw_data_t raws[256];
+    uint32_t x = 12345;
+    for (int i = 0; i < 256; i++) {
+        x = x * 1103515245 + 12345;
+        make_raw(raws[i], x >> 16, x);
+    }
+    sht3x_t dev = { .mode = SHT3X_PERIODIC_1MPS };
+
+    uint64_t start = stub_cycles();
+    for (int i = 0; i < SAMPLES; i++) {
+        uint8_t *raw = raws[i & 255];
+        float t, h;
+        if (crc8(raw, 2) == raw[2] && crc8(raw + 3, 2) == raw[5]) {
+            sht3x_compute_values_double(raw, &t, &h);
+            s_sink += (int32_t)(t + h);
+        }
+    }
+    uint64_t ref_cycles = stub_cycles() - start;
+
+    start = stub_cycles();
+    for (int i = 0; i < SAMPLES; i++) {
+        uint8_t *raw = raws[i & 255];
+        int16_t t, h;
+        if (sht3x_check_raw_data(&dev, raw) == ESP_OK) {
+            sht3x_compute_values_centi(raw, &t, &h);
+            s_sink += t + h;
+        }
+    }
+    uint64_t centi_cycles = stub_cycles() - start;
+
+    start = stub_cycles();
+    for (int i = 0; i < SAMPLES; i++) {
+        uint8_t *raw = raws[i & 255];
+        float t, h;
+        if (sht3x_check_raw_data(&dev, raw) == ESP_OK) {
+            sht3x_compute_values(raw, &t, &h);
+            s_sink += (int32_t)(t + h);
+        }
+    }
+    uint64_t float_cycles = stub_cycles() - start;
+
+    bench_report("bit-serial CRC + double decode", SAMPLES, ref_cycles);
+    bench_report("table CRC + sht3x_compute_values_centi", SAMPLES, centi_cycles);
+    bench_report("table CRC + sht3x_compute_values", SAMPLES, float_cycles);
+    bench_report_value("speedup (centi)", (double)ref_cycles / centi_cycles, "x");
+}
+
+int main(void)
+{
+    bench_title("SHT3x sample decode");
+    check_exact();
+    bench_decode();
+    return 0;
+}
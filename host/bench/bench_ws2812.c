@@ -0,0 +1,352 @@
+/* Host benchmark: ws2812 driver on the stub RMT
+ *
+ * Measures the translator (ISR) cost per refresh at several strip lengths
+ * and checks the emitted items against the original bit-by-bit translator,
+ * then compares how long callers are blocked by refresh() and refresh_async()
+ * and what the dirty tracking saves on the wire. Long strips are streamed
+ * through the translator with 1 and 4 RMT memory blocks.
+ */
+#include <string.h>
+#include <driver/rmt.h>
+#include <led_strip.h>
+#include "bench.h"
+
+#define REFRESHES 200
+
+/* Original bit-by-bit translator, timing fixed for a 40 MHz counter clock */
+static void ws2812_rmt_adapter_bitwise(const void *src, rmt_item32_t *dest, size_t src_size,
+        size_t wanted_num, size_t *translated_size, size_t *item_num)
+{
+    if (src == NULL || dest == NULL) {
+        *translated_size = 0;
+        *item_num = 0;
+        return;
+    }
+    const rmt_item32_t bit0 = {{{ 14, 1, 40, 0 }}}; //Logical 0
+    const rmt_item32_t bit1 = {{{ 40, 1, 14, 0 }}}; //Logical 1
+    size_t size = 0;
+    size_t num = 0;
+    uint8_t *psrc = (uint8_t *)src;
+    rmt_item32_t *pdest = dest;
+    while (size < src_size && num < wanted_num) {
+        for (int i = 0; i < 8; i++) {
+            // MSB first
+            if (*psrc & (1 << (7 - i))) {
+                pdest->val =  bit1.val;
+            } else {
+                pdest->val =  bit0.val;
+            }
+            num++;
+            pdest++;
+        }
+        size++;
+        psrc++;
+    }
+    *translated_size = size;
+    *item_num = num;
+}
+
+/* Touch the last pixel so that every refresh sends the whole strip */
+static void touch_last(led_strip_t *strip, uint32_t pixels, int i)
+{
+    strip->set_pixel(strip, pixels - 1, i & 0xFF, 0, 0);
+}
+
+static uint64_t refresh_cycles(led_strip_t *strip, uint32_t pixels)
+{
+    stub_reset_counters();
+    for (int i = 0; i < REFRESHES; i++) {
+        touch_last(strip, pixels, i);
+        BENCH_CHECK(strip->refresh(strip, 100) == ESP_OK, "refresh failed");
+    }
+    BENCH_CHECK(stub_counter(STUB_EV_RMT_WRITE)->count == REFRESHES, "refreshes skipped");
+    return stub_counter(STUB_EV_RMT_TRANSLATE)->cycles;
+}
+
+static led_strip_t *new_pattern_strip(rmt_channel_t channel, uint32_t pixels)
+{
+    led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(pixels, (led_strip_dev_t)channel);
+    led_strip_t *strip = led_strip_new_rmt_ws2812(&strip_config);
+    BENCH_CHECK(strip, "led_strip_new_rmt_ws2812 failed");
+    for (uint32_t i = 0; i < pixels; i++) {
+        strip->set_pixel(strip, i, i * 7, i * 13 + 1, 255 - i);
+    }
+    return strip;
+}
+
+static void bench_length(rmt_channel_t channel, uint32_t pixels)
+{
+    led_strip_t *strip = new_pattern_strip(channel, pixels);
+
+    size_t items = pixels * 24;
+    rmt_item32_t *lut_items = calloc(items, sizeof(rmt_item32_t));
+    rmt_item32_t *bit_items = calloc(items, sizeof(rmt_item32_t));
+
+    stub_rmt_capture(channel, lut_items, items);
+    strip->refresh(strip, 100);
+    BENCH_CHECK(stub_rmt_captured(channel) == items, "captured %zu items, expected %zu", stub_rmt_captured(channel), items);
+    stub_rmt_capture(channel, NULL, 0);
+    uint64_t lut = refresh_cycles(strip, pixels);
+    strip->del(strip);
+
+    // A new strip sends its first frame in full
+    strip = new_pattern_strip(channel, pixels);
+    rmt_translator_init(channel, ws2812_rmt_adapter_bitwise);
+    stub_rmt_capture(channel, bit_items, items);
+    strip->refresh(strip, 100);
+    stub_rmt_capture(channel, NULL, 0);
+    BENCH_CHECK(memcmp(lut_items, bit_items, items * sizeof(rmt_item32_t)) == 0, "translated items differ");
+    uint64_t bitwise = refresh_cycles(strip, pixels);
+
+    char what[64];
+    snprintf(what, sizeof(what), "%u px: bit-by-bit translator", pixels);
+    bench_report(what, REFRESHES, bitwise);
+    snprintf(what, sizeof(what), "%u px: nibble table translator", pixels);
+    bench_report(what, REFRESHES, lut);
+    bench_report_value("speedup (items identical)", (double)bitwise / lut, "x");
+
+    free(lut_items);
+    free(bit_items);
+    strip->del(strip);
+}
+
+static uint32_t s_done;
+
+static void count_done(led_strip_t *strip, void *arg)
+{
+    s_done++;
+}
+
+/* Refresh every `interval_us` of virtual time, return us the caller was blocked */
+static uint64_t refresh_blocked_us(led_strip_t *strip, uint32_t pixels, bool async, uint64_t interval_us,
+                                   uint32_t *dropped)
+{
+    uint64_t blocked = 0;
+    *dropped = 0;
+    s_done = 0;
+    for (int i = 0; i < REFRESHES; i++) {
+        touch_last(strip, pixels, i);
+        uint64_t start_us = stub_now_us();
+        esp_err_t err = async ? strip->refresh_async(strip) : strip->refresh(strip, 100);
+        blocked += stub_now_us() - start_us;
+        if (err == ESP_ERR_INVALID_STATE) {
+            (*dropped)++;
+        } else {
+            BENCH_CHECK(err == ESP_OK, "refresh failed");
+        }
+        uint64_t elapsed = stub_now_us() - start_us;
+        stub_block_us(interval_us > elapsed ? interval_us - elapsed : 0);
+    }
+    stub_block_us(100000);
+    return blocked;
+}
+
+static void bench_async(rmt_channel_t channel, uint32_t pixels)
+{
+    led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(pixels, (led_strip_dev_t)channel);
+    strip_config.done_cb = count_done;
+    led_strip_t *strip = led_strip_new_rmt_ws2812(&strip_config);
+    BENCH_CHECK(strip, "led_strip_new_rmt_ws2812 failed");
+    strip->fill(strip, 10, 20, 30);
+
+    char what[64];
+    uint32_t dropped;
+    stub_reset_counters();
+    uint64_t blocked = refresh_blocked_us(strip, pixels, false, 40000, &dropped);
+    uint64_t wire_us = stub_counter(STUB_EV_RMT_WIRE)->units / REFRESHES;
+    snprintf(what, sizeof(what), "%u px: refresh() at 25 fps", pixels);
+    bench_report_value(what, (double)blocked / REFRESHES, "us");
+
+    blocked = refresh_blocked_us(strip, pixels, true, 40000, &dropped);
+    BENCH_CHECK(dropped == 0 && s_done == REFRESHES, "%u dropped, %u done", dropped, s_done);
+    snprintf(what, sizeof(what), "%u px: refresh_async() at 25 fps", pixels);
+    bench_report_value(what, (double)blocked / REFRESHES, "us");
+
+    // Back to back, every frame after the first waits for the strip to latch the previous one
+    blocked = refresh_blocked_us(strip, pixels, false, 0, &dropped);
+    BENCH_CHECK(blocked >= wire_us * REFRESHES + 280 * (REFRESHES - 1), "%llu us blocked, frames ran together",
+                (unsigned long long)blocked);
+    snprintf(what, sizeof(what), "%u px: refresh() back to back", pixels);
+    bench_report_value(what, (double)blocked / REFRESHES, "us");
+
+    // Refresh twice as fast as the wire can take frames
+    blocked = refresh_blocked_us(strip, pixels, true, wire_us / 2, &dropped);
+    BENCH_CHECK(blocked == 0 && s_done + dropped == REFRESHES, "%u dropped, %u done", dropped, s_done);
+    snprintf(what, sizeof(what), "%u px: async dropped at 2x wire rate", pixels);
+    bench_report_value(what, (double)dropped * 100 / REFRESHES, "%");
+    strip->del(strip);
+}
+
+/* Frames and wire time for updates that change nothing, the head, or everything */
+static void bench_dirty(rmt_channel_t channel, uint32_t pixels)
+{
+    led_strip_t *strip = new_pattern_strip(channel, pixels);
+    BENCH_CHECK(strip->refresh(strip, 100) == ESP_OK, "refresh failed");
+    char what[64];
+
+    stub_reset_counters();
+    for (int i = 0; i < REFRESHES; i++) {
+        strip->set_pixel(strip, 0, 0, 1, 255);
+        BENCH_CHECK(strip->refresh(strip, 100) == ESP_OK, "refresh failed");
+    }
+    BENCH_CHECK(stub_counter(STUB_EV_RMT_WRITE)->count == 0, "unchanged frames sent");
+    snprintf(what, sizeof(what), "%u px: unchanged, frames sent", pixels);
+    bench_report_value(what, (double)stub_counter(STUB_EV_RMT_WRITE)->count / REFRESHES, "");
+
+    stub_reset_counters();
+    for (int i = 0; i < REFRESHES; i++) {
+        strip->set_pixel(strip, i % 4, i, 0, 0);
+        BENCH_CHECK(strip->refresh(strip, 100) == ESP_OK, "refresh failed");
+    }
+    snprintf(what, sizeof(what), "%u px: first 4 px changed, wire time", pixels);
+    bench_report_value(what, bench_per(STUB_EV_RMT_WIRE, REFRESHES), "us");
+
+    stub_reset_counters();
+    for (int i = 0; i < REFRESHES; i++) {
+        strip->fill(strip, i, i, i);
+        BENCH_CHECK(strip->refresh(strip, 100) == ESP_OK, "refresh failed");
+    }
+    snprintf(what, sizeof(what), "%u px: all changed, wire time", pixels);
+    bench_report_value(what, bench_per(STUB_EV_RMT_WIRE, REFRESHES), "us");
+    strip->del(strip);
+}
+
+static void check_pre_encode(rmt_channel_t channel, uint32_t pixels)
+{
+    size_t items = pixels * 24;
+    rmt_item32_t *captured[2];
+    for (int pre_encode = 0; pre_encode <= 1; pre_encode++) {
+        led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(pixels, (led_strip_dev_t)channel);
+        strip_config.pre_encode = pre_encode;
+        led_strip_t *strip = led_strip_new_rmt_ws2812(&strip_config);
+        BENCH_CHECK(strip, "led_strip_new_rmt_ws2812 failed");
+        for (uint32_t i = 0; i < pixels; i++) {
+            strip->set_pixel(strip, i, i * 7, i * 13 + 1, 255 - i);
+        }
+        strip->refresh(strip, 100);
+        // Patch a few pixels and send again
+        strip->set_pixel(strip, pixels / 2, 1, 2, 3);
+        strip->set_pixel(strip, pixels - 1, 4, 5, 6);
+        captured[pre_encode] = calloc(items, sizeof(rmt_item32_t));
+        stub_rmt_capture(channel, captured[pre_encode], items);
+        strip->refresh(strip, 100);
+        BENCH_CHECK(stub_rmt_captured(channel) == items, "captured %zu items", stub_rmt_captured(channel));
+        stub_rmt_capture(channel, NULL, 0);
+        strip->del(strip);
+    }
+    BENCH_CHECK(memcmp(captured[0], captured[1], items * sizeof(rmt_item32_t)) == 0, "pre-encoded items differ");
+    free(captured[0]);
+    free(captured[1]);
+}
+
+/* A two pixel spinner moved one step per frame: task and ISR cost per frame */
+static void bench_sparse(rmt_channel_t channel, uint32_t pixels, bool pre_encode)
+{
+    led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(pixels, (led_strip_dev_t)channel);
+    strip_config.pre_encode = pre_encode;
+    led_strip_t *strip = led_strip_new_rmt_ws2812(&strip_config);
+    BENCH_CHECK(strip, "led_strip_new_rmt_ws2812 failed");
+    strip->fill(strip, 0, 0, 38);
+    BENCH_CHECK(strip->refresh(strip, 100) == ESP_OK, "refresh failed");
+    // Latched before the first step, so that one is not dropped
+    stub_block_us(100000);
+
+    stub_reset_counters();
+    uint64_t cycles = 0;
+    for (int i = 0; i < REFRESHES; i++) {
+        uint32_t last = i % pixels;
+        uint32_t pos = (i + 1) % pixels;
+        uint64_t start = stub_cycles();
+        strip->set_pixel(strip, last, 0, 0, 38);
+        strip->set_pixel(strip, (last + 1) % pixels, 0, 0, 38);
+        strip->set_pixel(strip, pos, 0, 38, 38);
+        strip->set_pixel(strip, (pos + 1) % pixels, 0, 38, 38);
+        BENCH_CHECK(strip->refresh_async(strip) == ESP_OK, "refresh failed");
+        cycles += stub_cycles() - start;
+        stub_block_us(100000);
+    }
+    uint64_t isr = stub_counter(STUB_EV_RMT_TRANSLATE)->cycles;
+    char what[64];
+    snprintf(what, sizeof(what), "%u px %s: task", pixels, pre_encode ? "pre-encoded" : "translated");
+    bench_report(what, REFRESHES, cycles - isr);
+    snprintf(what, sizeof(what), "%u px %s: ISR", pixels, pre_encode ? "pre-encoded" : "translated");
+    bench_report(what, REFRESHES, isr);
+    strip->del(strip);
+}
+
+/* Whole frames on a long strip: frame rate, refill interrupts and driver RAM */
+static void bench_long(rmt_channel_t channel, uint32_t pixels, uint8_t mem_blocks)
+{
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(5, channel);
+    config.clk_div = 2;
+    config.mem_block_num = mem_blocks;
+    ESP_ERROR_CHECK(rmt_config(&config));
+
+    led_strip_t *strip = new_pattern_strip(channel, pixels);
+    strip->refresh(strip, 100);
+    stub_reset_counters();
+    for (int i = 0; i < REFRESHES; i++) {
+        strip->fill(strip, i & 0xFF, 0, 0xFF - (i & 0xFF));
+        BENCH_CHECK(strip->refresh(strip, 100) == ESP_OK, "refresh failed");
+    }
+    BENCH_CHECK(stub_counter(STUB_EV_RMT_WRITE)->count == REFRESHES, "refreshes skipped");
+    strip->del(strip);
+
+    char what[64];
+    double wire_us = bench_per(STUB_EV_RMT_WIRE, REFRESHES);
+    snprintf(what, sizeof(what), "%u px, %u blocks: frame rate", pixels, mem_blocks);
+    bench_report_value(what, 1e6 / (wire_us + 280), "fps");
+    snprintf(what, sizeof(what), "%u px, %u blocks: refill interrupts", pixels, mem_blocks);
+    bench_report_value(what, (double)stub_counter(STUB_EV_RMT_TRANSLATE)->count / REFRESHES - 1, "per frame");
+    snprintf(what, sizeof(what), "%u px, %u blocks: encode (ISR)", pixels, mem_blocks);
+    bench_report(what, REFRESHES, stub_counter(STUB_EV_RMT_TRANSLATE)->cycles);
+    if (mem_blocks == 1) {
+        snprintf(what, sizeof(what), "%u px: driver RAM streamed", pixels);
+        bench_report_value(what, pixels * 6, "bytes");
+        snprintf(what, sizeof(what), "%u px: driver RAM pre-encoded", pixels);
+        bench_report_value(what, pixels * (6 + 24 * sizeof(rmt_item32_t)), "bytes");
+    }
+}
+
+int main(void)
+{
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(5, RMT_CHANNEL_0);
+    config.clk_div = 2;
+    ESP_ERROR_CHECK(rmt_config(&config));
+    ESP_ERROR_CHECK(rmt_driver_install(config.channel, 0, 0));
+
+    bench_title("RMT translation (ISR) per refresh");
+    static const uint32_t lengths[] = { 24, 300, 1000 };
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        bench_length(config.channel, lengths[i]);
+    }
+
+    bench_title("Caller blocked per refresh");
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        bench_async(config.channel, lengths[i]);
+    }
+
+    bench_title("Dirty tracking");
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        bench_dirty(config.channel, lengths[i]);
+    }
+
+    bench_title("Spinner step, cycles per frame");
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        bench_sparse(config.channel, lengths[i], false);
+        bench_sparse(config.channel, lengths[i], true);
+    }
+
+    // The pre-encoded items must match what the translator emits
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        check_pre_encode(config.channel, lengths[i]);
+    }
+
+    bench_title("Long strips, streamed");
+    static const uint32_t long_lengths[] = { 300, 600, 1200 };
+    for (size_t i = 0; i < sizeof(long_lengths) / sizeof(long_lengths[0]); i++) {
+        bench_long(config.channel, long_lengths[i], 1);
+        bench_long(config.channel, long_lengths[i], 4);
+    }
+    return 0;
+}
@@ -0,0 +1,8 @@
+/* Host build: RainMaker common reset button helpers */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "iot_button.h"
+
+esp_err_t app_reset_button_register(button_handle_t btn_handle, uint8_t wifi_reset_timeout, uint8_t factory_reset_timeout);
@@ -0,0 +1,7 @@
+/* Host build: section attributes are meaningless on Linux */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
@@ -0,0 +1,12 @@
+/* Host build: CPU cycle counter backed by the host cycle counter */
+#pragma once
+
+#include <stdint.h>
+#include "host_stub.h"
+
+typedef uint32_t esp_cpu_ccount_t;
+
+static inline esp_cpu_ccount_t esp_cpu_get_ccount(void)
+{
+    return (esp_cpu_ccount_t)stub_cycles();
+}
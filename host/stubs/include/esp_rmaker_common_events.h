@@ -0,0 +1,23 @@
+/* Host build: RainMaker common events */
+#pragma once
+
+#include "esp_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ESP_EVENT_DECLARE_BASE(RMAKER_COMMON_EVENT);
+
+typedef enum {
+    RMAKER_EVENT_REBOOT,
+    RMAKER_EVENT_WIFI_RESET,
+    RMAKER_EVENT_FACTORY_RESET,
+    RMAKER_MQTT_EVENT_CONNECTED,
+    RMAKER_MQTT_EVENT_DISCONNECTED,
+    RMAKER_MQTT_EVENT_PUBLISHED,
+} esp_rmaker_common_event_t;
+
+#ifdef __cplusplus
+}
+#endif
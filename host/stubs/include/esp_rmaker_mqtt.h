@@ -0,0 +1,16 @@
+/* Host build: RainMaker MQTT, publishes are counted (see host_stub.h) */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_rmaker_mqtt_publish(const char *topic, void *data, size_t data_len, uint8_t qos, int *msg_id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+/* Host build: ESP RainMaker OTA */
+#pragma once
+
+#include "esp_err.h"
+
+typedef enum {
+    OTA_USING_PARAMS,
+    OTA_USING_TOPICS,
+} esp_rmaker_ota_type_t;
+
+typedef struct {
+    const char *server_cert;
+    void *ota_cb;
+    void *ota_diag;
+    void *priv;
+} esp_rmaker_ota_config_t;
+
+esp_err_t esp_rmaker_ota_enable(esp_rmaker_ota_config_t *ota_config, esp_rmaker_ota_type_t type);
@@ -0,0 +1,6 @@
+/* Host build: ESP RainMaker scheduling */
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t esp_rmaker_schedule_enable(void);
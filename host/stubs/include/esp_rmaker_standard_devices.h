@@ -0,0 +1,15 @@
+/* Host build: ESP RainMaker standard devices */
+#pragma once
+
+#include "esp_rmaker_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_rmaker_device_t *esp_rmaker_lightbulb_device_create(const char *dev_name, void *priv_data, bool power);
+esp_rmaker_device_t *esp_rmaker_temp_sensor_device_create(const char *dev_name, void *priv_data, float temperature);
+
+#ifdef __cplusplus
+}
+#endif
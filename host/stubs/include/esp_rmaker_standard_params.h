@@ -0,0 +1,26 @@
+/* Host build: ESP RainMaker standard params */
+#pragma once
+
+#include "esp_rmaker_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_RMAKER_DEF_NAME_PARAM           "Name"
+#define ESP_RMAKER_DEF_POWER_NAME           "Power"
+#define ESP_RMAKER_DEF_BRIGHTNESS_NAME      "Brightness"
+#define ESP_RMAKER_DEF_HUE_NAME             "Hue"
+#define ESP_RMAKER_DEF_SATURATION_NAME      "Saturation"
+#define ESP_RMAKER_DEF_TEMPERATURE_NAME     "Temperature"
+
+esp_rmaker_param_t *esp_rmaker_name_param_create(const char *param_name, const char *val);
+esp_rmaker_param_t *esp_rmaker_power_param_create(const char *param_name, bool val);
+esp_rmaker_param_t *esp_rmaker_brightness_param_create(const char *param_name, int val);
+esp_rmaker_param_t *esp_rmaker_hue_param_create(const char *param_name, int val);
+esp_rmaker_param_t *esp_rmaker_saturation_param_create(const char *param_name, int val);
+esp_rmaker_param_t *esp_rmaker_temperature_param_create(const char *param_name, float val);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,16 @@
+/* Host build: ESP RainMaker standard types */
+#pragma once
+
+#define ESP_RMAKER_UI_TOGGLE            "esp.ui.toggle"
+#define ESP_RMAKER_UI_SLIDER            "esp.ui.slider"
+#define ESP_RMAKER_UI_HUE_SLIDER        "esp.ui.hue-slider"
+
+#define ESP_RMAKER_PARAM_NAME           "esp.param.name"
+#define ESP_RMAKER_PARAM_POWER          "esp.param.power"
+#define ESP_RMAKER_PARAM_BRIGHTNESS     "esp.param.brightness"
+#define ESP_RMAKER_PARAM_HUE            "esp.param.hue"
+#define ESP_RMAKER_PARAM_SATURATION     "esp.param.saturation"
+#define ESP_RMAKER_PARAM_TEMPERATURE    "esp.param.temperature"
+
+#define ESP_RMAKER_DEVICE_LIGHTBULB     "esp.device.lightbulb"
+#define ESP_RMAKER_DEVICE_TEMP_SENSOR   "esp.device.temperature-sensor"
@@ -0,0 +1,14 @@
+/* Host build: ROM busy-wait, it advances the virtual clock */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void esp_rom_delay_us(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+/* Host build: esp_system.h */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_idf_version.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void esp_restart(void);
+uint32_t esp_get_free_heap_size(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,196 @@
+/* Host build: recording and control API of the IDF/RainMaker stub layer
+ *
+ * Every stubbed driver call that matters for performance is counted here,
+ * stamped with the virtual time it happened at, and appended to a small
+ * trace ring. Time is virtual: blocking calls (vTaskDelay, I2C transfers,
+ * waiting for RMT) advance the clock instead of sleeping, and esp_timer
+ * callbacks only run from stub_advance_us() or stub_esp_timer_fire().
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_rmaker_core.h"
+#include "driver/i2c.h"
+#include "driver/rmt.h"
+#include "esp_event.h"
+#include "esp_partition.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    STUB_EV_GPIO_SET = 0,     /*!< units: level */
+    STUB_EV_RMT_WRITE,        /*!< one frame handed to the RMT, units: source bytes */
+    STUB_EV_RMT_TRANSLATE,    /*!< one translator (ISR) call, units: items produced */
+    STUB_EV_RMT_WIRE,         /*!< units: us the channel is busy transmitting */
+    STUB_EV_RMT_WAIT,         /*!< units: us a caller was blocked waiting for TX done */
+    STUB_EV_I2C_XFER,         /*!< one i2c_master_cmd_begin, units: bytes on the bus */
+    STUB_EV_I2C_BUS,          /*!< units: us of bus time */
+    STUB_EV_I2C_INSTALL,
+    STUB_EV_I2C_DELETE,
+    STUB_EV_I2C_PARAM_CONFIG,
+    STUB_EV_I2C_TIMING,       /*!< one i2c_set_*_timing, i2c_set_period or i2c_set_timeout */
+    STUB_EV_HEAP_ALLOC,       /*!< allocations made by stubbed IDF APIs */
+    STUB_EV_HEAP_FREE,
+    STUB_EV_MUTEX_CREATE,
+    STUB_EV_MUTEX_DELETE,
+    STUB_EV_TASK_DELAY,       /*!< units: us */
+    STUB_EV_TASK_NOTIFY,      /*!< one xTaskNotifyGive */
+    STUB_EV_TIMER_CB,         /*!< one esp_timer callback, units: us of virtual time it occupied the timer task */
+    STUB_EV_RMAKER_PUBLISH,   /*!< one node params message */
+    STUB_EV_RMAKER_PARAM,     /*!< units: params carried by the messages */
+    STUB_EV_RMAKER_MQTT,      /*!< one esp_rmaker_mqtt_publish, units: payload bytes */
+    STUB_EV_FLASH_READ,       /*!< one esp_partition_read, units: bytes */
+    STUB_EV_FLASH_WRITE,      /*!< one esp_partition_write, units: bytes */
+    STUB_EV_FLASH_ERASE,      /*!< one esp_partition_erase_range, units: sectors */
+    STUB_EV_MAX
+} stub_event_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t units;
+    uint64_t cycles;          /*!< host cycles measured around the event, when measured */
+    uint64_t last_us;         /*!< virtual timestamp of the last occurrence */
+} stub_counter_t;
+
+typedef struct {
+    uint64_t time_us;
+    stub_event_t event;
+    uint32_t units;
+} stub_trace_entry_t;
+
+#define STUB_TRACE_LEN 1024
+
+/* ---- Time and cycles ---- */
+
+/** Host cycle counter (TSC on x86, nanoseconds elsewhere) */
+uint64_t stub_cycles(void);
+
+/** Current virtual time in microseconds */
+uint64_t stub_now_us(void);
+
+/** time() at virtual time 0: the wall clock runs on the virtual clock */
+#define STUB_EPOCH_S 1700000000
+
+/** Run the system for `us`: ISR events and esp_timer callbacks fire in time order */
+void stub_advance_us(uint64_t us);
+
+/** Block the calling context for `us`; only ISR events run meanwhile */
+void stub_block_us(uint64_t us);
+
+/**
+ * Block the calling context until `cond(arg)` holds or `timeout_us` elapses,
+ * running ISR events meanwhile. Returns the final value of the condition.
+ */
+bool stub_block_until(bool (*cond)(void *arg), void *arg, uint64_t timeout_us);
+
+/** Queue `fn(arg)` to run in "ISR context" at virtual time `at_us` */
+void stub_isr_schedule(uint64_t at_us, void (*fn)(void *arg), void *arg);
+
+/* ---- Recording ---- */
+
+void stub_record(stub_event_t event, uint64_t units, uint64_t cycles);
+const stub_counter_t *stub_counter(stub_event_t event);
+const char *stub_event_name(stub_event_t event);
+
+/** Copy the most recent trace entries (oldest first), returns how many were copied */
+size_t stub_trace_copy(stub_trace_entry_t *out, size_t max);
+
+/** Zero all counters and the trace; the virtual clock keeps running */
+void stub_reset_counters(void);
+
+/** Print non-zero counters, one per line */
+void stub_dump_counters(const char *title);
+
+/* ---- esp_timer ---- */
+
+typedef struct {
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t busy_us;         /*!< virtual time spent inside the callback */
+    uint64_t max_busy_us;
+    uint64_t max_late_us;     /*!< worst delay between alarm and dispatch */
+} stub_timer_stats_t;
+
+esp_timer_handle_t stub_esp_timer_find(const char *name);
+/** Dispatch a timer callback now, as if its alarm had expired */
+void stub_esp_timer_fire(esp_timer_handle_t timer);
+const stub_timer_stats_t *stub_esp_timer_stats(esp_timer_handle_t timer);
+/** Virtual time the timer is armed for, meaningful while esp_timer_is_active() */
+uint64_t stub_esp_timer_alarm(esp_timer_handle_t timer);
+void stub_esp_timer_reset_stats(void);
+
+/* ---- RMT ---- */
+
+/** Capture every item translated on `channel` into `buf` (NULL disables) */
+void stub_rmt_capture(rmt_channel_t channel, rmt_item32_t *buf, size_t max_items);
+size_t stub_rmt_captured(rmt_channel_t channel);
+bool stub_rmt_busy(rmt_channel_t channel);
+
+/* ---- I2C ---- */
+
+typedef struct {
+    /** Master wrote `len` bytes after the address; return non-OK to NACK */
+    esp_err_t (*write)(void *ctx, const uint8_t *data, size_t len);
+    /** Master reads `len` bytes; return non-OK to NACK the address */
+    esp_err_t (*read)(void *ctx, uint8_t *data, size_t len);
+    void *ctx;
+} stub_i2c_slave_t;
+
+esp_err_t stub_i2c_attach(i2c_port_t port, uint8_t addr, const stub_i2c_slave_t *slave);
+void stub_i2c_detach_all(void);
+
+/* Simulated sensors on the bus */
+void sim_sht3x_attach(i2c_port_t port, uint8_t addr);
+void sim_sht3x_set(float temperature, float humidity);
+/* Free running at 1 mps, as an MCU-only reboot finds a sensor that kept power */
+void sim_sht3x_run_periodic(void);
+void sim_bh1750_attach(i2c_port_t port, uint8_t addr);
+void sim_bh1750_set_lux(float lux);
+bool sim_bh1750_powered(void);
+
+/* ---- GPIO ---- */
+
+int stub_gpio_level(gpio_num_t gpio);
+
+/* ---- RainMaker ---- */
+
+/** Deliver a cloud write to a device's write callback */
+esp_err_t stub_rmaker_write(const char *device_name, const char *param_name, esp_rmaker_param_val_t val);
+esp_rmaker_device_t *stub_rmaker_find_device(const char *device_name);
+/** Bring MQTT up or down: posts RMAKER_MQTT_EVENT_(DIS)CONNECTED, publishing fails while down */
+void stub_rmaker_set_connected(bool connected);
+/** Hand every successful esp_rmaker_mqtt_publish to `cb` (NULL disables) */
+void stub_rmaker_mqtt_capture(void (*cb)(const char *topic, const void *data, size_t len));
+
+/* ---- Events ---- */
+
+/** Run the handlers registered for the event, in the calling context */
+void stub_event_post(esp_event_base_t base, int32_t id, void *data);
+
+/* ---- Flash partitions ---- */
+
+/**
+ * Add a partition emulated in the file at `path`, created erased if it
+ * does not exist. The file keeps its content across calls, so adding the
+ * same path again after stub_partition_remove_all() is a reboot. Writes
+ * behave as NOR flash: they can only clear bits.
+ */
+const esp_partition_t *stub_partition_add(const char *label, esp_partition_type_t type,
+                                          esp_partition_subtype_t subtype, size_t size, const char *path);
+void stub_partition_remove_all(void);
+/** Cut the power after `bytes` more bytes are written: that write is torn and fails, so do all after it */
+void stub_partition_fail_after(const esp_partition_t *partition, int64_t bytes);
+/** Writes so far that tried to set a cleared bit, which NOR flash ignores */
+uint32_t stub_partition_dirty_writes(const esp_partition_t *partition);
+/** Times a 4 KB sector was erased */
+uint32_t stub_partition_erase_count(const esp_partition_t *partition, size_t sector);
+
+#ifdef __cplusplus
+}
+#endif
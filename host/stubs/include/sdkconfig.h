@@ -0,0 +1,8 @@
+/* Host build: minimal sdkconfig for compiling the firmware sources on Linux. */
+#pragma once
+
+#define CONFIG_IDF_TARGET_ESP32 1
+#define CONFIG_IDF_TARGET "esp32"
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ 240
+#define CONFIG_LOG_DEFAULT_LEVEL 2
@@ -0,0 +1,9 @@
+/* Host build: glibc's sys/cdefs.h plus the newlib __containerof used by IDF drivers */
+#pragma once
+
+#include_next <sys/cdefs.h>
+#include <stddef.h>
+
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif
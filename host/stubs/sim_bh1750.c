@@ -0,0 +1,106 @@
+/* Host build: simulated ROHM BH1750 on the stub I2C bus */
+#include <string.h>
+#include "stub_internal.h"
+
+#define BH1750_MT_DEFAULT 69
+
+typedef struct {
+    float lux;
+    bool powered;
+    bool continuous;
+    uint8_t resolution;       /* 0 = H, 1 = H2, 3 = L (opcode low bits) */
+    uint8_t mt;
+    uint8_t mt_pending_hi;
+    uint64_t ready_us;
+    uint16_t data;            /* data register, keeps the last result */
+} sim_bh1750_t;
+
+static sim_bh1750_t s_bh1750 = { .lux = 250.0f, .mt = BH1750_MT_DEFAULT };
+
+static uint64_t integration_us(const sim_bh1750_t *s)
+{
+    /* Typical 120 ms (H, H2) or 16 ms (L) at MTreg 69, scaling with MTreg */
+    uint64_t base = s->resolution == 3 ? 16000 : 120000;
+    return base * s->mt / BH1750_MT_DEFAULT;
+}
+
+static uint16_t convert(const sim_bh1750_t *s)
+{
+    /* counts = lux * 1.2 * MTreg / 69, doubled in H2 mode */
+    float counts = s->lux * 1.2f * s->mt / BH1750_MT_DEFAULT;
+    if (s->resolution == 1) {
+        counts *= 2.0f;
+    }
+    if (counts > 65535.0f) {
+        counts = 65535.0f;
+    }
+    uint16_t raw = (uint16_t)counts;
+    if (s->resolution == 3) {
+        raw &= ~0x3;
+    }
+    return raw;
+}
+
+static esp_err_t bh1750_write(void *ctx, const uint8_t *data, size_t len)
+{
+    sim_bh1750_t *s = ctx;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t op = data[i];
+        if (op == 0x00) {
+            s->powered = false;
+        } else if (op == 0x01) {
+            s->powered = true;
+        } else if (op == 0x07) {
+            s->data = 0;
+        } else if ((op & 0xf8) == 0x40) {
+            s->mt_pending_hi = op & 0x07;
+        } else if ((op & 0xe0) == 0x60) {
+            s->mt = (s->mt_pending_hi << 5) | (op & 0x1f);
+            if (s->mt < 31) {
+                s->mt = 31;
+            }
+        } else if ((op & 0xf0) == 0x10 || (op & 0xf0) == 0x20) {
+            s->powered = true;
+            s->continuous = (op & 0xf0) == 0x10;
+            s->resolution = op & 0x03;
+            s->ready_us = stub_now_us() + integration_us(s);
+        } else {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t bh1750_read(void *ctx, uint8_t *data, size_t len)
+{
+    sim_bh1750_t *s = ctx;
+    if (s->ready_us && stub_now_us() >= s->ready_us) {
+        s->data = convert(s);
+        if (s->continuous) {
+            s->ready_us = stub_now_us() + integration_us(s);
+        } else {
+            /* One time mode powers down after the measurement */
+            s->ready_us = 0;
+            s->powered = false;
+        }
+    }
+    uint8_t out[2] = { s->data >> 8, s->data & 0xff };
+    memcpy(data, out, len < sizeof(out) ? len : sizeof(out));
+    return ESP_OK;
+}
+
+void sim_bh1750_attach(i2c_port_t port, uint8_t addr)
+{
+    stub_i2c_slave_t slave = { .write = bh1750_write, .read = bh1750_read, .ctx = &s_bh1750 };
+    stub_i2c_attach(port, addr, &slave);
+}
+
+void sim_bh1750_set_lux(float lux)
+{
+    s_bh1750.lux = lux;
+}
+
+bool sim_bh1750_powered(void)
+{
+    return s_bh1750.powered;
+}
@@ -0,0 +1,132 @@
+/* Host build: simulated Sensirion SHT3x on the stub I2C bus */
+#include <string.h>
+#include "stub_internal.h"
+
+typedef struct {
+    float temperature;
+    float humidity;
+    uint16_t last_cmd;
+    bool periodic;
+    uint64_t period_us;
+    uint64_t ready_us;        /* when the next (or only) sample becomes readable */
+    bool data_valid;
+} sim_sht3x_t;
+
+static sim_sht3x_t s_sht3x = { .temperature = 23.5f, .humidity = 45.0f };
+
+static uint8_t sht3x_crc(const uint8_t *data)
+{
+    uint8_t crc = 0xff;
+    for (int i = 0; i < 2; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void put_word(uint8_t *out, uint16_t word)
+{
+    out[0] = word >> 8;
+    out[1] = word & 0xff;
+    out[2] = sht3x_crc(out);
+}
+
+static uint64_t duration_us(uint8_t repeatability_lsb)
+{
+    /* Worst case conversion times from the datasheet, high/medium/low */
+    switch (repeatability_lsb) {
+    case 0x00: case 0x32: case 0x30: case 0x36: case 0x34: case 0x37:
+        return 15500;
+    case 0x0b: case 0x24: case 0x26: case 0x20: case 0x22: case 0x21:
+        return 6500;
+    default:
+        return 4500;
+    }
+}
+
+static esp_err_t sht3x_write(void *ctx, const uint8_t *data, size_t len)
+{
+    sim_sht3x_t *s = ctx;
+    if (len < 2) {
+        return ESP_FAIL;
+    }
+    uint16_t cmd = (data[0] << 8) | data[1];
+    s->last_cmd = cmd;
+    uint8_t msb = cmd >> 8;
+    uint64_t now = stub_now_us();
+
+    if (cmd == 0x30A2 && s->periodic) {
+        /* Soft reset is only accepted once idle: a break has to come first */
+        return ESP_FAIL;
+    } else if (cmd == 0x30A2 || cmd == 0x3093) {
+        /* soft reset / break: back to single shot idle */
+        s->periodic = false;
+        s->data_valid = false;
+    } else if (msb == 0x24 || msb == 0x2C) {
+        s->periodic = false;
+        s->ready_us = now + duration_us(cmd & 0xff);
+        s->data_valid = true;
+    } else if (msb >= 0x20 && msb <= 0x27) {
+        static const uint64_t periods[] = { 2000000, 1000000, 500000, 250000, 0, 0, 0, 100000 };
+        s->periodic = true;
+        s->period_us = periods[msb - 0x20] ? periods[msb - 0x20] : 1000000;
+        /* The first result comes a whole period after the start */
+        s->ready_us = now + s->period_us;
+        s->data_valid = true;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sht3x_read(void *ctx, uint8_t *data, size_t len)
+{
+    sim_sht3x_t *s = ctx;
+    uint8_t out[6];
+    memset(out, 0, sizeof(out));
+
+    if (s->last_cmd == 0xF32D) {
+        put_word(out, 0x8010);
+    } else if (s->last_cmd == 0xE000) {
+        /* No data available: the sensor NACKs the read header */
+        if (!s->data_valid || stub_now_us() < s->ready_us) {
+            return ESP_FAIL;
+        }
+        float t = s->temperature < -45.0f ? -45.0f : s->temperature > 130.0f ? 130.0f : s->temperature;
+        float h = s->humidity < 0.0f ? 0.0f : s->humidity > 100.0f ? 100.0f : s->humidity;
+        put_word(out, (uint16_t)((t + 45.0f) * 65535.0f / 175.0f + 0.5f));
+        put_word(out + 3, (uint16_t)(h * 65535.0f / 100.0f + 0.5f));
+        if (s->periodic) {
+            while (s->ready_us <= stub_now_us()) {
+                s->ready_us += s->period_us;
+            }
+        } else {
+            s->data_valid = false;
+        }
+    } else {
+        return ESP_FAIL;
+    }
+    memcpy(data, out, len < sizeof(out) ? len : sizeof(out));
+    return ESP_OK;
+}
+
+void sim_sht3x_attach(i2c_port_t port, uint8_t addr)
+{
+    stub_i2c_slave_t slave = { .write = sht3x_write, .read = sht3x_read, .ctx = &s_sht3x };
+    stub_i2c_attach(port, addr, &slave);
+}
+
+void sim_sht3x_run_periodic(void)
+{
+    s_sht3x.periodic = true;
+    s_sht3x.period_us = 1000000;
+    s_sht3x.ready_us = stub_now_us();
+    s_sht3x.data_valid = true;
+    s_sht3x.last_cmd = 0x2130;
+}
+
+void sim_sht3x_set(float temperature, float humidity)
+{
+    s_sht3x.temperature = temperature;
+    s_sht3x.humidity = humidity;
+}
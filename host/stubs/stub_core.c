@@ -0,0 +1,214 @@
+/* Host build: virtual clock, ISR event queue, counters and trace */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "stub_internal.h"
+
+#define STUB_ISR_EVENTS_MAX 64
+
+typedef struct {
+    uint64_t at_us;
+    void (*fn)(void *arg);
+    void *arg;
+} stub_isr_event_t;
+
+static uint64_t s_now_us;
+static stub_isr_event_t s_isr_events[STUB_ISR_EVENTS_MAX];
+static size_t s_isr_count;
+
+static stub_counter_t s_counters[STUB_EV_MAX];
+static stub_trace_entry_t s_trace[STUB_TRACE_LEN];
+static size_t s_trace_head;
+static size_t s_trace_len;
+
+static const char *const s_event_names[STUB_EV_MAX] = {
+    [STUB_EV_GPIO_SET]         = "gpio_set_level",
+    [STUB_EV_RMT_WRITE]        = "rmt_write",
+    [STUB_EV_RMT_TRANSLATE]    = "rmt_translate",
+    [STUB_EV_RMT_WIRE]         = "rmt_wire_us",
+    [STUB_EV_RMT_WAIT]         = "rmt_wait_us",
+    [STUB_EV_I2C_XFER]         = "i2c_xfer",
+    [STUB_EV_I2C_BUS]          = "i2c_bus_us",
+    [STUB_EV_I2C_INSTALL]      = "i2c_driver_install",
+    [STUB_EV_I2C_DELETE]       = "i2c_driver_delete",
+    [STUB_EV_I2C_PARAM_CONFIG] = "i2c_param_config",
+    [STUB_EV_I2C_TIMING]       = "i2c_set_timing",
+    [STUB_EV_HEAP_ALLOC]       = "heap_alloc",
+    [STUB_EV_HEAP_FREE]        = "heap_free",
+    [STUB_EV_MUTEX_CREATE]     = "mutex_create",
+    [STUB_EV_MUTEX_DELETE]     = "mutex_delete",
+    [STUB_EV_TASK_DELAY]       = "task_delay_us",
+    [STUB_EV_TASK_NOTIFY]      = "task_notify",
+    [STUB_EV_TIMER_CB]         = "timer_cb",
+    [STUB_EV_RMAKER_PUBLISH]   = "rmaker_publish",
+    [STUB_EV_RMAKER_PARAM]     = "rmaker_param",
+    [STUB_EV_RMAKER_MQTT]      = "rmaker_mqtt_publish",
+    [STUB_EV_FLASH_READ]       = "flash_read",
+    [STUB_EV_FLASH_WRITE]      = "flash_write",
+    [STUB_EV_FLASH_ERASE]      = "flash_erase_sectors",
+};
+
+uint64_t stub_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+uint64_t stub_now_us(void)
+{
+    return s_now_us;
+}
+
+void stub_set_now_us(uint64_t now_us)
+{
+    if (now_us > s_now_us) {
+        s_now_us = now_us;
+    }
+}
+
+void stub_isr_schedule(uint64_t at_us, void (*fn)(void *arg), void *arg)
+{
+    if (s_isr_count == STUB_ISR_EVENTS_MAX) {
+        fprintf(stderr, "stub: ISR event queue overflow\n");
+        abort();
+    }
+    s_isr_events[s_isr_count].at_us = at_us;
+    s_isr_events[s_isr_count].fn = fn;
+    s_isr_events[s_isr_count].arg = arg;
+    s_isr_count++;
+}
+
+static bool isr_next(size_t *index)
+{
+    if (!s_isr_count) {
+        return false;
+    }
+    size_t best = 0;
+    for (size_t i = 1; i < s_isr_count; i++) {
+        if (s_isr_events[i].at_us < s_isr_events[best].at_us) {
+            best = i;
+        }
+    }
+    *index = best;
+    return true;
+}
+
+static void isr_run(size_t index)
+{
+    stub_isr_event_t ev = s_isr_events[index];
+    s_isr_events[index] = s_isr_events[--s_isr_count];
+    stub_set_now_us(ev.at_us);
+    ev.fn(ev.arg);
+}
+
+/* Run ISR events due up to `until_us`, optionally stopping early on `cond` */
+static bool run_isrs_until(uint64_t until_us, bool (*cond)(void *arg), void *arg)
+{
+    size_t index;
+    while (!(cond && cond(arg)) && isr_next(&index) && s_isr_events[index].at_us <= until_us) {
+        isr_run(index);
+    }
+    return cond && cond(arg);
+}
+
+void stub_block_us(uint64_t us)
+{
+    uint64_t until = s_now_us + us;
+    run_isrs_until(until, NULL, NULL);
+    stub_set_now_us(until);
+}
+
+bool stub_block_until(bool (*cond)(void *arg), void *arg, uint64_t timeout_us)
+{
+    uint64_t until = s_now_us + timeout_us;
+    if (run_isrs_until(until, cond, arg)) {
+        return true;
+    }
+    stub_set_now_us(until);
+    return cond(arg);
+}
+
+void stub_advance_us(uint64_t us)
+{
+    uint64_t until = s_now_us + us;
+    for (;;) {
+        size_t index;
+        uint64_t alarm;
+        bool have_isr = isr_next(&index) && s_isr_events[index].at_us <= until;
+        bool have_timer = stub_timer_next_alarm(&alarm) && alarm <= until;
+        if (have_isr && (!have_timer || s_isr_events[index].at_us <= alarm)) {
+            isr_run(index);
+        } else if (have_timer) {
+            stub_set_now_us(alarm);
+            stub_timer_dispatch_next();
+        } else {
+            break;
+        }
+    }
+    stub_set_now_us(until);
+}
+
+void stub_record(stub_event_t event, uint64_t units, uint64_t cycles)
+{
+    stub_counter_t *c = &s_counters[event];
+    c->count++;
+    c->units += units;
+    c->cycles += cycles;
+    c->last_us = s_now_us;
+
+    stub_trace_entry_t *t = &s_trace[s_trace_head];
+    t->time_us = s_now_us;
+    t->event = event;
+    t->units = (uint32_t)units;
+    s_trace_head = (s_trace_head + 1) % STUB_TRACE_LEN;
+    if (s_trace_len < STUB_TRACE_LEN) {
+        s_trace_len++;
+    }
+}
+
+const stub_counter_t *stub_counter(stub_event_t event)
+{
+    return &s_counters[event];
+}
+
+const char *stub_event_name(stub_event_t event)
+{
+    return event < STUB_EV_MAX ? s_event_names[event] : "?";
+}
+
+size_t stub_trace_copy(stub_trace_entry_t *out, size_t max)
+{
+    size_t n = s_trace_len < max ? s_trace_len : max;
+    size_t start = (s_trace_head + STUB_TRACE_LEN - n) % STUB_TRACE_LEN;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = s_trace[(start + i) % STUB_TRACE_LEN];
+    }
+    return n;
+}
+
+void stub_reset_counters(void)
+{
+    memset(s_counters, 0, sizeof(s_counters));
+    s_trace_head = 0;
+    s_trace_len = 0;
+}
+
+void stub_dump_counters(const char *title)
+{
+    printf("  -- %s --\n", title);
+    for (int i = 0; i < STUB_EV_MAX; i++) {
+        const stub_counter_t *c = &s_counters[i];
+        if (c->count) {
+            printf("  %-20s count=%-8llu units=%-10llu cycles=%llu\n", s_event_names[i],
+                   (unsigned long long)c->count, (unsigned long long)c->units, (unsigned long long)c->cycles);
+        }
+    }
+}
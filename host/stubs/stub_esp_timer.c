@@ -0,0 +1,193 @@
+/* Host build: esp_timer on the virtual clock */
+#include <stdlib.h>
+#include <string.h>
+#include "stub_internal.h"
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    bool armed;
+    uint64_t alarm_us;
+    uint64_t period_us;       /* 0 for one-shot */
+    stub_timer_stats_t stats;
+    struct esp_timer *next;
+};
+
+static struct esp_timer *s_timers;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->callback = create_args->callback;
+    t->arg = create_args->arg;
+    t->name = create_args->name;
+    t->next = s_timers;
+    s_timers = t;
+    *out_handle = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->period_us = 0;
+    timer->alarm_us = stub_now_us() + timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (!timer || !period) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->period_us = period;
+    timer->alarm_us = stub_now_us() + period;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (struct esp_timer **p = &s_timers; *p; p = &(*p)->next) {
+        if (*p == timer) {
+            *p = timer->next;
+            break;
+        }
+    }
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer && timer->armed;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)stub_now_us();
+}
+
+static void timer_run(struct esp_timer *t, uint64_t late_us)
+{
+    uint64_t start_us = stub_now_us();
+    uint64_t start = stub_cycles();
+    t->callback(t->arg);
+    uint64_t cycles = stub_cycles() - start;
+    uint64_t busy_us = stub_now_us() - start_us;
+
+    t->stats.count++;
+    t->stats.cycles += cycles;
+    t->stats.busy_us += busy_us;
+    if (busy_us > t->stats.max_busy_us) {
+        t->stats.max_busy_us = busy_us;
+    }
+    if (late_us > t->stats.max_late_us) {
+        t->stats.max_late_us = late_us;
+    }
+    stub_record(STUB_EV_TIMER_CB, busy_us, cycles);
+}
+
+bool stub_timer_next_alarm(uint64_t *alarm_us)
+{
+    bool found = false;
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+        if (t->armed && (!found || t->alarm_us < *alarm_us)) {
+            *alarm_us = t->alarm_us;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void stub_timer_dispatch_next(void)
+{
+    struct esp_timer *due = NULL;
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+        if (t->armed && (!due || t->alarm_us < due->alarm_us)) {
+            due = t;
+        }
+    }
+    if (!due || due->alarm_us > stub_now_us()) {
+        return;
+    }
+    uint64_t late_us = stub_now_us() - due->alarm_us;
+    if (due->period_us) {
+        due->alarm_us += due->period_us;
+    } else {
+        due->armed = false;
+    }
+    timer_run(due, late_us);
+}
+
+esp_timer_handle_t stub_esp_timer_find(const char *name)
+{
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+        if (t->name && strcmp(t->name, name) == 0) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+void stub_esp_timer_fire(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return;
+    }
+    if (timer->armed && !timer->period_us) {
+        timer->armed = false;
+    }
+    timer_run(timer, 0);
+}
+
+const stub_timer_stats_t *stub_esp_timer_stats(esp_timer_handle_t timer)
+{
+    return &timer->stats;
+}
+
+uint64_t stub_esp_timer_alarm(esp_timer_handle_t timer)
+{
+    return timer->alarm_us;
+}
+
+void stub_esp_timer_reset_stats(void)
+{
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+        memset(&t->stats, 0, sizeof(t->stats));
+    }
+}
@@ -0,0 +1,152 @@
+/* Host build: FreeRTOS tasks and semaphores without a scheduler */
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "stub_internal.h"
+
+struct stub_task {
+    TaskFunction_t fn;
+    void *arg;
+    const char *name;
+};
+
+struct stub_semaphore {
+    UBaseType_t count;
+};
+
+static uint64_t ticks_to_us(TickType_t ticks)
+{
+    return (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                                   void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pvCreatedTask,
+                                   const BaseType_t xCoreID)
+{
+    struct stub_task *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return pdFAIL;
+    }
+    stub_record(STUB_EV_HEAP_ALLOC, usStackDepth, 0);
+    t->fn = pvTaskCode;
+    t->arg = pvParameters;
+    t->name = pcName;
+    if (pvCreatedTask) {
+        *pvCreatedTask = t;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                       void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pvCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask,
+                                   tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    if (xTaskToDelete) {
+        stub_record(STUB_EV_HEAP_FREE, 0, 0);
+        free(xTaskToDelete);
+    }
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    uint64_t us = ticks_to_us(xTicksToDelay);
+    stub_record(STUB_EV_TASK_DELAY, us, 0);
+    stub_block_us(us);
+}
+
+void vTaskDelayUntil(TickType_t *const pxPreviousWakeTime, const TickType_t xTimeIncrement)
+{
+    *pxPreviousWakeTime += xTimeIncrement;
+    uint64_t wake_us = ticks_to_us(*pxPreviousWakeTime);
+    if (wake_us > stub_now_us()) {
+        vTaskDelay((TickType_t)((wake_us - stub_now_us()) / 1000 / portTICK_PERIOD_MS));
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(stub_now_us() / 1000 / portTICK_PERIOD_MS);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    vTaskDelay(xTicksToWait);
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    stub_record(STUB_EV_TASK_NOTIFY, 0, 0);
+    return pdPASS;
+}
+
+static SemaphoreHandle_t semaphore_create(UBaseType_t count)
+{
+    SemaphoreHandle_t sem = calloc(1, sizeof(*sem));
+    if (sem) {
+        sem->count = count;
+        stub_record(STUB_EV_MUTEX_CREATE, 0, 0);
+        stub_record(STUB_EV_HEAP_ALLOC, sizeof(*sem), 0);
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_create(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_create(0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+    if (xSemaphore) {
+        stub_record(STUB_EV_MUTEX_DELETE, 0, 0);
+        stub_record(STUB_EV_HEAP_FREE, 0, 0);
+        free(xSemaphore);
+    }
+}
+
+static bool semaphore_available(void *arg)
+{
+    return ((SemaphoreHandle_t)arg)->count > 0;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    if (!xSemaphore) {
+        return pdFALSE;
+    }
+    /* Only an ISR can give a semaphore while the single host thread is blocked */
+    if (!xSemaphore->count && !stub_block_until(semaphore_available, xSemaphore, ticks_to_us(xBlockTime))) {
+        return pdFALSE;
+    }
+    xSemaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    if (!xSemaphore || xSemaphore->count) {
+        return pdFALSE;
+    }
+    xSemaphore->count++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken) {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+    return xSemaphoreGive(xSemaphore);
+}
@@ -0,0 +1,30 @@
+/* Host build: GPIO levels */
+#include "driver/gpio.h"
+#include "stub_internal.h"
+
+static int s_levels[GPIO_NUM_MAX];
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig)
+{
+    return pGPIOConfig ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_levels[gpio_num] = level ? 1 : 0;
+    stub_record(STUB_EV_GPIO_SET, level ? 1 : 0, 0);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return stub_gpio_level(gpio_num);
+}
+
+int stub_gpio_level(gpio_num_t gpio)
+{
+    return (gpio >= 0 && gpio < GPIO_NUM_MAX) ? s_levels[gpio] : 0;
+}
@@ -0,0 +1,367 @@
+/* Host build: I2C master driver executing command links against simulated slaves */
+#include <stdlib.h>
+#include <string.h>
+#include "driver/i2c.h"
+#include "stub_internal.h"
+
+#define STUB_I2C_SLAVES_MAX 8
+
+typedef enum {
+    CMD_START,
+    CMD_WRITE,
+    CMD_READ,
+    CMD_STOP,
+} cmd_op_t;
+
+typedef struct cmd_node {
+    cmd_op_t op;
+    uint8_t byte;             /* single byte writes keep their data inline */
+    const uint8_t *data;
+    uint8_t *rdata;
+    size_t len;
+    i2c_ack_type_t ack;
+    struct cmd_node *next;
+} cmd_node_t;
+
+typedef struct {
+    cmd_node_t *head;
+    cmd_node_t *tail;
+    bool is_static;
+    uint8_t *free_ptr;        /* static links: next free byte in the caller buffer */
+    uint8_t *end;
+} cmd_link_t;
+
+_Static_assert(sizeof(cmd_node_t) <= I2C_INTERNAL_STRUCT_SIZE, "I2C_INTERNAL_STRUCT_SIZE too small");
+_Static_assert(sizeof(cmd_link_t) <= 2 * I2C_INTERNAL_STRUCT_SIZE, "I2C_INTERNAL_STRUCT_SIZE too small");
+
+typedef struct {
+    bool installed;
+    i2c_config_t config;
+    struct {
+        uint8_t addr;
+        stub_i2c_slave_t slave;
+    } slaves[STUB_I2C_SLAVES_MAX];
+    size_t slave_count;
+} stub_i2c_port_t;
+
+static stub_i2c_port_t s_ports[I2C_NUM_MAX];
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || !i2c_conf) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ports[i2c_num].config = *i2c_conf;
+    stub_record(STUB_EV_I2C_PARAM_CONFIG, i2c_conf->master.clk_speed, 0);
+    return ESP_OK;
+}
+
+/* The bus clock follows the SCL period, the other timing registers only get counted */
+esp_err_t i2c_set_period(i2c_port_t i2c_num, int high_period, int low_period)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || high_period <= 0 || low_period <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ports[i2c_num].config.master.clk_speed = I2C_APB_CLK_FREQ / (high_period + low_period);
+    stub_record(STUB_EV_I2C_TIMING, 1, 0);
+    return ESP_OK;
+}
+
+static esp_err_t set_timing(i2c_port_t i2c_num, int a, int b)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || a < 0 || b < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stub_record(STUB_EV_I2C_TIMING, 1, 0);
+    return ESP_OK;
+}
+
+esp_err_t i2c_set_start_timing(i2c_port_t i2c_num, int setup_time, int hold_time)
+{
+    return set_timing(i2c_num, setup_time, hold_time);
+}
+
+esp_err_t i2c_set_stop_timing(i2c_port_t i2c_num, int setup_time, int hold_time)
+{
+    return set_timing(i2c_num, setup_time, hold_time);
+}
+
+esp_err_t i2c_set_data_timing(i2c_port_t i2c_num, int sample_time, int hold_time)
+{
+    return set_timing(i2c_num, sample_time, hold_time);
+}
+
+esp_err_t i2c_set_timeout(i2c_port_t i2c_num, int timeout)
+{
+    return set_timing(i2c_num, timeout, 0);
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len,
+                             int intr_alloc_flags)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_ports[i2c_num].installed) {
+        return ESP_FAIL;
+    }
+    s_ports[i2c_num].installed = true;
+    stub_record(STUB_EV_I2C_INSTALL, 0, 0);
+    stub_record(STUB_EV_HEAP_ALLOC, 0, 0);
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || !s_ports[i2c_num].installed) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ports[i2c_num].installed = false;
+    stub_record(STUB_EV_I2C_DELETE, 0, 0);
+    stub_record(STUB_EV_HEAP_FREE, 0, 0);
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    cmd_link_t *link = calloc(1, sizeof(*link));
+    if (link) {
+        stub_record(STUB_EV_HEAP_ALLOC, sizeof(*link), 0);
+    }
+    return link;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size)
+{
+    if (!buffer || size < sizeof(cmd_link_t)) {
+        return NULL;
+    }
+    cmd_link_t *link = (cmd_link_t *)buffer;
+    memset(link, 0, sizeof(*link));
+    link->is_static = true;
+    link->free_ptr = buffer + sizeof(cmd_link_t);
+    link->end = buffer + size;
+    return link;
+}
+
+static void link_free_nodes(cmd_link_t *link)
+{
+    cmd_node_t *node = link->head;
+    while (node) {
+        cmd_node_t *next = node->next;
+        if (!link->is_static) {
+            stub_record(STUB_EV_HEAP_FREE, 0, 0);
+            free(node);
+        }
+        node = next;
+    }
+    link->head = link->tail = NULL;
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle)
+{
+    cmd_link_t *link = cmd_handle;
+    if (!link) {
+        return;
+    }
+    link_free_nodes(link);
+    if (!link->is_static) {
+        stub_record(STUB_EV_HEAP_FREE, 0, 0);
+        free(link);
+    }
+}
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd_handle)
+{
+    i2c_cmd_link_delete(cmd_handle);
+}
+
+static esp_err_t link_append(i2c_cmd_handle_t cmd_handle, const cmd_node_t *proto)
+{
+    cmd_link_t *link = cmd_handle;
+    if (!link) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cmd_node_t *node;
+    if (link->is_static) {
+        size_t align = (uintptr_t)link->free_ptr % sizeof(void *);
+        uint8_t *p = link->free_ptr + (align ? sizeof(void *) - align : 0);
+        if (p + sizeof(cmd_node_t) > link->end) {
+            return ESP_ERR_NO_MEM;
+        }
+        node = (cmd_node_t *)p;
+        link->free_ptr = p + sizeof(cmd_node_t);
+    } else {
+        node = malloc(sizeof(*node));
+        if (!node) {
+            return ESP_ERR_NO_MEM;
+        }
+        stub_record(STUB_EV_HEAP_ALLOC, sizeof(*node), 0);
+    }
+    *node = *proto;
+    node->next = NULL;
+    if (link->tail) {
+        link->tail->next = node;
+    } else {
+        link->head = node;
+    }
+    link->tail = node;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+    cmd_node_t n = { .op = CMD_START };
+    return link_append(cmd_handle, &n);
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en)
+{
+    cmd_node_t n = { .op = CMD_WRITE, .byte = data, .len = 1 };
+    return link_append(cmd_handle, &n);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en)
+{
+    if (!data || !data_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cmd_node_t n = { .op = CMD_WRITE, .data = data, .len = data_len };
+    return link_append(cmd_handle, &n);
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack)
+{
+    if (!data || !data_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cmd_node_t n = { .op = CMD_READ, .rdata = data, .len = data_len, .ack = ack };
+    return link_append(cmd_handle, &n);
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+    cmd_node_t n = { .op = CMD_STOP };
+    return link_append(cmd_handle, &n);
+}
+
+static stub_i2c_slave_t *find_slave(stub_i2c_port_t *port, uint8_t addr)
+{
+    for (size_t i = 0; i < port->slave_count; i++) {
+        if (port->slaves[i].addr == addr) {
+            return &port->slaves[i].slave;
+        }
+    }
+    return NULL;
+}
+
+/* Deliver bytes written since the last START (address byte excluded) */
+static esp_err_t flush_write(stub_i2c_slave_t *slave, const uint8_t *buf, size_t len)
+{
+    if (!slave || !len || !slave->write) {
+        return ESP_OK;
+    }
+    return slave->write(slave->ctx, buf, len);
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || !cmd_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stub_i2c_port_t *port = &s_ports[i2c_num];
+    if (!port->installed) {
+        return ESP_FAIL;
+    }
+
+    uint8_t wbuf[64];
+    size_t wlen = 0;
+    bool expect_addr = false;
+    stub_i2c_slave_t *slave = NULL;
+    size_t bytes = 0;
+    size_t conditions = 0;
+    esp_err_t res = ESP_OK;
+
+    uint64_t start = stub_cycles();
+    for (cmd_node_t *n = ((cmd_link_t *)cmd_handle)->head; n && res == ESP_OK; n = n->next) {
+        switch (n->op) {
+        case CMD_START:
+            res = flush_write(slave, wbuf, wlen);
+            wlen = 0;
+            expect_addr = true;
+            conditions++;
+            break;
+        case CMD_WRITE: {
+            const uint8_t *data = n->data ? n->data : &n->byte;
+            size_t i = 0;
+            bytes += n->len;
+            if (expect_addr) {
+                slave = find_slave(port, data[0] >> 1);
+                expect_addr = false;
+                i = 1;
+                if (!slave) {
+                    res = ESP_FAIL; /* address NACK */
+                    break;
+                }
+                if (data[0] & 1) {
+                    wlen = 0;
+                    break;
+                }
+            }
+            for (; i < n->len && wlen < sizeof(wbuf); i++) {
+                wbuf[wlen++] = data[i];
+            }
+            break;
+        }
+        case CMD_READ:
+            bytes += n->len;
+            if (!slave || !slave->read) {
+                res = ESP_FAIL;
+                break;
+            }
+            res = slave->read(slave->ctx, n->rdata, n->len);
+            break;
+        case CMD_STOP:
+            res = flush_write(slave, wbuf, wlen);
+            wlen = 0;
+            conditions++;
+            break;
+        }
+    }
+    uint64_t cycles = stub_cycles() - start;
+
+    /* 9 clocks per byte plus roughly one clock per START/STOP */
+    uint32_t clk = port->config.master.clk_speed ? port->config.master.clk_speed : 100000;
+    uint64_t bus_us = ((bytes * 9 + conditions) * 1000000ULL + clk - 1) / clk;
+    stub_record(STUB_EV_I2C_XFER, bytes, cycles);
+    stub_record(STUB_EV_I2C_BUS, bus_us, 0);
+    stub_block_us(bus_us);
+    return res;
+}
+
+esp_err_t stub_i2c_attach(i2c_port_t port, uint8_t addr, const stub_i2c_slave_t *slave)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || !slave) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stub_i2c_port_t *p = &s_ports[port];
+    stub_i2c_slave_t *existing = find_slave(p, addr);
+    if (existing) {
+        *existing = *slave;
+        return ESP_OK;
+    }
+    if (p->slave_count == STUB_I2C_SLAVES_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    p->slaves[p->slave_count].addr = addr;
+    p->slaves[p->slave_count].slave = *slave;
+    p->slave_count++;
+    return ESP_OK;
+}
+
+void stub_i2c_detach_all(void)
+{
+    for (int i = 0; i < I2C_NUM_MAX; i++) {
+        s_ports[i].slave_count = 0;
+    }
+}
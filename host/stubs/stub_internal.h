@@ -0,0 +1,13 @@
+/* Host build: glue shared between the stub translation units */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "host_stub.h"
+
+/* Earliest armed esp_timer alarm, false when none is armed */
+bool stub_timer_next_alarm(uint64_t *alarm_us);
+/* Dispatch the timer whose alarm is earliest (and due at the current time) */
+void stub_timer_dispatch_next(void);
+
+void stub_set_now_us(uint64_t now_us);
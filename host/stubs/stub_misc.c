@@ -0,0 +1,168 @@
+/* Host build: NVS, Wi-Fi, button, logging and other leaf stubs */
+#include <stdlib.h>
+#include <time.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_rom_sys.h"
+#include "nvs_flash.h"
+#include "app_wifi.h"
+#include "iot_button.h"
+#include "app_reset.h"
+#include "esp_event.h"
+#include "stub_internal.h"
+
+#define STUB_EVENT_HANDLERS_MAX 16
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} stub_event_handler_t;
+
+static stub_event_handler_t s_event_handlers[STUB_EVENT_HANDLERS_MAX];
+static size_t s_event_handler_count;
+
+esp_log_level_t stub_log_level = (esp_log_level_t)CONFIG_LOG_DEFAULT_LEVEL;
+
+/* Symbol of the embedded OTA server certificate (target_add_binary_data) */
+const char stub_server_crt_start[] __asm__("_binary_server_crt_start") = "";
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                    return "ESP_OK";
+    case ESP_FAIL:                  return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:       return "ESP_ERR_INVALID_CRC";
+    default:                        return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    stub_log_level = level;
+}
+
+/* Wall clock on the virtual clock, from a fixed date, so timestamps repeat from run to run */
+time_t time(time_t *t)
+{
+    time_t now = STUB_EPOCH_S + (time_t)(stub_now_us() / 1000000);
+    if (t) {
+        *t = now;
+    }
+    return now;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(stub_now_us() / 1000);
+}
+
+void esp_restart(void)
+{
+    abort();
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    stub_block_us(us);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    const stub_counter_t *alloc = stub_counter(STUB_EV_HEAP_ALLOC);
+    const stub_counter_t *freed = stub_counter(STUB_EV_HEAP_FREE);
+    return 320 * 1024 - (uint32_t)(alloc->count - freed->count);
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    if (!event_handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_event_handler_count == STUB_EVENT_HANDLERS_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    stub_event_handler_t *h = &s_event_handlers[s_event_handler_count++];
+    h->base = event_base;
+    h->id = event_id;
+    h->handler = event_handler;
+    h->arg = event_handler_arg;
+    return ESP_OK;
+}
+
+void stub_event_post(esp_event_base_t base, int32_t id, void *data)
+{
+    for (size_t i = 0; i < s_event_handler_count; i++) {
+        stub_event_handler_t *h = &s_event_handlers[i];
+        if (h->base == base && (h->id == ESP_EVENT_ANY_ID || h->id == id)) {
+            h->handler(h->arg, base, id, data);
+        }
+    }
+}
+
+void app_wifi_init(void)
+{
+}
+
+esp_err_t app_wifi_start(app_wifi_pop_type_t pop_type)
+{
+    return ESP_OK;
+}
+
+typedef struct {
+    gpio_num_t gpio;
+    button_cb cb[BUTTON_CB_SERIAL + 1];
+    void *arg[BUTTON_CB_SERIAL + 1];
+} stub_button_t;
+
+button_handle_t iot_button_create(gpio_num_t gpio_num, button_active_t active_level)
+{
+    stub_button_t *b = calloc(1, sizeof(*b));
+    if (b) {
+        b->gpio = gpio_num;
+    }
+    return b;
+}
+
+esp_err_t iot_button_set_evt_cb(button_handle_t btn_handle, button_cb_type_t type, button_cb cb, void *arg)
+{
+    stub_button_t *b = btn_handle;
+    if (!b || type > BUTTON_CB_SERIAL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    b->cb[type] = cb;
+    b->arg[type] = arg;
+    return ESP_OK;
+}
+
+esp_err_t iot_button_delete(button_handle_t btn_handle)
+{
+    free(btn_handle);
+    return ESP_OK;
+}
+
+esp_err_t app_reset_button_register(button_handle_t btn_handle, uint8_t wifi_reset_timeout, uint8_t factory_reset_timeout)
+{
+    return btn_handle ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
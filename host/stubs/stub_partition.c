@@ -0,0 +1,194 @@
+/* Host build: esp_partition on files, with NOR flash semantics
+ *
+ * Erase sets whole 4 KB sectors to 0xff and a write can only clear bits,
+ * as on the SPI flash. A partition can be made to lose power in the
+ * middle of a write, to check what a reader makes of the torn data.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_partition.h"
+#include "stub_internal.h"
+
+#define STUB_PARTITIONS_MAX   4
+#define STUB_FLASH_SECTOR     4096
+
+typedef struct {
+    esp_partition_t part;
+    FILE *file;
+    int64_t fail_after;         /*!< bytes still written before the power cut, -1 never */
+    uint32_t dirty_writes;
+    uint32_t *erase_counts;
+} stub_partition_t;
+
+static stub_partition_t s_partitions[STUB_PARTITIONS_MAX];
+static size_t s_partition_count;
+static uint32_t s_next_address = 0x340000;
+
+static stub_partition_t *find(const esp_partition_t *partition)
+{
+    for (size_t i = 0; i < s_partition_count; i++) {
+        if (&s_partitions[i].part == partition) {
+            return &s_partitions[i];
+        }
+    }
+    return NULL;
+}
+
+const esp_partition_t *stub_partition_add(const char *label, esp_partition_type_t type,
+                                          esp_partition_subtype_t subtype, size_t size, const char *path)
+{
+    if (s_partition_count == STUB_PARTITIONS_MAX || size % STUB_FLASH_SECTOR) {
+        return NULL;
+    }
+    FILE *f = fopen(path, "r+b");
+    if (!f) {
+        f = fopen(path, "w+b");
+    }
+    if (!f) {
+        return NULL;
+    }
+    // Pad a new or short file with erased flash
+    fseek(f, 0, SEEK_END);
+    for (long len = ftell(f); len < (long)size; len++) {
+        fputc(0xff, f);
+    }
+    fflush(f);
+
+    stub_partition_t *p = &s_partitions[s_partition_count++];
+    memset(p, 0, sizeof(*p));
+    p->part.type = type;
+    p->part.subtype = subtype;
+    p->part.address = s_next_address;
+    p->part.size = size;
+    p->part.erase_size = STUB_FLASH_SECTOR;
+    strncpy(p->part.label, label, sizeof(p->part.label) - 1);
+    p->file = f;
+    p->fail_after = -1;
+    p->erase_counts = calloc(size / STUB_FLASH_SECTOR, sizeof(uint32_t));
+    s_next_address += size;
+    return &p->part;
+}
+
+void stub_partition_remove_all(void)
+{
+    for (size_t i = 0; i < s_partition_count; i++) {
+        fclose(s_partitions[i].file);
+        free(s_partitions[i].erase_counts);
+    }
+    s_partition_count = 0;
+}
+
+void stub_partition_fail_after(const esp_partition_t *partition, int64_t bytes)
+{
+    stub_partition_t *p = find(partition);
+    if (p) {
+        p->fail_after = bytes;
+    }
+}
+
+uint32_t stub_partition_dirty_writes(const esp_partition_t *partition)
+{
+    stub_partition_t *p = find(partition);
+    return p ? p->dirty_writes : 0;
+}
+
+uint32_t stub_partition_erase_count(const esp_partition_t *partition, size_t sector)
+{
+    stub_partition_t *p = find(partition);
+    return p && sector < p->part.size / STUB_FLASH_SECTOR ? p->erase_counts[sector] : 0;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    for (stub_partition_t *p = s_partitions; p < s_partitions + s_partition_count; p++) {
+        const esp_partition_t *part = &p->part;
+        if ((type == ESP_PARTITION_TYPE_ANY || part->type == type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || part->subtype == subtype) &&
+            (!label || !strcmp(part->label, label))) {
+            return part;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    stub_partition_t *p = find(partition);
+    if (!p || !dst) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (src_offset > p->part.size || size > p->part.size - src_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    fseek(p->file, src_offset, SEEK_SET);
+    if (fread(dst, 1, size, p->file) != size) {
+        return ESP_FAIL;
+    }
+    stub_record(STUB_EV_FLASH_READ, size, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    stub_partition_t *p = find(partition);
+    if (!p || !src) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dst_offset > p->part.size || size > p->part.size - dst_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!p->fail_after) {
+        return ESP_FAIL;
+    }
+    size_t len = p->fail_after > 0 && (int64_t)size > p->fail_after ? (size_t)p->fail_after : size;
+    uint8_t *cells = malloc(len);
+    fseek(p->file, dst_offset, SEEK_SET);
+    if (fread(cells, 1, len, p->file) != len) {
+        free(cells);
+        return ESP_FAIL;
+    }
+    bool dirty = false;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = ((const uint8_t *)src)[i];
+        dirty |= (b & ~cells[i]) != 0;
+        cells[i] &= b;
+    }
+    p->dirty_writes += dirty;
+    fseek(p->file, dst_offset, SEEK_SET);
+    fwrite(cells, 1, len, p->file);
+    fflush(p->file);
+    free(cells);
+    stub_record(STUB_EV_FLASH_WRITE, len, 0);
+    if (p->fail_after > 0) {
+        p->fail_after -= len;
+    }
+    return len < size ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    stub_partition_t *p = find(partition);
+    if (!p) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset % STUB_FLASH_SECTOR || size % STUB_FLASH_SECTOR) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset > p->part.size || size > p->part.size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!p->fail_after) {
+        return ESP_FAIL;
+    }
+    static const uint8_t erased[STUB_FLASH_SECTOR] = { [0 ... STUB_FLASH_SECTOR - 1] = 0xff };
+    fseek(p->file, offset, SEEK_SET);
+    for (size_t s = 0; s < size / STUB_FLASH_SECTOR; s++) {
+        fwrite(erased, 1, sizeof(erased), p->file);
+        p->erase_counts[offset / STUB_FLASH_SECTOR + s]++;
+    }
+    fflush(p->file);
+    stub_record(STUB_EV_FLASH_ERASE, size / STUB_FLASH_SECTOR, 0);
+    return ESP_OK;
+}
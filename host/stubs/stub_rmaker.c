@@ -0,0 +1,386 @@
+/* Host build: ESP RainMaker node model
+ *
+ * esp_rmaker_param_update() marks a param changed; a report publishes every
+ * changed param of the node as one message, mirroring the agent.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "esp_rmaker_core.h"
+#include "esp_rmaker_standard_types.h"
+#include "esp_rmaker_standard_params.h"
+#include "esp_rmaker_standard_devices.h"
+#include "esp_rmaker_ota.h"
+#include "esp_rmaker_schedule.h"
+#include "esp_rmaker_mqtt.h"
+#include "esp_rmaker_common_events.h"
+#include "stub_internal.h"
+
+#define STUB_RMAKER_DEVICES_MAX 16
+#define STUB_RMAKER_PARAMS_MAX  8
+
+struct esp_rmaker_param {
+    char *name;
+    char *type;
+    uint8_t properties;
+    esp_rmaker_param_val_t val;
+    bool changed;
+    esp_rmaker_device_t *device;
+};
+
+struct esp_rmaker_device {
+    char *name;
+    char *type;
+    void *priv_data;
+    esp_rmaker_device_write_cb_t write_cb;
+    esp_rmaker_device_read_cb_t read_cb;
+    esp_rmaker_param_t *params[STUB_RMAKER_PARAMS_MAX];
+    size_t param_count;
+    esp_rmaker_param_t *primary;
+};
+
+struct esp_rmaker_node {
+    char *name;
+    char *type;
+};
+
+static esp_rmaker_node_t s_node;
+static esp_rmaker_device_t *s_devices[STUB_RMAKER_DEVICES_MAX];
+static size_t s_device_count;
+static bool s_mqtt_connected = true;
+static void (*s_mqtt_capture)(const char *topic, const void *data, size_t len);
+
+ESP_EVENT_DEFINE_BASE(RMAKER_COMMON_EVENT);
+
+static char *dup_str(const char *s)
+{
+    return s ? strdup(s) : NULL;
+}
+
+esp_rmaker_param_val_t esp_rmaker_bool(bool bval)
+{
+    esp_rmaker_param_val_t v = { .type = RMAKER_VAL_TYPE_BOOLEAN, .val.b = bval };
+    return v;
+}
+
+esp_rmaker_param_val_t esp_rmaker_int(int ival)
+{
+    esp_rmaker_param_val_t v = { .type = RMAKER_VAL_TYPE_INTEGER, .val.i = ival };
+    return v;
+}
+
+esp_rmaker_param_val_t esp_rmaker_float(float fval)
+{
+    esp_rmaker_param_val_t v = { .type = RMAKER_VAL_TYPE_FLOAT, .val.f = fval };
+    return v;
+}
+
+esp_rmaker_param_val_t esp_rmaker_str(const char *sval)
+{
+    esp_rmaker_param_val_t v = { .type = RMAKER_VAL_TYPE_STRING, .val.s = (char *)sval };
+    return v;
+}
+
+esp_rmaker_node_t *esp_rmaker_node_init(const esp_rmaker_config_t *config, const char *name, const char *type)
+{
+    s_node.name = dup_str(name);
+    s_node.type = dup_str(type);
+    return &s_node;
+}
+
+esp_err_t esp_rmaker_start(void)
+{
+    return ESP_OK;
+}
+
+char *esp_rmaker_get_node_id(void)
+{
+    static char node_id[] = "hostnode";
+    return node_id;
+}
+
+void stub_rmaker_set_connected(bool connected)
+{
+    s_mqtt_connected = connected;
+    stub_event_post(RMAKER_COMMON_EVENT, connected ? RMAKER_MQTT_EVENT_CONNECTED : RMAKER_MQTT_EVENT_DISCONNECTED,
+                    NULL);
+}
+
+void stub_rmaker_mqtt_capture(void (*cb)(const char *topic, const void *data, size_t len))
+{
+    s_mqtt_capture = cb;
+}
+
+esp_err_t esp_rmaker_mqtt_publish(const char *topic, void *data, size_t data_len, uint8_t qos, int *msg_id)
+{
+    if (!topic || !data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_mqtt_connected) {
+        return ESP_FAIL;
+    }
+    stub_record(STUB_EV_RMAKER_MQTT, data_len, 0);
+    if (s_mqtt_capture) {
+        s_mqtt_capture(topic, data, data_len);
+    }
+    if (msg_id) {
+        *msg_id = (int)stub_counter(STUB_EV_RMAKER_MQTT)->count;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_node_add_device(const esp_rmaker_node_t *node, const esp_rmaker_device_t *device)
+{
+    if (!node || !device || s_device_count == STUB_RMAKER_DEVICES_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_devices[s_device_count++] = (esp_rmaker_device_t *)device;
+    return ESP_OK;
+}
+
+esp_rmaker_device_t *esp_rmaker_device_create(const char *dev_name, const char *type, void *priv_data)
+{
+    esp_rmaker_device_t *d = calloc(1, sizeof(*d));
+    if (d) {
+        d->name = dup_str(dev_name);
+        d->type = dup_str(type);
+        d->priv_data = priv_data;
+    }
+    return d;
+}
+
+esp_err_t esp_rmaker_device_add_cb(const esp_rmaker_device_t *device, esp_rmaker_device_write_cb_t write_cb,
+                                   esp_rmaker_device_read_cb_t read_cb)
+{
+    if (!device) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ((esp_rmaker_device_t *)device)->write_cb = write_cb;
+    ((esp_rmaker_device_t *)device)->read_cb = read_cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_device_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param)
+{
+    esp_rmaker_device_t *d = (esp_rmaker_device_t *)device;
+    if (!d || !param || d->param_count == STUB_RMAKER_PARAMS_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ((esp_rmaker_param_t *)param)->device = d;
+    d->params[d->param_count++] = (esp_rmaker_param_t *)param;
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_device_assign_primary_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param)
+{
+    if (!device || !param) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ((esp_rmaker_device_t *)device)->primary = (esp_rmaker_param_t *)param;
+    return ESP_OK;
+}
+
+char *esp_rmaker_device_get_name(const esp_rmaker_device_t *device)
+{
+    return device ? device->name : NULL;
+}
+
+esp_rmaker_param_t *esp_rmaker_device_get_param_by_name(const esp_rmaker_device_t *device, const char *param_name)
+{
+    if (!device || !param_name) {
+        return NULL;
+    }
+    for (size_t i = 0; i < device->param_count; i++) {
+        if (strcmp(device->params[i]->name, param_name) == 0) {
+            return device->params[i];
+        }
+    }
+    return NULL;
+}
+
+esp_rmaker_param_t *esp_rmaker_device_get_param_by_type(const esp_rmaker_device_t *device, const char *param_type)
+{
+    if (!device || !param_type) {
+        return NULL;
+    }
+    for (size_t i = 0; i < device->param_count; i++) {
+        if (device->params[i]->type && strcmp(device->params[i]->type, param_type) == 0) {
+            return device->params[i];
+        }
+    }
+    return NULL;
+}
+
+const char *esp_rmaker_device_cb_src_to_str(esp_rmaker_req_src_t src)
+{
+    static const char *const names[] = { "Init", "Cloud", "Schedule", "Local" };
+    return src < ESP_RMAKER_REQ_SRC_MAX ? names[src] : NULL;
+}
+
+esp_rmaker_param_t *esp_rmaker_param_create(const char *param_name, const char *type,
+                                            esp_rmaker_param_val_t val, uint8_t properties)
+{
+    esp_rmaker_param_t *p = calloc(1, sizeof(*p));
+    if (p) {
+        p->name = dup_str(param_name);
+        p->type = dup_str(type);
+        p->val = val;
+        p->properties = properties;
+    }
+    return p;
+}
+
+esp_err_t esp_rmaker_param_add_ui_type(const esp_rmaker_param_t *param, const char *ui_type)
+{
+    return param ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_rmaker_param_add_bounds(const esp_rmaker_param_t *param,
+                                      esp_rmaker_param_val_t min, esp_rmaker_param_val_t max, esp_rmaker_param_val_t step)
+{
+    return param ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+char *esp_rmaker_param_get_name(const esp_rmaker_param_t *param)
+{
+    return param ? param->name : NULL;
+}
+
+char *esp_rmaker_param_get_type(const esp_rmaker_param_t *param)
+{
+    return param ? param->type : NULL;
+}
+
+esp_rmaker_param_val_t *esp_rmaker_param_get_val(esp_rmaker_param_t *param)
+{
+    return param ? &param->val : NULL;
+}
+
+esp_err_t esp_rmaker_param_update(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    if (!param) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_rmaker_param_t *p = (esp_rmaker_param_t *)param;
+    p->val = val;
+    p->changed = true;
+    return ESP_OK;
+}
+
+/* One node params publish carrying every changed param */
+static esp_err_t report_changed(void)
+{
+    size_t params = 0;
+    for (size_t d = 0; d < s_device_count; d++) {
+        for (size_t i = 0; i < s_devices[d]->param_count; i++) {
+            if (s_devices[d]->params[i]->changed) {
+                s_devices[d]->params[i]->changed = false;
+                params++;
+            }
+        }
+    }
+    if (params) {
+        stub_record(STUB_EV_RMAKER_PUBLISH, 1, 0);
+        stub_record(STUB_EV_RMAKER_PARAM, params, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_param_update_and_report(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    esp_err_t err = esp_rmaker_param_update(param, val);
+    if (err == ESP_OK) {
+        err = report_changed();
+    }
+    return err;
+}
+
+static esp_rmaker_param_t *param_with_type(const char *name, const char *type, esp_rmaker_param_val_t val,
+                                           uint8_t properties)
+{
+    return esp_rmaker_param_create(name, type, val, properties);
+}
+
+esp_rmaker_param_t *esp_rmaker_name_param_create(const char *param_name, const char *val)
+{
+    return param_with_type(param_name, ESP_RMAKER_PARAM_NAME, esp_rmaker_str(val), PROP_FLAG_READ | PROP_FLAG_WRITE);
+}
+
+esp_rmaker_param_t *esp_rmaker_power_param_create(const char *param_name, bool val)
+{
+    return param_with_type(param_name, ESP_RMAKER_PARAM_POWER, esp_rmaker_bool(val), PROP_FLAG_READ | PROP_FLAG_WRITE);
+}
+
+esp_rmaker_param_t *esp_rmaker_brightness_param_create(const char *param_name, int val)
+{
+    return param_with_type(param_name, ESP_RMAKER_PARAM_BRIGHTNESS, esp_rmaker_int(val), PROP_FLAG_READ | PROP_FLAG_WRITE);
+}
+
+esp_rmaker_param_t *esp_rmaker_hue_param_create(const char *param_name, int val)
+{
+    return param_with_type(param_name, ESP_RMAKER_PARAM_HUE, esp_rmaker_int(val), PROP_FLAG_READ | PROP_FLAG_WRITE);
+}
+
+esp_rmaker_param_t *esp_rmaker_saturation_param_create(const char *param_name, int val)
+{
+    return param_with_type(param_name, ESP_RMAKER_PARAM_SATURATION, esp_rmaker_int(val), PROP_FLAG_READ | PROP_FLAG_WRITE);
+}
+
+esp_rmaker_param_t *esp_rmaker_temperature_param_create(const char *param_name, float val)
+{
+    return param_with_type(param_name, ESP_RMAKER_PARAM_TEMPERATURE, esp_rmaker_float(val), PROP_FLAG_READ);
+}
+
+esp_rmaker_device_t *esp_rmaker_lightbulb_device_create(const char *dev_name, void *priv_data, bool power)
+{
+    esp_rmaker_device_t *d = esp_rmaker_device_create(dev_name, ESP_RMAKER_DEVICE_LIGHTBULB, priv_data);
+    if (d) {
+        esp_rmaker_device_add_param(d, esp_rmaker_name_param_create(ESP_RMAKER_DEF_NAME_PARAM, dev_name));
+        esp_rmaker_param_t *p = esp_rmaker_power_param_create(ESP_RMAKER_DEF_POWER_NAME, power);
+        esp_rmaker_device_add_param(d, p);
+        esp_rmaker_device_assign_primary_param(d, p);
+    }
+    return d;
+}
+
+esp_rmaker_device_t *esp_rmaker_temp_sensor_device_create(const char *dev_name, void *priv_data, float temperature)
+{
+    esp_rmaker_device_t *d = esp_rmaker_device_create(dev_name, ESP_RMAKER_DEVICE_TEMP_SENSOR, priv_data);
+    if (d) {
+        esp_rmaker_device_add_param(d, esp_rmaker_name_param_create(ESP_RMAKER_DEF_NAME_PARAM, dev_name));
+        esp_rmaker_param_t *p = esp_rmaker_temperature_param_create(ESP_RMAKER_DEF_TEMPERATURE_NAME, temperature);
+        esp_rmaker_device_add_param(d, p);
+        esp_rmaker_device_assign_primary_param(d, p);
+    }
+    return d;
+}
+
+esp_err_t esp_rmaker_ota_enable(esp_rmaker_ota_config_t *ota_config, esp_rmaker_ota_type_t type)
+{
+    return ota_config ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_rmaker_schedule_enable(void)
+{
+    return ESP_OK;
+}
+
+esp_rmaker_device_t *stub_rmaker_find_device(const char *device_name)
+{
+    for (size_t i = 0; i < s_device_count; i++) {
+        if (strcmp(s_devices[i]->name, device_name) == 0) {
+            return s_devices[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t stub_rmaker_write(const char *device_name, const char *param_name, esp_rmaker_param_val_t val)
+{
+    esp_rmaker_device_t *d = stub_rmaker_find_device(device_name);
+    esp_rmaker_param_t *p = esp_rmaker_device_get_param_by_name(d, param_name);
+    if (!p || !d->write_cb) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_rmaker_write_ctx_t ctx = { .src = ESP_RMAKER_REQ_SRC_CLOUD };
+    return d->write_cb(d, p, val, d->priv_data, &ctx);
+}
@@ -0,0 +1,233 @@
+/* Host build: RMT TX channels
+ *
+ * On target the driver fills the whole channel memory from the caller, then
+ * refills half a block from the TX threshold interrupt until the sample
+ * buffer is consumed. The translator is called with the same chunk sizes here
+ * so its cost per refresh matches what the ISR pays.
+ */
+#include <string.h>
+#include "driver/rmt.h"
+#include "stub_internal.h"
+
+#define RMT_APB_CLK_HZ 80000000
+
+typedef struct {
+    bool configured;
+    bool installed;
+    rmt_config_t config;
+    sample_to_rmt_t translator;
+    bool busy;
+    rmt_item32_t mem[RMT_MEM_ITEM_NUM * RMT_CHANNEL_MAX];
+    rmt_item32_t *capture;
+    size_t capture_max;
+    size_t captured;
+} stub_rmt_channel_t;
+
+static stub_rmt_channel_t s_channels[RMT_CHANNEL_MAX];
+static rmt_tx_end_callback_t s_tx_end;
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param)
+{
+    if (!rmt_param || rmt_param->channel >= RMT_CHANNEL_MAX || !rmt_param->clk_div) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stub_rmt_channel_t *ch = &s_channels[rmt_param->channel];
+    ch->config = *rmt_param;
+    if (!ch->config.mem_block_num) {
+        ch->config.mem_block_num = 1;
+    }
+    /* Extra blocks are borrowed from the following channels */
+    if (rmt_param->channel + ch->config.mem_block_num > RMT_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ch->configured = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags)
+{
+    if (channel >= RMT_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_channels[channel].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_channels[channel].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel)
+{
+    if (channel >= RMT_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_channels[channel].installed = false;
+    s_channels[channel].translator = NULL;
+    return ESP_OK;
+}
+
+esp_err_t rmt_get_counter_clock(rmt_channel_t channel, uint32_t *clock_hz)
+{
+    if (channel >= RMT_CHANNEL_MAX || !clock_hz || !s_channels[channel].configured) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *clock_hz = RMT_APB_CLK_HZ / s_channels[channel].config.clk_div;
+    return ESP_OK;
+}
+
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn)
+{
+    if (channel >= RMT_CHANNEL_MAX || !fn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_channels[channel].translator = fn;
+    return ESP_OK;
+}
+
+rmt_tx_end_callback_t rmt_register_tx_end_callback(rmt_tx_end_fn_t function, void *arg)
+{
+    rmt_tx_end_callback_t previous = s_tx_end;
+    s_tx_end.function = function;
+    s_tx_end.arg = arg;
+    return previous;
+}
+
+static void tx_end_isr(void *arg)
+{
+    stub_rmt_channel_t *ch = arg;
+    ch->busy = false;
+    if (s_tx_end.function) {
+        s_tx_end.function((rmt_channel_t)(ch - s_channels), s_tx_end.arg);
+    }
+}
+
+static bool channel_idle(void *arg)
+{
+    return !((stub_rmt_channel_t *)arg)->busy;
+}
+
+static uint64_t items_wire_ticks(stub_rmt_channel_t *ch, const rmt_item32_t *items, size_t num)
+{
+    uint64_t ticks = 0;
+    for (size_t i = 0; i < num; i++) {
+        ticks += items[i].duration0 + items[i].duration1;
+        if (ch->capture && ch->captured < ch->capture_max) {
+            ch->capture[ch->captured++] = items[i];
+        }
+    }
+    return ticks;
+}
+
+static esp_err_t start_tx(stub_rmt_channel_t *ch, uint64_t wire_ticks, bool wait_tx_done)
+{
+    uint32_t clock_hz = RMT_APB_CLK_HZ / ch->config.clk_div;
+    uint64_t wire_us = (wire_ticks * 1000000 + clock_hz - 1) / clock_hz;
+    ch->busy = true;
+    stub_record(STUB_EV_RMT_WIRE, wire_us, 0);
+    stub_isr_schedule(stub_now_us() + wire_us, tx_end_isr, ch);
+    if (wait_tx_done) {
+        uint64_t start_us = stub_now_us();
+        stub_block_until(channel_idle, ch, wire_us);
+        stub_record(STUB_EV_RMT_WAIT, stub_now_us() - start_us, 0);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t wait_previous(stub_rmt_channel_t *ch)
+{
+    /* The driver takes its TX semaphore with portMAX_DELAY */
+    if (ch->busy) {
+        uint64_t start_us = stub_now_us();
+        stub_block_until(channel_idle, ch, UINT32_MAX);
+        stub_record(STUB_EV_RMT_WAIT, stub_now_us() - start_us, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t *src, size_t src_size, bool wait_tx_done)
+{
+    if (channel >= RMT_CHANNEL_MAX || !src) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stub_rmt_channel_t *ch = &s_channels[channel];
+    if (!ch->installed || !ch->translator) {
+        return ESP_FAIL;
+    }
+    wait_previous(ch);
+
+    size_t block_items = RMT_MEM_ITEM_NUM * ch->config.mem_block_num;
+    size_t wanted = block_items;
+    size_t offset = 0;
+    uint64_t wire_ticks = 0;
+    uint64_t total_cycles = 0;
+    while (offset < src_size) {
+        size_t translated = 0;
+        size_t items = 0;
+        uint64_t start = stub_cycles();
+        ch->translator(src + offset, ch->mem, src_size - offset, wanted, &translated, &items);
+        uint64_t cycles = stub_cycles() - start;
+        total_cycles += cycles;
+        stub_record(STUB_EV_RMT_TRANSLATE, items, cycles);
+        if (!translated) {
+            break;
+        }
+        wire_ticks += items_wire_ticks(ch, ch->mem, items);
+        offset += translated;
+        wanted = block_items / 2;
+    }
+    stub_record(STUB_EV_RMT_WRITE, src_size, total_cycles);
+    return start_tx(ch, wire_ticks, wait_tx_done);
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *rmt_item, int item_num, bool wait_tx_done)
+{
+    if (channel >= RMT_CHANNEL_MAX || !rmt_item || item_num <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stub_rmt_channel_t *ch = &s_channels[channel];
+    if (!ch->installed) {
+        return ESP_FAIL;
+    }
+    wait_previous(ch);
+
+    /* The ISR copies items into channel memory half a block at a time */
+    size_t block_items = RMT_MEM_ITEM_NUM * ch->config.mem_block_num;
+    uint64_t start = stub_cycles();
+    for (size_t i = 0; i < (size_t)item_num; i += block_items / 2) {
+        size_t n = (size_t)item_num - i < block_items / 2 ? (size_t)item_num - i : block_items / 2;
+        memcpy(ch->mem, rmt_item + i, n * sizeof(rmt_item32_t));
+    }
+    uint64_t cycles = stub_cycles() - start;
+    stub_record(STUB_EV_RMT_TRANSLATE, item_num, cycles);
+    stub_record(STUB_EV_RMT_WRITE, item_num * sizeof(rmt_item32_t), cycles);
+    return start_tx(ch, items_wire_ticks(ch, rmt_item, item_num), wait_tx_done);
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t wait_time)
+{
+    if (channel >= RMT_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stub_rmt_channel_t *ch = &s_channels[channel];
+    uint64_t start_us = stub_now_us();
+    bool idle = stub_block_until(channel_idle, ch, (uint64_t)wait_time * portTICK_PERIOD_MS * 1000);
+    stub_record(STUB_EV_RMT_WAIT, stub_now_us() - start_us, 0);
+    return idle ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void stub_rmt_capture(rmt_channel_t channel, rmt_item32_t *buf, size_t max_items)
+{
+    s_channels[channel].capture = buf;
+    s_channels[channel].capture_max = buf ? max_items : 0;
+    s_channels[channel].captured = 0;
+}
+
+size_t stub_rmt_captured(rmt_channel_t channel)
+{
+    return s_channels[channel].captured;
+}
+
+bool stub_rmt_busy(rmt_channel_t channel)
+{
+    return s_channels[channel].busy;
+}
@@ -9,22 +9,34 @@
 #include <stdio.h>
 #include <sdkconfig.h>
 #include <string.h>
+#include <time.h>
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <esp_system.h>
+#include <esp_timer.h>
 #include <esp_log.h>
 #include <nvs_flash.h>
 #include <driver/rmt.h>
 #include <bh1750.h>
 #include <sht3x.h>
+#include <sensor_sched.h>
+#include <sensor_report.h>
+#include <sensor_filter.h>
+#include <sensor_rate.h>
+#include <sensor_history.h>
+#include <sensor_log.h>
 
 #define ADDR_BH1750 BH1750_ADDR_LO
 #define ADDR_SHT31 SHT3X_I2C_ADDR_GND
 
 #include <iot_button.h>
 #include <led_strip.h>
+#include <led_color.h>
+#include <led_effect.h>
 #include <esp_rmaker_core.h>
 #include <esp_rmaker_standard_types.h>
 #include <esp_rmaker_standard_params.h>
+#include <esp_rmaker_mqtt.h>
 
 #include <app_reset.h>
 #include "app_priv.h"
@@ -52,188 +64,278 @@ static led_strip_t *g_rgbpixel_strip;
 static esp_timer_handle_t rgbpixel_anim_timer;
 static esp_timer_handle_t rgbpixel_anim_duration_timer;
 static uint8_t g_gpio_rgbpixel_strip = DEFAULT_OUTPUT_GPIO_RGBPIXEL_STRIP;
-static uint8_t g_rgbpixel_strip_pixels = DEFAULT_RGBPIXEL_STRIP_PIXELS;
+static uint16_t g_rgbpixel_strip_pixels = DEFAULT_RGBPIXEL_STRIP_PIXELS;
 static bool g_rgbpixel_power_state = DEFAULT_RGBPIXEL_POWER_STATE;
 static uint16_t g_rgbpixel_hue = DEFAULT_RGBPIXEL_HUE;
 static uint16_t g_rgbpixel_saturation = DEFAULT_RGBPIXEL_SATURATION;
 static uint16_t g_rgbpixel_value = DEFAULT_RGBPIXEL_BRIGHTNESS;
-uint32_t rgbpixel_spin_blue_bg;
-uint32_t rgbpixel_spin_blue_fg;
-uint32_t rgbpixel_pulse_blue_min;
-uint32_t rgbpixel_pulse_blue_max;
-uint32_t rgbpixel_pulse_red_min;
-uint32_t rgbpixel_pulse_red_max;
-uint32_t rgbpixel_pulse_green_min;
-uint32_t rgbpixel_pulse_green_max;
-uint8_t rgbpixel_anim_style = 0;
-uint8_t rgbpixel_anim_counter = 0;
-bool rgbpixel_anim_up = true;
-
-static esp_timer_handle_t bh1750_sensor_timer;
-static esp_timer_handle_t sht31_sensor_timer;
+static uint8_t g_rgbpixel_scale_lut[256];
+static uint16_t g_rgbpixel_scale_lut_value = UINT16_MAX;
+static led_effect_player_t g_rgbpixel_effect;
+#if DEFAULT_ANIM_CACHE_SIZE_RGBPIXEL
+static uint8_t g_rgbpixel_anim_cache[DEFAULT_ANIM_CACHE_SIZE_RGBPIXEL];
+#endif
+
+/* Effect played for each status animation */
+static const struct {
+	led_effect_id_t effect;
+	led_effect_params_t params;
+} s_rgbpixel_anims[RGBPIXEL_ANIM_MAX] = {
+	[RGBPIXEL_ANIM_LOAD]  = { LED_EFFECT_SPINNER, { .color_a = 0x0000FF, .color_b = 0x00FFFF, .period_ms = 1000 } },
+	[RGBPIXEL_ANIM_MOVE]  = { LED_EFFECT_PULSE,   { .color_a = 0x0000FF, .color_b = 0x00FFFF, .period_ms = 2000 } },
+	[RGBPIXEL_ANIM_ERROR] = { LED_EFFECT_PULSE,   { .color_a = 0x281100, .color_b = 0xFF1100, .period_ms = 2000 } },
+	[RGBPIXEL_ANIM_OTA]   = { LED_EFFECT_PULSE,   { .color_a = 0x281100, .color_b = 0xFF1100, .period_ms = 2000 } },
+};
+
+static esp_timer_handle_t sht31_fetch_timer;
+static esp_timer_handle_t bh1750_fetch_timer;
+/* Created once by app_driver_sensor_init(); a sensor that failed to come up is set up again on its next sample */
+static i2c_dev_t g_bh1750_dev;
+static sht3x_t g_sht31_dev;
+static bool g_bh1750_ready;
+static bool g_sht31_ready;
+/* Asked for from any task, applied by the scheduler task while no sweep uses the descriptor */
+static volatile sht3x_repeat_t g_sht31_repeat = DEFAULT_SHT31_REPEATABILITY;
+static bh1750_mode_t g_bh1750_mode;
+static bh1750_range_t g_bh1750_range = { .resolution = BH1750_RES_HIGH, .mtreg = BH1750_MTREG_DEFAULT };
 static uint16_t g_sensor_luminosity;
 static float g_sensor_temperature;
 static float g_sensor_humidity;
 
-static const char *TAG = "app_driver";
+/*
+ * Noise filters, ahead of reporting: a glitch does not get published, nor
+ * does it reset the deadband. History and the flash log keep raw samples.
+ */
+static sensor_filter_t g_luminosity_filter = {
+    .median = DEFAULT_FILTER_MEDIAN_LUMINOSITY,
+    .ema_shift = DEFAULT_FILTER_EMA_SHIFT_LUMINOSITY,
+    .outlier = DEFAULT_FILTER_OUTLIER_LUMINOSITY,
+    .outlier_max = DEFAULT_FILTER_OUTLIER_RUN,
+};
+static sensor_filter_t g_temperature_filter = {
+    .median = DEFAULT_FILTER_MEDIAN_TEMPERATURE,
+    .ema_shift = DEFAULT_FILTER_EMA_SHIFT_TEMPERATURE,
+    .outlier = DEFAULT_FILTER_OUTLIER_TEMPERATURE,
+    .outlier_max = DEFAULT_FILTER_OUTLIER_RUN,
+};
+static sensor_filter_t g_humidity_filter = {
+    .median = DEFAULT_FILTER_MEDIAN_HUMIDITY,
+    .ema_shift = DEFAULT_FILTER_EMA_SHIFT_HUMIDITY,
+    .outlier = DEFAULT_FILTER_OUTLIER_HUMIDITY,
+    .outlier_max = DEFAULT_FILTER_OUTLIER_RUN,
+};
 
-static void led_strip_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b)
-{
-	h %= 360; // h -> [0,360]
-    uint32_t rgb_max = v * 2.55f;
-    uint32_t rgb_min = rgb_max * (100 - s) / 100.0f;
-
-    uint32_t i = h / 60;
-    uint32_t diff = h % 60;
-
-    // RGB adjustment amount by hue
-    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
-
-    switch (i) {
-    case 0:
-        *r = rgb_max;
-        *g = rgb_min + rgb_adj;
-        *b = rgb_min;
-        break;
-    case 1:
-        *r = rgb_max - rgb_adj;
-        *g = rgb_max;
-        *b = rgb_min;
-        break;
-    case 2:
-        *r = rgb_min;
-        *g = rgb_max;
-        *b = rgb_min + rgb_adj;
-        break;
-    case 3:
-        *r = rgb_min;
-        *g = rgb_max - rgb_adj;
-        *b = rgb_max;
-        break;
-    case 4:
-        *r = rgb_min + rgb_adj;
-        *g = rgb_min;
-        *b = rgb_max;
-        break;
-    default:
-        *r = rgb_max;
-        *g = rgb_min;
-        *b = rgb_max - rgb_adj;
-        break;
-    }
-}
+/*
+ * Sampling periods, following the raw samples: about one deadband of change
+ * between samples, so a moving value is tracked closely and a still one
+ * costs little bus, CPU and radio time.
+ */
+static sensor_rate_t g_luminosity_rate = {
+    .min_period_ms = DEFAULT_SAMPLING_MIN_PERIOD_BH1750 * 1000U,
+    .max_period_ms = DEFAULT_SAMPLING_MAX_PERIOD_BH1750 * 1000U,
+    .step = DEFAULT_REPORT_DEADBAND_LUMINOSITY,
+    .step_pct = DEFAULT_REPORT_DEADBAND_PCT_LUMINOSITY,
+};
+static sensor_rate_t g_temperature_rate = {
+    .min_period_ms = DEFAULT_SAMPLING_MIN_PERIOD_SHT31 * 1000U,
+    .max_period_ms = DEFAULT_SAMPLING_MAX_PERIOD_SHT31 * 1000U,
+    .step = DEFAULT_REPORT_DEADBAND_TEMPERATURE,
+};
+static sensor_rate_t g_humidity_rate = {
+    .min_period_ms = DEFAULT_SAMPLING_MIN_PERIOD_SHT31 * 1000U,
+    .max_period_ms = DEFAULT_SAMPLING_MAX_PERIOD_SHT31 * 1000U,
+    .step = DEFAULT_REPORT_DEADBAND_HUMIDITY,
+};
 
-static esp_err_t app_driver_rgbpixel_set_pixel(uint32_t hue, uint32_t saturation, uint32_t brightness)
-{
-    uint32_t red = 0;
-    uint32_t green = 0;
-    uint32_t blue = 0;
-    g_rgbpixel_hue = hue;
-    g_rgbpixel_saturation = saturation;
-    g_rgbpixel_value = brightness;
-    led_strip_hsv2rgb(g_rgbpixel_hue, g_rgbpixel_saturation, g_rgbpixel_value, &red, &green, &blue);
-	for (int i=0; i<g_rgbpixel_strip_pixels; i++) {
-		g_rgbpixel_strip->set_pixel(g_rgbpixel_strip, i, red, green, blue);
-	}
-    g_rgbpixel_strip->refresh(g_rgbpixel_strip, 100);
-    return ESP_OK;
-}
+/* Report-on-change filters, values in hundredths */
+static sensor_report_t g_luminosity_report = {
+    .deadband = DEFAULT_REPORT_DEADBAND_LUMINOSITY,
+    .deadband_pct = DEFAULT_REPORT_DEADBAND_PCT_LUMINOSITY,
+    .max_silent_ms = DEFAULT_REPORT_MAX_SILENT_INTERVAL * 1000U,
+};
+static sensor_report_t g_temperature_report = {
+    .deadband = DEFAULT_REPORT_DEADBAND_TEMPERATURE,
+    .max_silent_ms = DEFAULT_REPORT_MAX_SILENT_INTERVAL * 1000U,
+};
+static sensor_report_t g_humidity_report = {
+    .deadband = DEFAULT_REPORT_DEADBAND_HUMIDITY,
+    .max_silent_ms = DEFAULT_REPORT_MAX_SILENT_INTERVAL * 1000U,
+};
+
+/* Local history of every sample, written by the bus task only */
+static sensor_history_t g_luminosity_history;
+static sensor_history_t g_temperature_history;
+static sensor_history_t g_humidity_history;
+
+/*
+ * Every sample also goes to the flash log, flushed by the sensor scheduler.
+ * What was logged while MQTT was down is uploaded in batches once it is
+ * back; while it stays up, samples are reported live and only marked.
+ */
+enum {
+    SENSOR_LOG_LUMINOSITY = 0,
+    SENSOR_LOG_TEMPERATURE,
+    SENSOR_LOG_HUMIDITY,
+};
+static const char *const g_sensor_log_params[] = { "luminosity", "temperature", "humidity" };
+static sensor_log_t g_sensor_log;
+static bool g_sensor_log_ready;
+static volatile bool g_sensor_log_online;
+static volatile uint32_t g_sensor_log_outages;
+static volatile bool g_sensor_log_due;
+static TaskHandle_t g_sensor_log_task;
+static void app_driver_sensor_log_update(sensor_sched_entry_t *entry);
+static sensor_sched_entry_t g_sensor_log_sched = {
+    .name = "sensor_log",
+    .sample = app_driver_sensor_log_update,
+    .period_ms = DEFAULT_SENSOR_LOG_FLUSH_PERIOD * 1000U,
+    .phase_ms = DEFAULT_SENSOR_LOG_PHASE,
+    .error_budget = DEFAULT_SENSOR_ERROR_BUDGET,
+};
 
-uint32_t enhanced_rgbpixel_color(uint8_t r, uint8_t g, uint8_t b)
+/* In single shot mode the SHT31 sweep samples the BH1750 in its conversion window, the BH1750 entry
+ * is then left unscheduled and only keeps its stats */
+#define APP_DRIVER_SENSOR_SWEEP (DEFAULT_SHT31_MODE == SHT3X_SINGLE_SHOT)
+
+/* Sampled by the sensor scheduler task, the first samples staggered and close together until the rates settle */
+static void app_driver_sensor_bh1750_update(sensor_sched_entry_t *entry);
+static void app_driver_sensor_bh1750_process(sensor_sched_entry_t *entry);
+static void app_driver_sensor_sht31_update(sensor_sched_entry_t *entry);
+static void app_driver_sensor_sht31_process(sensor_sched_entry_t *entry);
+static sensor_sched_entry_t g_bh1750_sched = {
+    .name = "bh1750",
+    .sample = app_driver_sensor_bh1750_update,
+    .done = app_driver_sensor_bh1750_process,
+    .period_ms = DEFAULT_SAMPLING_MIN_PERIOD_BH1750 * 1000U,
+    .phase_ms = DEFAULT_SAMPLING_PHASE_BH1750,
+    .error_budget = DEFAULT_SENSOR_ERROR_BUDGET,
+};
+static sensor_sched_entry_t g_sht31_sched = {
+    .name = "sht31",
+    .sample = app_driver_sensor_sht31_update,
+    .done = app_driver_sensor_sht31_process,
+    .period_ms = DEFAULT_SAMPLING_MIN_PERIOD_SHT31 * 1000U,
+    .phase_ms = DEFAULT_SAMPLING_PHASE_SHT31,
+    .error_budget = DEFAULT_SENSOR_ERROR_BUDGET,
+};
+
+/* One sweep: as fast as the fastest of the params it samples needs */
+static void app_driver_sensor_sht31_period(void)
 {
-	return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    uint32_t period_ms = g_temperature_rate.period_ms < g_humidity_rate.period_ms ?
+                         g_temperature_rate.period_ms : g_humidity_rate.period_ms;
+    if (APP_DRIVER_SENSOR_SWEEP && g_luminosity_rate.period_ms < period_ms) {
+        period_ms = g_luminosity_rate.period_ms;
+    }
+    sensor_sched_set_period(&g_sht31_sched, period_ms);
 }
 
-esp_err_t enhanced_rgbpixel_set_pixel(uint16_t n, uint32_t c)
+static const char *TAG = "app_driver";
+
+/*
+ * Report batching. Params updated within DEFAULT_REPORT_BATCH_WINDOW_MS of
+ * each other are only marked changed; when the window closes the last one
+ * is reported, and RainMaker publishes every changed param in that one
+ * node params message.
+ */
+static esp_timer_handle_t report_flush_timer;
+static portMUX_TYPE g_report_lock = portMUX_INITIALIZER_UNLOCKED;
+static const esp_rmaker_param_t *g_report_param;
+static esp_rmaker_param_val_t g_report_val;
+
+static void app_driver_report_flush(void *priv)
 {
-	uint8_t r = (uint8_t)(c >> 16);
-	uint8_t g = (uint8_t)(c >> 8);
-	uint8_t b = (uint8_t)c;
-	r = r * g_rgbpixel_value * 0.01f;
-	g = g * g_rgbpixel_value * 0.01f;
-	b = b * g_rgbpixel_value * 0.01f;
-	g_rgbpixel_strip->set_pixel(g_rgbpixel_strip, n, r, g, b);
-    return ESP_OK;
+    portENTER_CRITICAL(&g_report_lock);
+    const esp_rmaker_param_t *param = g_report_param;
+    esp_rmaker_param_val_t val = g_report_val;
+    g_report_param = NULL;
+    portEXIT_CRITICAL(&g_report_lock);
+    if (param) {
+        esp_rmaker_param_update_and_report(param, val);
+    }
 }
 
-esp_err_t enhanced_rgbpixel_anim_fill(uint32_t c)
+esp_err_t app_driver_report_param(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
 {
-	for (int i=0; i<g_rgbpixel_strip_pixels; i++) {
-		enhanced_rgbpixel_set_pixel(i, c);
-	}
-	return ESP_OK;
+    esp_err_t err = esp_rmaker_param_update(param, val);
+    if (err != ESP_OK) {
+        return err;
+    }
+    portENTER_CRITICAL(&g_report_lock);
+    bool opens_window = !g_report_param;
+    g_report_param = param;
+    g_report_val = val;
+    portEXIT_CRITICAL(&g_report_lock);
+    if (opens_window && (!report_flush_timer ||
+        esp_timer_start_once(report_flush_timer, DEFAULT_REPORT_BATCH_WINDOW_MS * 1000U) != ESP_OK)) {
+        app_driver_report_flush(NULL);
+    }
+    return ESP_OK;
 }
 
-esp_err_t enhanced_rgbpixel_anim_spinner(uint32_t cbg, uint32_t cfg, uint8_t pos)
+/* Steady colours must reach the strip: if an animation frame is still on
+ * the wire the async refresh drops ours, so wait that frame out instead. */
+static esp_err_t app_driver_rgbpixel_refresh(void)
 {
-	enhanced_rgbpixel_anim_fill(cbg);
-	for (int i=pos; i<pos+2; i++) {
-		enhanced_rgbpixel_set_pixel(i % g_rgbpixel_strip_pixels, cfg);
-	}
-    return ESP_OK;
+    esp_err_t err = g_rgbpixel_strip->refresh_async(g_rgbpixel_strip);
+    if (err == ESP_ERR_INVALID_STATE) {
+        err = g_rgbpixel_strip->refresh(g_rgbpixel_strip, 100);
+    }
+    return err;
 }
 
-uint32_t enhanced_rgbpixel_interpolate(uint32_t cmin, uint32_t cmax, double t)
+static esp_err_t app_driver_rgbpixel_set_pixel(uint32_t hue, uint32_t saturation, uint32_t brightness)
 {
-	uint8_t r = (cmin >> 16 & 0xFF)*(1-t) + (cmax >> 16 & 0xFF)*t;
-	uint8_t g = (cmin >> 8  & 0xFF)*(1-t) + (cmax >> 8  & 0xFF)*t;
-	uint8_t b = (cmin       & 0xFF)*(1-t) + (cmax       & 0xFF)*t;
-	return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    uint8_t red = 0;
+    uint8_t green = 0;
+    uint8_t blue = 0;
+    g_rgbpixel_hue = hue;
+    g_rgbpixel_saturation = saturation;
+    g_rgbpixel_value = brightness;
+    led_color_hsv2rgb(g_rgbpixel_hue, g_rgbpixel_saturation, g_rgbpixel_value, &red, &green, &blue);
+    g_rgbpixel_strip->fill(g_rgbpixel_strip, red, green, blue);
+    return app_driver_rgbpixel_refresh();
 }
 
-esp_err_t enhanced_rgbpixel_anim_pulse(uint32_t cmin, uint32_t cmax, double ratio, bool up)
+/* Brightness (and gamma) per channel value, rebuilt only when the brightness changes */
+static void enhanced_rgbpixel_update_scale(void)
 {
-	double t = (up) ? ratio : 1 - ratio;
-	uint32_t c = enhanced_rgbpixel_interpolate(cmin, cmax, t);
-	enhanced_rgbpixel_anim_fill(c);
-    return ESP_OK;
+	if (g_rgbpixel_scale_lut_value != g_rgbpixel_value) {
+		led_color_scale_lut(g_rgbpixel_scale_lut, g_rgbpixel_value, DEFAULT_RGBPIXEL_ANIM_GAMMA);
+		g_rgbpixel_scale_lut_value = g_rgbpixel_value;
+		led_effect_invalidate(&g_rgbpixel_effect);
+	}
 }
 
 static void enhanced_rgbpixel_anim(void *priv)
 {
-		if(rgbpixel_anim_counter <= 23)
-		rgbpixel_anim_counter = rgbpixel_anim_counter + 1;
-		else
-		rgbpixel_anim_counter = 0;
-		if (rgbpixel_anim_counter == 0) {
-			rgbpixel_anim_up = !rgbpixel_anim_up; // swap
-		}
-
-		// 0.0->1.0 per duration
-		double ratio = rgbpixel_anim_counter * 0.041;
-		if(rgbpixel_anim_style == 0){
-			enhanced_rgbpixel_anim_spinner(rgbpixel_spin_blue_bg, rgbpixel_spin_blue_fg, rgbpixel_anim_counter);
-		} else if(rgbpixel_anim_style == 1){
-			enhanced_rgbpixel_anim_pulse(rgbpixel_pulse_blue_min, rgbpixel_pulse_blue_max, ratio, rgbpixel_anim_up);
-		} else if(rgbpixel_anim_style == 2){
-			enhanced_rgbpixel_anim_pulse(rgbpixel_pulse_red_min, rgbpixel_pulse_red_max, ratio, rgbpixel_anim_up);
-		} else if(rgbpixel_anim_style == 3){
-			enhanced_rgbpixel_anim_pulse(rgbpixel_pulse_green_min, rgbpixel_pulse_green_max, ratio, rgbpixel_anim_up);
-		}
-		g_rgbpixel_strip->refresh(g_rgbpixel_strip, 100);
+	enhanced_rgbpixel_update_scale();
+	led_effect_render(&g_rgbpixel_effect, esp_timer_get_time());
+	// A frame still on the wire means this one is dropped, the next tick catches up
+	g_rgbpixel_strip->refresh_async(g_rgbpixel_strip);
 }
 
 static void enhanced_rgbpixel_anim_duration(void *priv)
 {
 	esp_timer_stop(rgbpixel_anim_timer);
+	const led_effect_stats_t *stats = &g_rgbpixel_effect.stats[g_rgbpixel_effect.id];
 	ESP_LOGI(TAG, "Enhanced rgbpixel animation is ending now");
+	ESP_LOGD(TAG, "%s: %u frames (%u cached), %u cycles per frame, %u max", led_effect_name(g_rgbpixel_effect.id),
+			stats->frames, stats->replayed, stats->frames ? (uint32_t)(stats->cycles / stats->frames) : 0,
+			stats->max_cycles);
 	if(!g_rgbpixel_power_state)
 		g_rgbpixel_strip->clear(g_rgbpixel_strip, 100);
 	else
 		app_driver_rgbpixel_set(g_rgbpixel_hue, g_rgbpixel_saturation, g_rgbpixel_value);
 }
 
-esp_err_t enhanced_rgbpixel_set_anim(const char *type)
+esp_err_t enhanced_rgbpixel_set_anim(rgbpixel_anim_t anim)
 {
-	if(strcmp(type, "ERROR") == 0) {
-		rgbpixel_anim_style = 2;
-	} else if (strcmp(type, "OTA") == 0) {
-		rgbpixel_anim_style = 2;
-	} else if (strcmp(type, "LOAD") == 0) {
-		rgbpixel_anim_style = 0;
-	} else if (strcmp(type, "MOVE") == 0) {
-		rgbpixel_anim_style = 1;
+	if (anim >= RGBPIXEL_ANIM_MAX) {
+		return ESP_ERR_INVALID_ARG;
 	}
+	led_effect_start(&g_rgbpixel_effect, s_rgbpixel_anims[anim].effect, &s_rgbpixel_anims[anim].params,
+			esp_timer_get_time());
 	esp_timer_start_periodic(rgbpixel_anim_timer, DEFAULT_REFRESH_ANIM_PERIOD_RGBPIXEL * 1000U);
 	esp_timer_start_once(rgbpixel_anim_duration_timer, DEFAULT_ANIM_DURATION_RGBPIXEL * 1000000U);
 	return ESP_OK;
@@ -244,7 +346,7 @@ esp_err_t app_driver_rgbpixel_set(uint32_t hue, uint32_t saturation, uint32_t br
     /* Whenever this function is called, light power will be ON */
     if (!g_rgbpixel_power_state) {
         g_rgbpixel_power_state = true;
-		esp_rmaker_param_update_and_report(
+		app_driver_report_param(
                 esp_rmaker_device_get_param_by_type(rgb_ring_light, ESP_RMAKER_PARAM_POWER),
                 esp_rmaker_bool(g_rgbpixel_power_state));
     }
@@ -278,41 +380,414 @@ esp_err_t app_driver_rgbpixel_set_saturation(uint16_t saturation)
     return app_driver_rgbpixel_set(g_rgbpixel_hue, g_rgbpixel_saturation, g_rgbpixel_value);
 }
 
-static void app_driver_sensor_bh1750_update(void *pvParameters)
+/* Seconds since boot until the clock is set, then wall-clock buckets: what was kept so far is moved over once */
+static void app_driver_sensor_history_add(sensor_history_t *history, int32_t value)
 {
-	i2c_dev_t dev17;
-    memset(&dev17, 0, sizeof(i2c_dev_t)); // Zero descriptor
+    static bool wall_clock;
+    uint32_t boot_s = esp_timer_get_time() / 1000000;
+    time_t now = time(NULL);
+    if (!wall_clock && now >= DEFAULT_SENSOR_LOG_MIN_TIME) {
+        wall_clock = true;
+        sensor_history_rebase(&g_luminosity_history, (uint32_t)now - boot_s);
+        sensor_history_rebase(&g_temperature_history, (uint32_t)now - boot_s);
+        sensor_history_rebase(&g_humidity_history, (uint32_t)now - boot_s);
+    }
+    sensor_history_add(history, value, wall_clock ? (uint32_t)now : boot_s);
+}
 
-    ESP_ERROR_CHECK(bh1750_init_desc(&dev17, ADDR_BH1750, 0, g_i2c_sda, g_i2c_scl));
-    ESP_ERROR_CHECK(bh1750_setup(&dev17, BH1750_MODE_CONTINIOUS, BH1750_RES_HIGH));
-	
-	uint16_t lux;
-	if (bh1750_read(&dev17, &lux) != ESP_OK)
+static void app_driver_sensor_log(uint8_t channel, int32_t value)
+{
+    time_t now = time(NULL);
+    if (!g_sensor_log_ready || now < DEFAULT_SENSOR_LOG_MIN_TIME) {
+        return;
+    }
+    if (sensor_log_append(&g_sensor_log, channel, value, (uint32_t)now) != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor log queue full, sample dropped");
+    }
+}
+
+/* Publish the oldest samples not uploaded yet, as {"d":[["temperature",1700000000,21.53],...]} */
+static esp_err_t app_driver_sensor_log_upload(bool *more)
+{
+    static sensor_log_sample_t samples[DEFAULT_SENSOR_LOG_UPLOAD_BATCH];
+    static char payload[DEFAULT_SENSOR_LOG_UPLOAD_BATCH * 44 + 16];
+    sensor_log_cursor_t cursor;
+    sensor_log_backlog(&g_sensor_log, &cursor);
+    size_t n = sensor_log_read(&g_sensor_log, &cursor, samples, DEFAULT_SENSOR_LOG_UPLOAD_BATCH);
+    *more = n == DEFAULT_SENSOR_LOG_UPLOAD_BATCH;
+    if (!n) {
+        return ESP_OK;
+    }
+    int len = snprintf(payload, sizeof(payload), "{\"d\":[");
+    for (size_t i = 0; i < n; i++) {
+        uint32_t mag = samples[i].value < 0 ? 0U - (uint32_t)samples[i].value : (uint32_t)samples[i].value;
+        len += snprintf(payload + len, sizeof(payload) - len, "%s[\"%s\",%u,%s%u.%02u]", i ? "," : "",
+                        g_sensor_log_params[samples[i].channel], (unsigned)samples[i].time_s,
+                        samples[i].value < 0 ? "-" : "", (unsigned)(mag / 100), (unsigned)(mag % 100));
+    }
+    len += snprintf(payload + len, sizeof(payload) - len, "]}");
+    char topic[64];
+    snprintf(topic, sizeof(topic), "node/%s/sensorlog", esp_rmaker_get_node_id());
+    esp_err_t err = esp_rmaker_mqtt_publish(topic, payload, len, 1, NULL);
+    if (err == ESP_OK) {
+        err = sensor_log_ack(&g_sensor_log, &cursor);
+    }
+    return err;
+}
+
+/* Scheduler entry: the flash writes and the publish run on the sensor log task, sized for them */
+static void app_driver_sensor_log_update(sensor_sched_entry_t *entry)
+{
+    g_sensor_log_due = true;
+    xTaskNotifyGive(g_sensor_log_task);
+}
+
+bool app_driver_sensor_log_step(void)
+{
+    if (!g_sensor_log_due) {
+        return false;
+    }
+    g_sensor_log_due = false;
+    static bool drained;
+    static uint32_t outages;
+    esp_err_t err = sensor_log_flush(&g_sensor_log);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Sensor log write failed (%s)", esp_err_to_name(err));
+    }
+    // Down since the last flush, even briefly: there is a backlog again
+    if (outages != g_sensor_log_outages) {
+        outages = g_sensor_log_outages;
+        drained = false;
+    }
+    if (err == ESP_OK && g_sensor_log_online) {
+        if (drained) {
+            err = sensor_log_ack(&g_sensor_log, &g_sensor_log.writer);
+        } else {
+            bool more = true;
+            for (int i = 0; more && err == ESP_OK && i < DEFAULT_SENSOR_LOG_UPLOAD_BATCHES; i++) {
+                err = app_driver_sensor_log_upload(&more);
+            }
+            drained = err == ESP_OK && !more;
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Sensor log upload failed (%s), retrying", esp_err_to_name(err));
+            }
+        }
+    }
+    sensor_sched_report(&g_sensor_log_sched, err);
+    return true;
+}
+
+static void app_driver_sensor_log_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        app_driver_sensor_log_step();
+    }
+}
+
+void app_driver_sensor_log_set_online(bool online)
+{
+    if (!online) {
+        g_sensor_log_outages++;
+    }
+    g_sensor_log_online = online;
+}
+
+const sensor_log_t *app_driver_sensor_get_log(void)
+{
+    return g_sensor_log_ready ? &g_sensor_log : NULL;
+}
+
+static esp_err_t app_driver_sensor_bh1750_setup(void)
+{
+    // In one time mode this leaves the sensor powered down until the first sample
+    esp_err_t err = bh1750_set_range(&g_bh1750_dev, g_bh1750_mode, &g_bh1750_range);
+    g_bh1750_ready = err == ESP_OK;
+    return err;
+}
+
+static esp_err_t app_driver_sensor_sht31_setup(void)
+{
+    // Still free running after an MCU-only reboot: the soft reset is only accepted once idle.
+    // The break waits out its settle time; a NACK means there was nothing to stop
+    sht3x_stop_periodic_measurement(&g_sht31_dev);
+    // Soft reset, then 100 ms before the status read: done once, not per sample
+    g_sht31_dev.repeatability = g_sht31_repeat;
+    esp_err_t err = sht3x_init(&g_sht31_dev);
+    if (err == ESP_OK && DEFAULT_SHT31_MODE != SHT3X_SINGLE_SHOT) {
+        // Free running from here on, every sample is a single fetch
+        err = sht3x_start_measurement(&g_sht31_dev, DEFAULT_SHT31_MODE, g_sht31_dev.repeatability);
+    }
+    g_sht31_ready = err == ESP_OK;
+    return err;
+}
+
+/*
+ * BH1750 sample. In one time mode the measurement command goes out on the
+ * bus task, a one-shot timer reads the result once the integration time is
+ * over and the sensor powers down by itself. Free running, the latest
+ * result is read right away. The scheduler task processes each result,
+ * which picks the range of the next one.
+ */
+static volatile bool g_bh1750_measuring;
+
+/* Ends a sample, on whichever task saw it through */
+static void app_driver_sensor_bh1750_end(esp_err_t result)
+{
+    g_bh1750_measuring = false;
+    sensor_sched_report(&g_bh1750_sched, result);
+}
+
+/* Runs on the I2C bus task: the reading stays in g_bh1750_raw until the sample ends */
+static void app_driver_sensor_bh1750_done(i2c_dev_request_t *req)
+{
+    sensor_sched_complete(&g_bh1750_sched);
+}
+
+static uint8_t g_bh1750_raw[BH1750_RAW_DATA_SIZE];
+static i2c_dev_request_t g_bh1750_req = {
+    .dev = &g_bh1750_dev,
+    .data = g_bh1750_raw,
+    .size = sizeof(g_bh1750_raw),
+    .callback = app_driver_sensor_bh1750_done,
+};
+
+/* Runs on the scheduler task */
+static void app_driver_sensor_bh1750_process(sensor_sched_entry_t *entry)
+{
+	uint32_t lux;
+	esp_err_t result = g_bh1750_req.result;
+	if (result != ESP_OK || bh1750_compute_lux_centi(g_bh1750_raw, &g_bh1750_range, &lux) != ESP_OK) {
 		ESP_LOGE(TAG, "BH1750 error, could not read sensor data");
-	g_sensor_luminosity = lux;
-	esp_rmaker_param_update_and_report(
+		app_driver_sensor_bh1750_end(result != ESP_OK ? result : ESP_FAIL);
+		return;
+	}
+	// Off the bus task, the range change may wait on the bus. This is the only sample in flight
+	bool reranged = DEFAULT_BH1750_AUTORANGE && bh1750_autorange(g_bh1750_raw, &g_bh1750_range);
+	if (reranged && app_driver_sensor_bh1750_setup() != ESP_OK) {
+		ESP_LOGW(TAG, "BH1750 range change failed, retrying on the next sample");
+	}
+	app_driver_sensor_bh1750_end(ESP_OK);
+	int64_t now_us = esp_timer_get_time();
+	app_driver_sensor_history_add(&g_luminosity_history, lux);
+	app_driver_sensor_log(SENSOR_LOG_LUMINOSITY, lux);
+	uint32_t lux_period_ms = sensor_rate_update(&g_luminosity_rate, lux, now_us);
+	if (APP_DRIVER_SENSOR_SWEEP) {
+		app_driver_sensor_sht31_period();
+	} else {
+		sensor_sched_set_period(&g_bh1750_sched, lux_period_ms);
+	}
+	// Clipped or coarse, and the light changed a lot: the filter starts over from the next sample
+	if (reranged) {
+		sensor_filter_reset(&g_luminosity_filter);
+		return;
+	}
+	int32_t filtered;
+	if (!sensor_filter_apply(&g_luminosity_filter, lux, &filtered)) {
+		return;
+	}
+	g_sensor_luminosity = filtered >= UINT16_MAX * 100 ? UINT16_MAX : (filtered + 50) / 100;
+	if (sensor_report_check(&g_luminosity_report, filtered, now_us)) {
+		app_driver_report_param(
                 esp_rmaker_device_get_param_by_name(luminosity_sensor, "luminosity"),
-                esp_rmaker_float(g_sensor_luminosity));
+                esp_rmaker_float(filtered / 100.0f));
+	}
 }
-static void app_driver_sensor_sht31_update(void *pvParameters)
+
+static void app_driver_sensor_bh1750_fetch(void *pvParameters)
 {
-	sht3x_t dev31;
-	memset(&dev31, 0, sizeof(sht3x_t)); // Zero descriptor
+    if (i2c_dev_submit(&g_bh1750_req) != ESP_OK) {
+        ESP_LOGE(TAG, "BH1750 error, could not queue read");
+        app_driver_sensor_bh1750_end(ESP_FAIL);
+    }
+}
 
-    ESP_ERROR_CHECK(sht3x_init_desc(&dev31, 0, ADDR_SHT31, g_i2c_sda, g_i2c_scl));
-    ESP_ERROR_CHECK(sht3x_init(&dev31));
-	
-	float temp;
-    float humid;
-	ESP_ERROR_CHECK(sht3x_measure(&dev31, &temp, &humid));
-	g_sensor_temperature = temp;
-	g_sensor_humidity = humid;
-	esp_rmaker_param_update_and_report(
-                esp_rmaker_device_get_param_by_type(temperature_sensor, ESP_RMAKER_PARAM_TEMPERATURE),
-                esp_rmaker_float(g_sensor_temperature));
-	esp_rmaker_param_update_and_report(
-                esp_rmaker_device_get_param_by_name(humidity_sensor, "humidity"),
-                esp_rmaker_float(g_sensor_humidity));
+/* Runs on the I2C bus task */
+static void app_driver_sensor_bh1750_started(i2c_dev_request_t *req)
+{
+    if (req->result != ESP_OK ||
+        esp_timer_start_once(bh1750_fetch_timer, bh1750_get_measurement_duration_us(&g_bh1750_range)) != ESP_OK) {
+        ESP_LOGE(TAG, "BH1750 error, could not start measurement");
+        app_driver_sensor_bh1750_end(req->result != ESP_OK ? req->result : ESP_FAIL);
+    }
+}
+
+static i2c_dev_request_t g_bh1750_start_req = {
+    .callback = app_driver_sensor_bh1750_started,
+};
+
+static void app_driver_sensor_bh1750_sample(void)
+{
+    if (!g_bh1750_ready && app_driver_sensor_bh1750_setup() != ESP_OK) {
+        ESP_LOGE(TAG, "BH1750 error, could not set up sensor");
+        sensor_sched_report(&g_bh1750_sched, ESP_FAIL);
+        return;
+    }
+    // The bus task reads, so a stuck sensor never holds up the scheduler
+    if (g_bh1750_measuring) {
+        ESP_LOGW(TAG, "BH1750 measurement still running, sample skipped");
+        sensor_sched_report(&g_bh1750_sched, ESP_ERR_TIMEOUT);
+        return;
+    }
+    g_bh1750_measuring = true;
+    if (g_bh1750_mode == BH1750_MODE_ONE_TIME) {
+        if (bh1750_start_measurement_async(&g_bh1750_dev, &g_bh1750_start_req, g_bh1750_range.resolution) != ESP_OK) {
+            ESP_LOGE(TAG, "BH1750 error, could not queue measurement");
+            app_driver_sensor_bh1750_end(ESP_FAIL);
+        }
+    } else {
+        app_driver_sensor_bh1750_fetch(NULL);
+    }
+}
+
+static void app_driver_sensor_bh1750_update(sensor_sched_entry_t *entry)
+{
+    app_driver_sensor_bh1750_sample();
+}
+
+/*
+ * SHT31 sweep. Free running, the latest sample is fetched right away and the
+ * BH1750 has its own scheduler entry. In single shot mode the command goes
+ * out first (the SHT31 descriptor has the higher bus priority), the BH1750
+ * request fills the conversion window, and a one-shot timer fetches the
+ * SHT31 result once the conversion is over.
+ * The bus task and the timer only move the steps along, the scheduler task
+ * processes the result.
+ */
+static i2c_dev_request_t g_sht31_req;
+static sht3x_raw_data_t g_sht31_raw;
+static volatile bool g_sht31_sweeping;
+
+/* Ends a sweep, on whichever task saw it through */
+static void app_driver_sensor_sht31_end(esp_err_t result)
+{
+    g_sht31_sweeping = false;
+    sensor_sched_report(&g_sht31_sched, result);
+}
+
+/* Runs on the I2C bus task: the reading stays in g_sht31_raw until the sweep ends */
+static void app_driver_sensor_sht31_fetched(i2c_dev_request_t *req)
+{
+    sensor_sched_complete(&g_sht31_sched);
+}
+
+/* Runs on the scheduler task */
+static void app_driver_sensor_sht31_process(sensor_sched_entry_t *entry)
+{
+	int16_t temp;
+    int16_t humid;
+    esp_err_t result = g_sht31_req.result;
+    if (result != ESP_OK || sht3x_check_raw_data(&g_sht31_dev, g_sht31_raw) != ESP_OK ||
+        sht3x_compute_values_centi(g_sht31_raw, &temp, &humid) != ESP_OK) {
+        ESP_LOGE(TAG, "SHT31 error, could not read sensor data");
+        app_driver_sensor_sht31_end(result != ESP_OK ? result : ESP_FAIL);
+        return;
+    }
+    app_driver_sensor_sht31_end(ESP_OK);
+	int64_t now_us = esp_timer_get_time();
+	app_driver_sensor_history_add(&g_temperature_history, temp);
+	app_driver_sensor_history_add(&g_humidity_history, humid);
+	app_driver_sensor_log(SENSOR_LOG_TEMPERATURE, temp);
+	app_driver_sensor_log(SENSOR_LOG_HUMIDITY, humid);
+	sensor_rate_update(&g_temperature_rate, temp, now_us);
+	sensor_rate_update(&g_humidity_rate, humid, now_us);
+	app_driver_sensor_sht31_period();
+	// Only what moved past its deadband once filtered, or went unreported for too long, is published
+	int32_t filtered;
+	if (sensor_filter_apply(&g_temperature_filter, temp, &filtered)) {
+		g_sensor_temperature = filtered / 100.0f;
+		if (sensor_report_check(&g_temperature_report, filtered, now_us)) {
+			app_driver_report_param(
+	                esp_rmaker_device_get_param_by_type(temperature_sensor, ESP_RMAKER_PARAM_TEMPERATURE),
+	                esp_rmaker_float(g_sensor_temperature));
+		}
+	}
+	if (sensor_filter_apply(&g_humidity_filter, humid, &filtered)) {
+		g_sensor_humidity = filtered / 100.0f;
+		if (sensor_report_check(&g_humidity_report, filtered, now_us)) {
+			app_driver_report_param(
+	                esp_rmaker_device_get_param_by_name(humidity_sensor, "humidity"),
+	                esp_rmaker_float(g_sensor_humidity));
+		}
+	}
+}
+
+static void app_driver_sensor_sht31_fetch(void *pvParameters)
+{
+    g_sht31_req.callback = app_driver_sensor_sht31_fetched;
+    if (sht3x_get_raw_data_async(&g_sht31_dev, &g_sht31_req, g_sht31_raw) != ESP_OK) {
+        ESP_LOGE(TAG, "SHT31 error, could not queue fetch");
+        app_driver_sensor_sht31_end(ESP_FAIL);
+    }
+}
+
+/* Runs on the I2C bus task */
+static void app_driver_sensor_sht31_started(i2c_dev_request_t *req)
+{
+    if (req->result != ESP_OK ||
+        esp_timer_start_once(sht31_fetch_timer, sht3x_get_measurement_duration_us(g_sht31_dev.repeatability)) != ESP_OK) {
+        ESP_LOGE(TAG, "SHT31 error, could not start measurement");
+        app_driver_sensor_sht31_end(req->result != ESP_OK ? req->result : ESP_FAIL);
+    }
+}
+
+static void app_driver_sensor_sht31_update(sensor_sched_entry_t *entry)
+{
+    if (!g_sht31_ready && app_driver_sensor_sht31_setup() != ESP_OK) {
+        ESP_LOGE(TAG, "SHT31 error, could not set up sensor");
+        sensor_sched_report(&g_sht31_sched, ESP_FAIL);
+        return;
+    }
+    if (g_sht31_sweeping) {
+        ESP_LOGW(TAG, "SHT31 measurement still running, sample skipped");
+        sensor_sched_report(&g_sht31_sched, ESP_ERR_TIMEOUT);
+        return;
+    }
+    sht3x_repeat_t repeat = g_sht31_repeat;
+    if (g_sht31_dev.repeatability != repeat) {
+        // Free running, this breaks and restarts the measurement: nothing to fetch before it is done
+        bool restart = g_sht31_dev.mode != SHT3X_SINGLE_SHOT;
+        esp_err_t err = sht3x_set_repeatability(&g_sht31_dev, repeat);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "SHT31 error, could not change repeatability");
+            g_sht31_ready = false;
+            sensor_sched_report(&g_sht31_sched, err);
+            return;
+        }
+        if (restart) {
+            return;
+        }
+    }
+    g_sht31_sweeping = true;
+    if (g_sht31_dev.mode != SHT3X_SINGLE_SHOT) {
+        // Just (re)started, the first result takes a whole period: a fetch before it is NACKed
+        uint32_t wait_us = sht3x_get_result_wait_us(&g_sht31_dev);
+        if (!wait_us) {
+            app_driver_sensor_sht31_fetch(NULL);
+        } else if (esp_timer_start_once(sht31_fetch_timer, wait_us) != ESP_OK) {
+            ESP_LOGE(TAG, "SHT31 error, could not wait for the first result");
+            app_driver_sensor_sht31_end(ESP_FAIL);
+        }
+    } else {
+        g_sht31_req.callback = app_driver_sensor_sht31_started;
+        if (sht3x_start_measurement_async(&g_sht31_dev, &g_sht31_req, SHT3X_SINGLE_SHOT,
+                                          g_sht31_dev.repeatability) != ESP_OK) {
+            ESP_LOGE(TAG, "SHT31 error, could not queue measurement");
+            app_driver_sensor_sht31_end(ESP_FAIL);
+        }
+    }
+    if (APP_DRIVER_SENSOR_SWEEP) {
+        app_driver_sensor_bh1750_sample();
+    }
+}
+
+esp_err_t app_driver_sensor_set_sht31_repeatability(sht3x_repeat_t repeat)
+{
+    if (repeat > SHT3X_LOW) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_sht31_repeat = repeat;
+    return ESP_OK;
 }
 
 uint16_t app_driver_sensor_get_current_luminosity()
@@ -330,31 +805,76 @@ float app_driver_sensor_get_current_humidity()
     return g_sensor_humidity;
 }
 
+const sensor_report_t *app_driver_sensor_get_report(const char *param)
+{
+    if (!strcmp(param, "luminosity")) {
+        return &g_luminosity_report;
+    }
+    if (!strcmp(param, "temperature")) {
+        return &g_temperature_report;
+    }
+    if (!strcmp(param, "humidity")) {
+        return &g_humidity_report;
+    }
+    return NULL;
+}
+
+const sensor_filter_t *app_driver_sensor_get_filter(const char *param)
+{
+    if (!strcmp(param, "luminosity")) {
+        return &g_luminosity_filter;
+    }
+    if (!strcmp(param, "temperature")) {
+        return &g_temperature_filter;
+    }
+    if (!strcmp(param, "humidity")) {
+        return &g_humidity_filter;
+    }
+    return NULL;
+}
+
+const sensor_history_t *app_driver_sensor_get_history(const char *param)
+{
+    if (!strcmp(param, "luminosity")) {
+        return &g_luminosity_history;
+    }
+    if (!strcmp(param, "temperature")) {
+        return &g_temperature_history;
+    }
+    if (!strcmp(param, "humidity")) {
+        return &g_humidity_history;
+    }
+    return NULL;
+}
+
 esp_err_t app_driver_rgbpixel_init(void)
 {
-	rgbpixel_spin_blue_bg = enhanced_rgbpixel_color(0, 0, 255);
-	rgbpixel_spin_blue_fg = enhanced_rgbpixel_color(0, 255, 255);
-	rgbpixel_pulse_blue_min = enhanced_rgbpixel_color(0, 0, 255);
-	rgbpixel_pulse_blue_max = enhanced_rgbpixel_color(0, 255, 255);
-	rgbpixel_pulse_red_min = enhanced_rgbpixel_color(40, 17, 0);
-	rgbpixel_pulse_red_max = enhanced_rgbpixel_color(255, 17, 0);
-	rgbpixel_pulse_green_min = enhanced_rgbpixel_color(0, 17, 0);
-	rgbpixel_pulse_green_max = enhanced_rgbpixel_color(0, 255, 0);
-	
     rmt_config_t config = RMT_DEFAULT_CONFIG_TX(g_gpio_rgbpixel_strip, RMT_TX_CHANNEL);
     // set counter clock to 40MHz
     config.clk_div = 2;
+    // Larger ping-pong halves: fewer refill interrupts per frame and more slack before the line underruns
+    config.mem_block_num = DEFAULT_RGBPIXEL_RMT_MEM_BLOCKS;
 
     ESP_ERROR_CHECK(rmt_config(&config));
     ESP_ERROR_CHECK(rmt_driver_install(config.channel, 0, 0));
 
     // install ws2812 driver
     led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(g_rgbpixel_strip_pixels, (led_strip_dev_t)config.channel);
+    strip_config.pre_encode = g_rgbpixel_strip_pixels <= DEFAULT_RGBPIXEL_PRE_ENCODE_MAX_PIXELS;
     g_rgbpixel_strip = led_strip_new_rmt_ws2812(&strip_config);
     if (!g_rgbpixel_strip) {
         ESP_LOGE(TAG, "Install WS2812 driver failed");
         return ESP_FAIL;
     }
+    g_rgbpixel_effect.strip = g_rgbpixel_strip;
+    g_rgbpixel_effect.num_pixels = g_rgbpixel_strip_pixels;
+    g_rgbpixel_effect.scale = g_rgbpixel_scale_lut;
+    g_rgbpixel_effect.id = LED_EFFECT_MAX;
+#if DEFAULT_ANIM_CACHE_SIZE_RGBPIXEL
+    g_rgbpixel_effect.cache = g_rgbpixel_anim_cache;
+    g_rgbpixel_effect.cache_size = sizeof(g_rgbpixel_anim_cache);
+    g_rgbpixel_effect.frame_us = DEFAULT_REFRESH_ANIM_PERIOD_RGBPIXEL * 1000U;
+#endif
     if (g_rgbpixel_power_state) {
         app_driver_rgbpixel_set_pixel(g_rgbpixel_hue, g_rgbpixel_saturation, g_rgbpixel_value);
     } else {
@@ -382,30 +902,59 @@ esp_err_t app_driver_rgbpixel_init(void)
 }
 
 esp_err_t app_driver_sensor_init(void)
-{	
-	ESP_ERROR_CHECK(i2cdev_init()); // Init Library
-    esp_timer_create_args_t bh1750_sensor_timer_conf = {
-        .callback = app_driver_sensor_bh1750_update,
+{
+    // Without the bus the node runs on without sensors, rather than aborting
+    esp_err_t err;
+    if ((err = i2cdev_init()) != ESP_OK ||
+        (err = i2cdev_start_bus_task(I2C_NUM_0, DEFAULT_I2C_BUS_TASK_PRIORITY)) != ESP_OK ||
+        // Descriptors (and their mutexes) live as long as the app
+        (err = bh1750_init_desc(&g_bh1750_dev, ADDR_BH1750, 0, g_i2c_sda, g_i2c_scl)) != ESP_OK ||
+        (err = sht3x_init_desc(&g_sht31_dev, 0, ADDR_SHT31, g_i2c_sda, g_i2c_scl)) != ESP_OK) {
+        ESP_LOGE(TAG, "Sensor bus init failed (%s), running without sensors", esp_err_to_name(err));
+        return err;
+    }
+    g_sht31_dev.i2c_dev.priority = 1;
+    // Slow sampling measures one time and leaves the sensor powered down in between
+    g_bh1750_mode = DEFAULT_SAMPLING_MIN_PERIOD_BH1750 >= DEFAULT_BH1750_ONE_TIME_MIN_PERIOD ?
+                    BH1750_MODE_ONE_TIME : BH1750_MODE_CONTINIOUS;
+    if (app_driver_sensor_bh1750_setup() != ESP_OK) {
+        ESP_LOGW(TAG, "BH1750 not ready, retrying on the next sample");
+    }
+    if (app_driver_sensor_sht31_setup() != ESP_OK) {
+        ESP_LOGW(TAG, "SHT31 not ready, retrying on the next sample");
+    }
+    esp_timer_create_args_t sht31_fetch_timer_conf = {
+        .callback = app_driver_sensor_sht31_fetch,
         .dispatch_method = ESP_TIMER_TASK,
-        .name = "app_driver_sensor_bh1750_update_tm"
-    };esp_timer_create_args_t sht31_sensor_timer_conf = {
-        .callback = app_driver_sensor_sht31_update,
+        .name = "app_driver_sensor_sht31_fetch_tm"
+    };
+    esp_timer_create_args_t bh1750_fetch_timer_conf = {
+        .callback = app_driver_sensor_bh1750_fetch,
         .dispatch_method = ESP_TIMER_TASK,
-        .name = "app_driver_sensor_sht31_update_tm"
+        .name = "app_driver_sensor_bh1750_fetch_tm"
     };
-    if (esp_timer_create(&bh1750_sensor_timer_conf, &bh1750_sensor_timer) == ESP_OK) {
-        esp_timer_start_periodic(bh1750_sensor_timer, DEFAULT_REPORTING_PERIOD_BH1750 * 1000000U);
+    if (esp_timer_create(&sht31_fetch_timer_conf, &sht31_fetch_timer) != ESP_OK ||
+        esp_timer_create(&bh1750_fetch_timer_conf, &bh1750_fetch_timer) != ESP_OK) {
+        return ESP_FAIL;
     }
-	else{
-		return ESP_FAIL;
-	}
-	if (esp_timer_create(&sht31_sensor_timer_conf, &sht31_sensor_timer) == ESP_OK) {
-        esp_timer_start_periodic(sht31_sensor_timer, DEFAULT_REPORTING_PERIOD_SHT31 * 1000000U);
+    // The esp_timer task is left with the short fetch callbacks
+    if (!APP_DRIVER_SENSOR_SWEEP) {
+        sensor_sched_add(&g_bh1750_sched);
     }
-	else{
-		return ESP_FAIL;
-	}
-	return ESP_OK;
+    sensor_sched_add(&g_sht31_sched);
+    const esp_partition_t *log_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+            (esp_partition_subtype_t)DEFAULT_SENSOR_LOG_PARTITION_SUBTYPE, DEFAULT_SENSOR_LOG_PARTITION);
+    if (!log_partition || (err = sensor_log_open(&g_sensor_log, log_partition)) != ESP_OK) {
+        ESP_LOGW(TAG, "No sensor log (%s), samples are not kept across reboots",
+                 log_partition ? esp_err_to_name(err) : "partition not found");
+    } else if (xTaskCreate(app_driver_sensor_log_task, "sensor_log", DEFAULT_SENSOR_LOG_TASK_STACK, NULL,
+                           DEFAULT_SENSOR_LOG_TASK_PRIORITY, &g_sensor_log_task) != pdPASS) {
+        ESP_LOGW(TAG, "No sensor log task, samples are not kept across reboots");
+    } else {
+        g_sensor_log_ready = true;
+        sensor_sched_add(&g_sensor_log_sched);
+    }
+    return sensor_sched_start(DEFAULT_SENSOR_SCHED_TASK_PRIORITY);
 }
 
 static void push_btn_cb(void *arg)
@@ -413,7 +962,7 @@ static void push_btn_cb(void *arg)
 	ESP_LOGI(TAG, "Change state of Bedroom Light and sync it with cloud");
 	bool new_light0_state = !g_light0_power_state;
 	app_driver_set_light0_power(new_light0_state);
-	esp_rmaker_param_update_and_report(
+	app_driver_report_param(
                 esp_rmaker_device_get_param_by_type(bedroom_light, ESP_RMAKER_PARAM_POWER),
                 esp_rmaker_bool(new_light0_state));
 }
@@ -437,6 +986,14 @@ static void set_light3_power_state(bool target)
 
 void app_driver_init()
 {
+    esp_timer_create_args_t report_flush_timer_conf = {
+        .callback = app_driver_report_flush,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "app_driver_report_flush_tm"
+    };
+    if (esp_timer_create(&report_flush_timer_conf, &report_flush_timer) != ESP_OK) {
+        ESP_LOGW(TAG, "Report batching unavailable, params are reported one by one");
+    }
     button_handle_t btn_handle = iot_button_create(BUTTON_GPIO, BUTTON_ACTIVE_LEVEL);
     if (btn_handle) {
 		/* Register a callback for a button tap (short press) event */
@@ -504,7 +1061,7 @@ esp_err_t app_driver_set_light0_brightness(uint16_t brightness)
 {
     g_light0_value = brightness;
 	g_light0_power_state = 1;
-	esp_rmaker_param_update_and_report(
+	app_driver_report_param(
                 esp_rmaker_device_get_param_by_type(bedroom_light, ESP_RMAKER_PARAM_POWER),
                 esp_rmaker_bool(g_light0_power_state));
     return app_driver_set_light0();
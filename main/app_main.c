@@ -18,6 +18,7 @@
 #include <esp_rmaker_schedule.h>
 #include <esp_rmaker_standard_params.h>
 #include <esp_rmaker_standard_devices.h>
+#include <esp_rmaker_common_events.h>
 
 #include <app_wifi.h>
 
@@ -84,11 +85,22 @@ static esp_err_t write_cb(const esp_rmaker_device_t *device, const esp_rmaker_pa
 		/* Silently ignoring invalid params */
 		return ESP_OK;
 	}
-	enhanced_rgbpixel_set_anim("LOAD");
-	esp_rmaker_param_update_and_report(param, val);
+	enhanced_rgbpixel_set_anim(RGBPIXEL_ANIM_LOAD);
+	// Goes out in the same publish as the params the driver changed along with it
+	app_driver_report_param(param, val);
     return ESP_OK;
 }
 
+/* The sensor log uploads what was sampled while MQTT was down */
+static void rmaker_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_id == RMAKER_MQTT_EVENT_CONNECTED) {
+        app_driver_sensor_log_set_online(true);
+    } else if (event_id == RMAKER_MQTT_EVENT_DISCONNECTED) {
+        app_driver_sensor_log_set_online(false);
+    }
+}
+
 void app_main()
 {
     /* Initialize Application specific hardware drivers and
@@ -107,6 +119,7 @@ void app_main()
     /* Initialize Wi-Fi. Note that, this should be called before esp_rmaker_init()
      */
     app_wifi_init();
+    esp_event_handler_register(RMAKER_COMMON_EVENT, ESP_EVENT_ANY_ID, rmaker_event_handler, NULL);
     
     /* Initialize the ESP RainMaker Agent.
      * Note that this should be called after app_wifi_init() but before app_wifi_start()
@@ -9,9 +9,19 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <esp_err.h>
+#include <sht3x.h>
+#include <sensor_report.h>
+#include <sensor_filter.h>
+#include <sensor_rate.h>
+#include <sensor_history.h>
+#include <sensor_log.h>
 
 #define DEFAULT_I2C_SDA_GPIO 21
 #define DEFAULT_I2C_SCL_GPIO 22
+#define DEFAULT_I2C_BUS_TASK_PRIORITY 5 /* Below the esp_timer task that drives the LED animations */
+#define DEFAULT_SENSOR_SCHED_TASK_PRIORITY 4 /* Below the bus task, it only queues work for it */
+#define DEFAULT_SENSOR_LOG_TASK_PRIORITY 3 /* Below the scheduler, a flush or upload never holds up a sample */
+#define DEFAULT_SENSOR_LOG_TASK_STACK 6144 /* The backlog upload runs the MQTT publish, and its TLS write, on this task */
 
 #define DEFAULT_OUTPUT_GPIO_RGBPIXEL_STRIP 5
 #define DEFAULT_OUTPUT_GPIO_RELAY_0 19
@@ -23,16 +33,52 @@
 #define DEFAULT_LIGHT3_POWER_STATE false
 #define DEFAULT_LIGHT0_BRIGHTNESS  25
 
-#define DEFAULT_RGBPIXEL_STRIP_PIXELS 24
+#define DEFAULT_RGBPIXEL_STRIP_PIXELS 24 /* Up to 65535 */
 #define DEFAULT_RGBPIXEL_POWER_STATE false
 #define DEFAULT_RGBPIXEL_HUE         180
 #define DEFAULT_RGBPIXEL_SATURATION  100
 #define DEFAULT_RGBPIXEL_BRIGHTNESS  15
+#define DEFAULT_RGBPIXEL_ANIM_GAMMA  false /* Perceptual gamma on animation colors */
 #define DEFAULT_REFRESH_ANIM_PERIOD_RGBPIXEL 40 /* Miliseconds */
 #define DEFAULT_ANIM_DURATION_RGBPIXEL 3 /* Seconds */
+#define DEFAULT_ANIM_CACHE_SIZE_RGBPIXEL 2048 /* Bytes of pre-rendered frames, 0 renders every frame live */
+#define DEFAULT_RGBPIXEL_PRE_ENCODE_MAX_PIXELS 64 /* Keep shorter strips RMT-encoded (96 bytes per LED), encode longer ones while streaming */
+#define DEFAULT_RGBPIXEL_RMT_MEM_BLOCKS 4 /* RMT memory blocks (64 items each) for the strip channel, the following channels give theirs up */
 
-#define DEFAULT_REPORTING_PERIOD_BH1750    60 /* Seconds */
-#define DEFAULT_REPORTING_PERIOD_SHT31    305 /* Seconds */
+#define DEFAULT_SAMPLING_MIN_PERIOD_BH1750   5 /* Seconds, while the light changes */
+#define DEFAULT_SAMPLING_MAX_PERIOD_BH1750 120 /* Seconds, while it holds still; a multiple of the minimum */
+#define DEFAULT_SAMPLING_MIN_PERIOD_SHT31   10 /* Seconds, e.g. with a window open; no shorter than a measurement of DEFAULT_SHT31_MODE */
+#define DEFAULT_SAMPLING_MAX_PERIOD_SHT31  600 /* Seconds, under DEFAULT_REPORT_MAX_SILENT_INTERVAL */
+#define DEFAULT_SAMPLING_PHASE_BH1750     1000 /* Milliseconds from start to the first sample */
+#define DEFAULT_SAMPLING_PHASE_SHT31      2700 /* Staggered: periods are whole seconds, so a BH1750 measurement (up to 660 ms) is always over by then */
+#define DEFAULT_SENSOR_ERROR_BUDGET       3 /* Failed samples in a row before a sensor is sampled less often */
+#define DEFAULT_FILTER_MEDIAN_LUMINOSITY      3 /* Samples, a single glitch or passing shadow is not published */
+#define DEFAULT_FILTER_EMA_SHIFT_LUMINOSITY   0 /* No averaging: a light switched on is published on the next sample */
+#define DEFAULT_FILTER_OUTLIER_LUMINOSITY     0 /* Hundredths of a lux, 0 keeps every sample: light legitimately jumps */
+#define DEFAULT_FILTER_MEDIAN_TEMPERATURE     3
+#define DEFAULT_FILTER_EMA_SHIFT_TEMPERATURE  1 /* A sample weighs 1/2 in the average */
+#define DEFAULT_FILTER_OUTLIER_TEMPERATURE  500 /* Hundredths of a degree C between two samples */
+#define DEFAULT_FILTER_MEDIAN_HUMIDITY        3
+#define DEFAULT_FILTER_EMA_SHIFT_HUMIDITY     1
+#define DEFAULT_FILTER_OUTLIER_HUMIDITY    1500 /* Hundredths of a percent RH */
+#define DEFAULT_FILTER_OUTLIER_RUN            2 /* Outliers in a row before they are taken as a real step */
+#define DEFAULT_REPORT_DEADBAND_TEMPERATURE   20 /* Hundredths of a degree C, smaller changes are not published */
+#define DEFAULT_REPORT_DEADBAND_HUMIDITY     100 /* Hundredths of a percent RH */
+#define DEFAULT_REPORT_DEADBAND_PCT_LUMINOSITY 5 /* Percent of the last published luminosity */
+#define DEFAULT_REPORT_DEADBAND_LUMINOSITY    50 /* Hundredths of a lux, at least: keeps counting noise in the dark quiet */
+#define DEFAULT_REPORT_MAX_SILENT_INTERVAL   900 /* Seconds, a param is published at least this often */
+#define DEFAULT_REPORT_BATCH_WINDOW_MS        50 /* Params updated within this window share one publish */
+#define DEFAULT_BH1750_AUTORANGE    true /* Adjust measurement time and resolution to the light, 0.11 lx in the dark up to ~120000 lx */
+#define DEFAULT_BH1750_ONE_TIME_MIN_PERIOD 1 /* Seconds, sampling at least this slowly measures one time and powers down in between */
+#define DEFAULT_SHT31_MODE          SHT3X_PERIODIC_05MPS /* Free running, a sample is one read; SHT3X_SINGLE_SHOT measures on demand */
+#define DEFAULT_SHT31_REPEATABILITY SHT3X_HIGH
+#define DEFAULT_SENSOR_LOG_PARTITION      "sensorlog" /* Data partition of the flash sample log, see partitions.csv */
+#define DEFAULT_SENSOR_LOG_PARTITION_SUBTYPE 0x40
+#define DEFAULT_SENSOR_LOG_FLUSH_PERIOD   60 /* Seconds, samples wait in RAM in between and are written together */
+#define DEFAULT_SENSOR_LOG_PHASE          3000 /* Milliseconds from start to the first flush, after the first samples */
+#define DEFAULT_SENSOR_LOG_MIN_TIME       1609459200 /* 2021-01-01: samples are logged, and history moves to wall-clock time, once the clock is set */
+#define DEFAULT_SENSOR_LOG_UPLOAD_BATCH   32 /* Samples per publish of the backlog */
+#define DEFAULT_SENSOR_LOG_UPLOAD_BATCHES 8 /* Publishes per flush while catching up after an outage */
 
 extern esp_rmaker_device_t *bedroom_light;
 extern esp_rmaker_device_t *wall_light;
@@ -42,6 +88,8 @@ extern esp_rmaker_device_t *humidity_sensor;
 extern esp_rmaker_device_t *luminosity_sensor;
 
 void app_driver_init(void);
+/* Update a param and report it with the others changed in the same batch window */
+esp_err_t app_driver_report_param(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val);
 
 esp_err_t app_driver_set_light0_power(bool power);
 esp_err_t app_driver_set_light0_brightness(uint16_t brightness);
@@ -54,8 +102,32 @@ esp_err_t app_driver_rgbpixel_set_power(bool power);
 esp_err_t app_driver_rgbpixel_set_brightness(uint16_t brightness);
 esp_err_t app_driver_rgbpixel_set_hue(uint16_t hue);
 esp_err_t app_driver_rgbpixel_set_saturation(uint16_t saturation);
-esp_err_t enhanced_rgbpixel_set_anim(const char *type);
+typedef enum {
+    RGBPIXEL_ANIM_LOAD = 0,  /* Command received */
+    RGBPIXEL_ANIM_MOVE,
+    RGBPIXEL_ANIM_ERROR,
+    RGBPIXEL_ANIM_OTA,
+    RGBPIXEL_ANIM_MAX,
+} rgbpixel_anim_t;
+
+esp_err_t enhanced_rgbpixel_set_anim(rgbpixel_anim_t anim);
 
 uint16_t app_driver_sensor_get_current_luminosity();
 float app_driver_sensor_get_current_temperature();
 float app_driver_sensor_get_current_humidity();
+/* Sent and suppressed report counters of "luminosity", "temperature" or "humidity" */
+const sensor_report_t *app_driver_sensor_get_report(const char *param);
+/* Noise filter of the same params, with its rejected and restart counters */
+const sensor_filter_t *app_driver_sensor_get_filter(const char *param);
+/* Raw, per-minute and per-hour samples of the same params, in hundredths; seconds since boot until the clock is set,
+ * Unix seconds from then on */
+const sensor_history_t *app_driver_sensor_get_history(const char *param);
+/* Flash log of every sample, NULL without its partition */
+const sensor_log_t *app_driver_sensor_get_log(void);
+/* Flush and upload the log if the scheduler asked for it, in the calling task: the sensor log task body */
+bool app_driver_sensor_log_step(void);
+/* MQTT is up: samples logged while it was down are uploaded, later ones are reported live */
+void app_driver_sensor_log_set_online(bool online);
+/* Trade SHT31 noise for conversion time and power, at runtime. Does not block: the sensor
+   scheduler applies it between samples, and free running skips one sample while the measurement restarts */
+esp_err_t app_driver_sensor_set_sht31_repeatability(sht3x_repeat_t repeat);
@@ -36,11 +36,32 @@
 
 #define I2C_FREQ_HZ 400000
 
+// measurement times at the default MTreg, datasheet maxima in us
+#define MEAS_TIME_HIGH_US 180000
+#define MEAS_TIME_LOW_US  24000
+
+// result counts auto-ranging aims for (half scale) and keeps within
+#define AUTORANGE_TARGET 32768
+#define AUTORANGE_KEEP_MIN 8192
+#define AUTORANGE_KEEP_MAX 49152
+
 static const char *TAG = "BH1750";
 
 #define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
 #define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
 
+static uint8_t mode_opcode(bh1750_mode_t mode, bh1750_resolution_t resolution)
+{
+    uint8_t opcode = mode == BH1750_MODE_CONTINIOUS ? OPCODE_CONT : OPCODE_OT;
+    switch (resolution)
+    {
+        case BH1750_RES_LOW:  opcode |= OPCODE_LOW;   break;
+        case BH1750_RES_HIGH: opcode |= OPCODE_HIGH;  break;
+        default:              opcode |= OPCODE_HIGH2; break;
+    }
+    return opcode;
+}
+
 static esp_err_t send_command(i2c_dev_t *dev, uint8_t cmd)
 {
     I2C_DEV_TAKE_MUTEX(dev);
@@ -95,13 +116,7 @@ esp_err_t bh1750_setup(i2c_dev_t *dev, bh1750_mode_t mode, bh1750_resolution_t r
 {
     CHECK_ARG(dev);
 
-    uint8_t opcode = mode == BH1750_MODE_CONTINIOUS ? OPCODE_CONT : OPCODE_OT;
-    switch (resolution)
-    {
-        case BH1750_RES_LOW:  opcode |= OPCODE_LOW;   break;
-        case BH1750_RES_HIGH: opcode |= OPCODE_HIGH;  break;
-        default:              opcode |= OPCODE_HIGH2; break;
-    }
+    uint8_t opcode = mode_opcode(mode, resolution);
 
     CHECK(send_command(dev, opcode));
 
@@ -124,14 +139,102 @@ esp_err_t bh1750_read(i2c_dev_t *dev, uint16_t *level)
 {
     CHECK_ARG(dev && level);
 
-    uint8_t buf[2];
+    uint8_t buf[BH1750_RAW_DATA_SIZE];
 
     I2C_DEV_TAKE_MUTEX(dev);
-    I2C_DEV_CHECK(dev, i2c_dev_read(dev, NULL, 0, buf, 2));
+    I2C_DEV_CHECK(dev, i2c_dev_read(dev, NULL, 0, buf, BH1750_RAW_DATA_SIZE));
     I2C_DEV_GIVE_MUTEX(dev);
 
-    *level = buf[0] << 8 | buf[1];
+    return bh1750_compute_lux(buf, level);
+}
+
+esp_err_t bh1750_compute_lux(const uint8_t raw[BH1750_RAW_DATA_SIZE], uint16_t *level)
+{
+    CHECK_ARG(raw && level);
+
+    *level = raw[0] << 8 | raw[1];
     *level = (*level * 10) / 12; // convert to LUX
 
     return ESP_OK;
 }
+
+esp_err_t bh1750_set_range(i2c_dev_t *dev, bh1750_mode_t mode, const bh1750_range_t *range)
+{
+    CHECK_ARG(dev && range);
+
+    CHECK(bh1750_set_measurement_time(dev, range->mtreg));
+    if (mode == BH1750_MODE_ONE_TIME)
+        return bh1750_power_down(dev);
+
+    return bh1750_setup(dev, mode, range->resolution);
+}
+
+uint32_t bh1750_get_measurement_duration_us(const bh1750_range_t *range)
+{
+    uint32_t base = range->resolution == BH1750_RES_LOW ? MEAS_TIME_LOW_US : MEAS_TIME_HIGH_US;
+    return base * range->mtreg / BH1750_MTREG_DEFAULT;
+}
+
+esp_err_t bh1750_start_measurement_async(i2c_dev_t *dev, i2c_dev_request_t *req, bh1750_resolution_t resolution)
+{
+    // the request only points at its command byte
+    static uint8_t opcodes[] = {
+        [BH1750_RES_LOW]   = OPCODE_OT | OPCODE_LOW,
+        [BH1750_RES_HIGH]  = OPCODE_OT | OPCODE_HIGH,
+        [BH1750_RES_HIGH2] = OPCODE_OT | OPCODE_HIGH2,
+    };
+
+    CHECK_ARG(dev && req && resolution <= BH1750_RES_HIGH2);
+
+    req->dev = dev;
+    req->write = true;
+    req->out_data = NULL;
+    req->out_size = 0;
+    req->data = &opcodes[resolution];
+    req->size = 1;
+
+    return i2c_dev_submit(req);
+}
+
+esp_err_t bh1750_compute_lux_centi(const uint8_t raw[BH1750_RAW_DATA_SIZE], const bh1750_range_t *range, uint32_t *level)
+{
+    CHECK_ARG(raw && range && level && range->mtreg);
+
+    // lux = counts / 1.2 * 69 / MTreg, halved in high resolution mode 2
+    uint32_t counts = raw[0] << 8 | raw[1];
+    uint32_t div = range->mtreg * (range->resolution == BH1750_RES_HIGH2 ? 2 : 1);
+    *level = (counts * (100 * BH1750_MTREG_DEFAULT * 10 / 12) + div / 2) / div;
+
+    return ESP_OK;
+}
+
+bool bh1750_autorange(const uint8_t raw[BH1750_RAW_DATA_SIZE], bh1750_range_t *range)
+{
+    uint32_t counts = raw[0] << 8 | raw[1];
+    if (range->resolution != BH1750_RES_LOW && counts >= AUTORANGE_KEEP_MIN && counts <= AUTORANGE_KEEP_MAX)
+        return false;
+
+    // counts per lux are proportional to MTreg (doubled in H2): scale the
+    // current sensitivity so the result lands on the target
+    uint32_t sens = range->mtreg * (range->resolution == BH1750_RES_HIGH2 ? 2 : 1);
+    uint32_t want = counts ? (uint32_t)((uint64_t)sens * AUTORANGE_TARGET / counts) : UINT32_MAX;
+
+    bh1750_range_t next;
+    if (want >= 2 * BH1750_MTREG_MIN)
+    {
+        next.resolution = BH1750_RES_HIGH2;
+        next.mtreg = want / 2 > BH1750_MTREG_MAX ? BH1750_MTREG_MAX : want / 2;
+    }
+    else
+    {
+        next.resolution = BH1750_RES_HIGH;
+        next.mtreg = want < BH1750_MTREG_MIN ? BH1750_MTREG_MIN : want;
+    }
+    if (next.resolution == range->resolution && next.mtreg == range->mtreg)
+        return false;
+
+    ESP_LOGD(TAG, "Range %d/%d -> %d/%d (%u counts)", range->resolution, range->mtreg,
+            next.resolution, next.mtreg, counts);
+    *range = next;
+    return true;
+}
@@ -19,6 +19,7 @@
 #define __BH1750_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <i2cdev.h>
 #include <esp_err.h>
 
@@ -29,6 +30,12 @@ extern "C" {
 #define BH1750_ADDR_LO 0x23 //!< I2C address when ADDR pin floating/low
 #define BH1750_ADDR_HI 0x5c //!< I2C address when ADDR pin high
 
+#define BH1750_RAW_DATA_SIZE 2 //!< Bytes of one measurement result
+
+#define BH1750_MTREG_MIN     31  //!< Shortest measurement time, widest range
+#define BH1750_MTREG_DEFAULT 69  //!< Measurement time at power on
+#define BH1750_MTREG_MAX     254 //!< Longest measurement time, finest resolution
+
 /**
  * Measurement mode
  */
@@ -48,6 +55,15 @@ typedef enum
     BH1750_RES_HIGH2     //!< 0.5 lx resolution, measurement time is usually 120 ms
 } bh1750_resolution_t;
 
+/**
+ * Measurement range: resolution mode and measurement time register
+ */
+typedef struct
+{
+    bh1750_resolution_t resolution; //!< Measurement resolution
+    uint8_t mtreg;                  //!< Measurement time, BH1750_MTREG_MIN..BH1750_MTREG_MAX
+} bh1750_range_t;
+
 /**
  * @brief Initialize device descriptior
  * @param[out] dev Pointer to device descriptor
@@ -105,6 +121,75 @@ esp_err_t bh1750_set_measurement_time(i2c_dev_t *dev, uint8_t time);
  */
 esp_err_t bh1750_read(i2c_dev_t *dev, uint16_t *level);
 
+/**
+ * @brief Convert a measurement result read from the device to lux
+ *
+ * For results read without bh1750_read(), e.g. with an asynchronous request.
+ * @param raw Measurement result, MSB first
+ * @param[out] level value in lux units
+ * @return `ESP_OK` on success
+ */
+esp_err_t bh1750_compute_lux(const uint8_t raw[BH1750_RAW_DATA_SIZE], uint16_t *level);
+
+/**
+ * @brief Set measurement time and mode in one go
+ *
+ * In one time mode only the measurement time is set and the device is
+ * powered down, each *bh1750_start_measurement_async* then measures once.
+ * @param dev Pointer to device descriptor
+ * @param mode Measurement mode
+ * @param range Measurement range
+ * @return `ESP_OK` on success
+ */
+esp_err_t bh1750_set_range(i2c_dev_t *dev, bh1750_mode_t mode, const bh1750_range_t *range);
+
+/**
+ * @brief Worst case duration of one measurement (datasheet maximum)
+ * @param range Measurement range
+ * @return Duration in us
+ */
+uint32_t bh1750_get_measurement_duration_us(const bh1750_range_t *range);
+
+/**
+ * @brief Start a one time measurement without blocking
+ *
+ * Fills `req` with the one time measurement command and submits it to the
+ * bus task. The result can be read *bh1750_get_measurement_duration_us*
+ * later, the device powers down by itself afterwards.
+ * @param dev Pointer to device descriptor
+ * @param req Request, must stay valid until it is done
+ * @param resolution Measurement resolution
+ * @return `ESP_OK` on success
+ */
+esp_err_t bh1750_start_measurement_async(i2c_dev_t *dev, i2c_dev_request_t *req, bh1750_resolution_t resolution);
+
+/**
+ * @brief Convert a measurement result to hundredths of a lux
+ *
+ * Unlike *bh1750_compute_lux* this accounts for the resolution mode and
+ * the measurement time the result was taken with. Integer only.
+ * @param raw Measurement result, MSB first
+ * @param range Range the result was measured in
+ * @param[out] level value in hundredths of a lux, up to ~12200000
+ * @return `ESP_OK` on success
+ */
+esp_err_t bh1750_compute_lux_centi(const uint8_t raw[BH1750_RAW_DATA_SIZE], const bh1750_range_t *range, uint32_t *level);
+
+/**
+ * @brief Pick the range for the next measurement from the last result
+ *
+ * Keeps the result in the upper part of the ADC range, with headroom for
+ * the light to double before the next sample: long measurement time and
+ * 0.5 lx resolution in the dark, short measurement time and 1 lx
+ * resolution in bright daylight. A result comfortably within range keeps
+ * the current one, so a steady light does not rewrite the measurement
+ * time every sample.
+ * @param raw Last measurement result, MSB first
+ * @param[in,out] range Range the result was measured in, updated for the next one
+ * @return true if the range changed
+ */
+bool bh1750_autorange(const uint8_t raw[BH1750_RAW_DATA_SIZE], bh1750_range_t *range);
+
 #ifdef __cplusplus
 }
 #endif
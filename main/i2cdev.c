@@ -12,20 +12,42 @@
 #include <freertos/task.h>
 #include <esp_log.h>
 #include <esp_idf_lib_helpers.h>
+#if __has_include(<esp_idf_version.h>)
+#include <esp_idf_version.h>
+#endif
 #include "i2cdev.h"
 
 static const char *TAG = "I2C_DEV";
 
+// Static command links appeared in ESP-IDF v4.4
+#if HELPER_TARGET_IS_ESP32 && defined(ESP_IDF_VERSION_VAL)
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
+#define I2CDEV_STATIC_LINKS 1
+#endif
+#endif
+
+// Longest transaction: start, address, register, start, address, read (2 commands), stop
+#define I2CDEV_CMD_LINK_SIZE I2C_LINK_RECOMMENDED_SIZE(2)
+
 typedef struct {
     SemaphoreHandle_t lock;
     i2c_config_t config;
     bool installed;
+    i2cdev_stats_t stats;
+    SemaphoreHandle_t wake;      // bus task: given on submit
+    TaskHandle_t task;
+    i2c_dev_request_t *pending;  // bus task queue, guarded by queue_lock
+#ifdef I2CDEV_STATIC_LINKS
+    uint8_t cmd_buf[I2CDEV_CMD_LINK_SIZE] __attribute__((aligned(4))); // guarded by lock
+#endif
 } i2c_port_state_t;
 
 static i2c_port_state_t states[I2C_NUM_MAX];
+static portMUX_TYPE queue_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // I2CDEV TIMEOUT range between 100 and 5000
 #define CONFIG_I2CDEV_TIMEOUT 1000
+#define CONFIG_I2CDEV_BUS_TASK_STACK 3072
 
 #define SEMAPHORE_TAKE(port) do { \
         if (!xSemaphoreTake(states[port].lock, CONFIG_I2CDEV_TIMEOUT / portTICK_RATE_MS)) \
@@ -57,6 +79,10 @@ esp_err_t i2cdev_init()
         }
     }
 
+#if HELPER_TARGET_IS_ESP32 && !defined(I2CDEV_STATIC_LINKS)
+    ESP_LOGW(TAG, "No static I2C command links before ESP-IDF v4.4, allocating one per transaction");
+#endif
+
     return ESP_OK;
 }
 
@@ -66,6 +92,14 @@ esp_err_t i2cdev_done()
     {
         if (!states[i].lock) continue;
 
+        if (states[i].task)
+        {
+            vTaskDelete(states[i].task);
+            vSemaphoreDelete(states[i].wake);
+            states[i].task = NULL;
+            states[i].wake = NULL;
+        }
+
         if (states[i].installed)
         {
             SEMAPHORE_TAKE(i);
@@ -79,6 +113,17 @@ esp_err_t i2cdev_done()
     return ESP_OK;
 }
 
+esp_err_t i2cdev_get_stats(i2c_port_t port, i2cdev_stats_t *stats)
+{
+    if (port >= I2C_NUM_MAX || !stats) return ESP_ERR_INVALID_ARG;
+
+    SEMAPHORE_TAKE(port);
+    *stats = states[port].stats;
+    SEMAPHORE_GIVE(port);
+
+    return ESP_OK;
+}
+
 esp_err_t i2c_dev_create_mutex(i2c_dev_t *dev)
 {
     if (!dev) return ESP_ERR_INVALID_ARG;
@@ -133,16 +178,44 @@ esp_err_t i2c_dev_give_mutex(i2c_dev_t *dev)
     return ESP_OK;
 }
 
-inline static bool cfg_equal(const i2c_config_t *a, const i2c_config_t *b)
+// Settings that need the driver reinstalled; the clock alone does not
+inline static bool cfg_pins_equal(const i2c_config_t *a, const i2c_config_t *b)
 {
     return a->scl_io_num == b->scl_io_num
         && a->sda_io_num == b->sda_io_num
+        && a->scl_pullup_en == b->scl_pullup_en
+        && a->sda_pullup_en == b->sda_pullup_en;
+}
+
+inline static bool cfg_equal(const i2c_config_t *a, const i2c_config_t *b)
+{
+    return cfg_pins_equal(a, b)
 #if HELPER_TARGET_IS_ESP32
         && a->master.clk_speed == b->master.clk_speed
 #endif
-        && a->scl_pullup_en == b->scl_pullup_en
-        && a->sda_pullup_en == b->sda_pullup_en;
+        ;
+}
+
+#if HELPER_TARGET_IS_ESP32
+// Same SCL/START/STOP/SDA split i2c_param_config() derives from clk_speed, written
+// straight into the timing registers of the installed driver. Caller holds the port lock.
+static esp_err_t i2c_retune_clock(i2c_port_t port, uint32_t clk_speed)
+{
+    if (!clk_speed) return ESP_ERR_INVALID_ARG;
+
+    int half = I2C_APB_CLK_FREQ / clk_speed / 2;
+    esp_err_t res;
+    if ((res = i2c_set_period(port, half, half)) != ESP_OK)
+        return res;
+    if ((res = i2c_set_start_timing(port, half, half)) != ESP_OK)
+        return res;
+    if ((res = i2c_set_stop_timing(port, half, half)) != ESP_OK)
+        return res;
+    if ((res = i2c_set_data_timing(port, half / 2, half / 2)) != ESP_OK)
+        return res;
+    return i2c_set_timeout(port, half * 20);
 }
+#endif
 
 static esp_err_t i2c_setup_port(i2c_port_t port, const i2c_config_t *cfg)
 {
@@ -151,11 +224,24 @@ static esp_err_t i2c_setup_port(i2c_port_t port, const i2c_config_t *cfg)
     esp_err_t res;
     if (!cfg_equal(cfg, &states[port].config))
     {
-        ESP_LOGD(TAG, "Reconfiguring I2C driver on port %d", port);
         i2c_config_t temp;
         memcpy(&temp, cfg, sizeof(i2c_config_t));
         temp.mode = I2C_MODE_MASTER;
 
+#if HELPER_TARGET_IS_ESP32
+        // Devices at different speeds on one bus: only the bus timing changes, keep the driver
+        if (states[port].installed && cfg_pins_equal(cfg, &states[port].config))
+        {
+            ESP_LOGV(TAG, "Retuning I2C clock on port %d to %u Hz", port, temp.master.clk_speed);
+            if ((res = i2c_retune_clock(port, temp.master.clk_speed)) != ESP_OK)
+                return res;
+            states[port].stats.retunes++;
+            memcpy(&states[port].config, &temp, sizeof(i2c_config_t));
+            return ESP_OK;
+        }
+#endif
+        ESP_LOGD(TAG, "Reconfiguring I2C driver on port %d", port);
+
         // Driver reinstallation
         if (states[port].installed)
             i2c_driver_delete(port);
@@ -171,6 +257,7 @@ static esp_err_t i2c_setup_port(i2c_port_t port, const i2c_config_t *cfg)
             return res;
 #endif
         states[port].installed = true;
+        states[port].stats.reinstalls++;
 
         memcpy(&states[port].config, &temp, sizeof(i2c_config_t));
         ESP_LOGD(TAG, "I2C driver successfully reconfigured on port %d", port);
@@ -179,16 +266,32 @@ static esp_err_t i2c_setup_port(i2c_port_t port, const i2c_config_t *cfg)
     return ESP_OK;
 }
 
-esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+// Called with the port lock held: the static link lives in the port state
+static i2c_cmd_handle_t cmd_link_create(i2c_port_t port)
 {
-    if (!dev || !in_data || !in_size) return ESP_ERR_INVALID_ARG;
+#ifdef I2CDEV_STATIC_LINKS
+    return i2c_cmd_link_create_static(states[port].cmd_buf, sizeof(states[port].cmd_buf));
+#else
+    return i2c_cmd_link_create();
+#endif
+}
 
-    SEMAPHORE_TAKE(dev->port);
+static void cmd_link_delete(i2c_cmd_handle_t cmd)
+{
+#ifdef I2CDEV_STATIC_LINKS
+    i2c_cmd_link_delete_static(cmd);
+#else
+    i2c_cmd_link_delete(cmd);
+#endif
+}
 
+// Transactions below run with the port lock held
+static esp_err_t read_locked(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+{
     esp_err_t res = i2c_setup_port(dev->port, &dev->cfg);
     if (res == ESP_OK)
     {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        i2c_cmd_handle_t cmd = cmd_link_create(dev->port);
         if (out_data && out_size)
         {
             i2c_master_start(cmd);
@@ -201,26 +304,24 @@ esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_si
         i2c_master_stop(cmd);
 
         res = i2c_master_cmd_begin(dev->port, cmd, CONFIG_I2CDEV_TIMEOUT / portTICK_RATE_MS);
+        states[dev->port].stats.transactions++;
         if (res != ESP_OK)
+        {
+            states[dev->port].stats.errors++;
             ESP_LOGE(TAG, "Could not read from device [0x%02x at %d]: %d", dev->addr, dev->port, res);
+        }
 
-        i2c_cmd_link_delete(cmd);
+        cmd_link_delete(cmd);
     }
-
-    SEMAPHORE_GIVE(dev->port);
     return res;
 }
 
-esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+static esp_err_t write_locked(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
 {
-    if (!dev || !out_data || !out_size) return ESP_ERR_INVALID_ARG;
-
-    SEMAPHORE_TAKE(dev->port);
-
     esp_err_t res = i2c_setup_port(dev->port, &dev->cfg);
     if (res == ESP_OK)
     {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        i2c_cmd_handle_t cmd = cmd_link_create(dev->port);
         i2c_master_start(cmd);
         i2c_master_write_byte(cmd, dev->addr << 1, true);
         if (out_reg && out_reg_size)
@@ -228,15 +329,134 @@ esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_re
         i2c_master_write(cmd, (void *)out_data, out_size, true);
         i2c_master_stop(cmd);
         res = i2c_master_cmd_begin(dev->port, cmd, CONFIG_I2CDEV_TIMEOUT / portTICK_RATE_MS);
+        states[dev->port].stats.transactions++;
         if (res != ESP_OK)
+        {
+            states[dev->port].stats.errors++;
             ESP_LOGE(TAG, "Could not write to device [0x%02x at %d]: %d", dev->addr, dev->port, res);
-        i2c_cmd_link_delete(cmd);
+        }
+        cmd_link_delete(cmd);
     }
+    return res;
+}
 
+esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+{
+    if (!dev || !in_data || !in_size) return ESP_ERR_INVALID_ARG;
+
+    SEMAPHORE_TAKE(dev->port);
+    esp_err_t res = read_locked(dev, out_data, out_size, in_data, in_size);
     SEMAPHORE_GIVE(dev->port);
     return res;
 }
 
+esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+{
+    if (!dev || !out_data || !out_size) return ESP_ERR_INVALID_ARG;
+
+    SEMAPHORE_TAKE(dev->port);
+    esp_err_t res = write_locked(dev, out_reg, out_reg_size, out_data, out_size);
+    SEMAPHORE_GIVE(dev->port);
+    return res;
+}
+
+esp_err_t i2c_dev_submit(i2c_dev_request_t *req)
+{
+    if (!req || !req->dev || req->dev->port >= I2C_NUM_MAX || !req->data || !req->size) return ESP_ERR_INVALID_ARG;
+
+    i2c_port_state_t *state = &states[req->dev->port];
+    if (!state->wake) return ESP_ERR_INVALID_STATE;
+
+    req->done = false;
+    req->result = ESP_ERR_INVALID_STATE;
+    portENTER_CRITICAL(&queue_lock);
+    // Behind every request of the same or a higher priority
+    i2c_dev_request_t **link = &state->pending;
+    while (*link && (*link)->dev->priority >= req->dev->priority)
+        link = &(*link)->next;
+    req->next = *link;
+    *link = req;
+    portEXIT_CRITICAL(&queue_lock);
+
+    xSemaphoreGive(state->wake);
+    return ESP_OK;
+}
+
+bool i2cdev_bus_step(i2c_port_t port)
+{
+    if (port >= I2C_NUM_MAX) return false;
+
+    portENTER_CRITICAL(&queue_lock);
+    i2c_dev_request_t *batch = states[port].pending;
+    states[port].pending = NULL;
+    portEXIT_CRITICAL(&queue_lock);
+    if (!batch) return false;
+
+    // One port lock for the whole batch, callbacks run after it is released
+    bool locked = xSemaphoreTake(states[port].lock, CONFIG_I2CDEV_TIMEOUT / portTICK_RATE_MS);
+    if (!locked)
+        ESP_LOGE(TAG, "Could not take port mutex %d", port);
+    for (i2c_dev_request_t *req = batch; req; req = req->next)
+    {
+        if (!locked)
+            req->result = ESP_ERR_TIMEOUT;
+        else if (req->write)
+            req->result = write_locked(req->dev, req->out_data, req->out_size, req->data, req->size);
+        else
+            req->result = read_locked(req->dev, req->out_data, req->out_size, req->data, req->size);
+        states[port].stats.requests++;
+    }
+    if (locked)
+    {
+        states[port].stats.batches++;
+        xSemaphoreGive(states[port].lock);
+    }
+
+    while (batch)
+    {
+        // The callback may submit the request again
+        i2c_dev_request_t *req = batch;
+        batch = req->next;
+        req->done = true;
+        if (req->callback)
+            req->callback(req);
+    }
+    return true;
+}
+
+static void i2cdev_bus_task(void *arg)
+{
+    i2c_port_t port = (i2c_port_t)(intptr_t)arg;
+
+    while (1)
+    {
+        xSemaphoreTake(states[port].wake, portMAX_DELAY);
+        while (i2cdev_bus_step(port)) {}
+    }
+}
+
+esp_err_t i2cdev_start_bus_task(i2c_port_t port, UBaseType_t priority)
+{
+    if (port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    if (states[port].wake) return ESP_OK;
+
+    states[port].wake = xSemaphoreCreateBinary();
+    if (!states[port].wake)
+    {
+        ESP_LOGE(TAG, "Could not create bus task semaphore %d", port);
+        return ESP_FAIL;
+    }
+    if (xTaskCreate(i2cdev_bus_task, "i2c_bus", CONFIG_I2CDEV_BUS_TASK_STACK, (void *)(intptr_t)port, priority,
+            &states[port].task) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Could not create bus task %d", port);
+        vSemaphoreDelete(states[port].wake);
+        states[port].wake = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg,
         void *in_data, size_t in_size)
 {
@@ -15,6 +15,7 @@
 #include <driver/i2c.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <freertos/task.h>
 #include <esp_err.h>
 
 #ifdef __cplusplus
@@ -30,13 +31,56 @@ typedef struct
     i2c_config_t cfg;        //!< I2C driver configuration
     uint8_t addr;            //!< Unshifted address
     SemaphoreHandle_t mutex; //!< Device mutex
+    uint8_t priority;        //!< Bus task queue priority, higher first
 } i2c_dev_t;
 
+struct i2c_dev_request;
+
+/**
+ * Completion callback of an asynchronous request, called from the bus task
+ */
+typedef void (*i2c_dev_callback_t)(struct i2c_dev_request *req);
+
+/**
+ * Asynchronous transaction, owned by the caller until it is done
+ */
+typedef struct i2c_dev_request
+{
+    const i2c_dev_t *dev;        //!< Device descriptor
+    bool write;                  //!< true: write `out_data` then `data`, false: write `out_data` then read into `data`
+    const void *out_data;        //!< Register or command bytes sent first, NULL for none
+    size_t out_size;             //!< Size of `out_data`
+    void *data;                  //!< Bytes to write or buffer to read into
+    size_t size;                 //!< Size of `data`
+    i2c_dev_callback_t callback; //!< Called once `result` is valid, may be NULL
+    void *arg;                   //!< User argument for the callback
+    esp_err_t result;            //!< Transaction result
+    volatile bool done;          //!< Set when `result` is valid, to poll the request as a future
+    struct i2c_dev_request *next; //!< Internal, queue link
+} i2c_dev_request_t;
+
+/**
+ * Per-port transaction counters
+ */
+typedef struct
+{
+    uint32_t transactions; //!< Transactions sent with i2c_master_cmd_begin()
+    uint32_t errors;       //!< Transactions that failed
+    uint32_t reinstalls;   //!< Driver (re)installations: pins or pull-ups changed
+    uint32_t retunes;      //!< Clock changes applied to the installed driver with the i2c_set_*_timing() calls
+    uint32_t requests;     //!< Asynchronous requests completed
+    uint32_t batches;      //!< Times the bus task drained its queue
+} i2cdev_stats_t;
+
 /**
  * @brief Init I2Cdev lib
  *
  * The function must be called before any other
  * functions of this library
+ *
+ * On ESP32 with ESP-IDF v4.4 or newer each port builds its commands in a
+ * static link buffer. Older ESP-IDF has no static command links: every
+ * transaction then allocates and frees a heap link, and init logs a warning.
  * @return ESP_OK on success
  */
 esp_err_t i2cdev_init();
@@ -49,6 +93,48 @@ esp_err_t i2cdev_init();
  */
 esp_err_t i2cdev_done();
 
+/**
+ * @brief Get transaction counters of a port
+ *
+ * Counters run from i2cdev_init().
+ * @param[in] port I2C port number
+ * @param[out] stats Counters
+ * @return ESP_OK on success
+ */
+esp_err_t i2cdev_get_stats(i2c_port_t port, i2cdev_stats_t *stats);
+
+/**
+ * @brief Start the bus task of a port
+ *
+ * The task runs asynchronous requests, so that a slow or hung device
+ * blocks it rather than the submitter.
+ * @param port I2C port number
+ * @param priority FreeRTOS priority of the task
+ * @return ESP_OK on success
+ */
+esp_err_t i2cdev_start_bus_task(i2c_port_t port, UBaseType_t priority);
+
+/**
+ * @brief Queue a transaction for the bus task
+ *
+ * Requests run by device priority, in submission order within a priority.
+ * Everything queued when the task wakes up runs as one batch, holding
+ * the port once. The request and its buffers must stay valid until
+ * `done` is set or the callback runs.
+ * @param req Request
+ * @return ESP_OK when queued, ESP_ERR_INVALID_STATE when the bus task is not started
+ */
+esp_err_t i2c_dev_submit(i2c_dev_request_t *req);
+
+/**
+ * @brief Run one batch of queued requests in the calling context
+ *
+ * This is the body of the bus task, for hosts without a scheduler.
+ * @param port I2C port number
+ * @return true when requests were run
+ */
+bool i2cdev_bus_step(i2c_port_t port);
+
 /**
  * @brief Create mutex for device descriptor
  * @param[out] dev Device descriptor
@@ -0,0 +1,113 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <math.h>
+#include "led_color.h"
+
+enum {
+    LED_COLOR_MAX = 0,
+    LED_COLOR_MIN,
+    LED_COLOR_RISE,
+    LED_COLOR_FALL,
+};
+
+// Which level each of R, G, B takes in every 60 degree hue sector
+static const uint8_t s_hue_sector[6][3] = {
+    { LED_COLOR_MAX,  LED_COLOR_RISE, LED_COLOR_MIN  },
+    { LED_COLOR_FALL, LED_COLOR_MAX,  LED_COLOR_MIN  },
+    { LED_COLOR_MIN,  LED_COLOR_MAX,  LED_COLOR_RISE },
+    { LED_COLOR_MIN,  LED_COLOR_FALL, LED_COLOR_MAX  },
+    { LED_COLOR_RISE, LED_COLOR_MIN,  LED_COLOR_MAX  },
+    { LED_COLOR_MAX,  LED_COLOR_MIN,  LED_COLOR_FALL },
+};
+
+// x / 100 for x <= 25500
+static inline uint32_t div100(uint32_t x)
+{
+    return (x * 5243U) >> 19;
+}
+
+// x / 60 for x <= 255 * 59
+static inline uint32_t div60(uint32_t x)
+{
+    return (x * 17477U) >> 20;
+}
+
+void led_color_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    h %= 360; // h -> [0,360)
+    s = s > 100 ? 100 : s;
+    v = v > 100 ? 100 : v;
+
+    // v * 255 / 100 matches (uint32_t)(v * 2.55f) for every v in [0, 100]
+    uint32_t rgb_max = div100(v * 255);
+    uint32_t rgb_min = div100(rgb_max * (100 - s));
+
+    uint32_t i = div60(h);
+    uint32_t diff = h - i * 60;
+
+    // RGB adjustment amount by hue
+    uint32_t rgb_adj = div60((rgb_max - rgb_min) * diff);
+
+    const uint8_t level[4] = {
+        [LED_COLOR_MAX] = rgb_max,
+        [LED_COLOR_MIN] = rgb_min,
+        [LED_COLOR_RISE] = rgb_min + rgb_adj,
+        [LED_COLOR_FALL] = rgb_max - rgb_adj,
+    };
+    *r = level[s_hue_sector[i][0]];
+    *g = level[s_hue_sector[i][1]];
+    *b = level[s_hue_sector[i][2]];
+}
+
+void led_color_fill_grb(uint8_t *grb, uint32_t num_pixels, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (!num_pixels) {
+        return;
+    }
+    size_t total = num_pixels * 3;
+    size_t filled = 3;
+    grb[0] = g;
+    grb[1] = r;
+    grb[2] = b;
+    // Double the initialised prefix until the buffer is full
+    while (filled < total) {
+        size_t n = (total - filled) < filled ? (total - filled) : filled;
+        memcpy(grb + filled, grb, n);
+        filled += n;
+    }
+}
+
+void led_color_hsv2grb_fill(uint8_t *grb, uint32_t num_pixels, uint32_t h, uint32_t s, uint32_t v)
+{
+    uint8_t r, g, b;
+    led_color_hsv2rgb(h, s, v, &r, &g, &b);
+    led_color_fill_grb(grb, num_pixels, r, g, b);
+}
+
+void led_color_scale_lut(uint8_t lut[256], uint32_t percent, bool gamma)
+{
+    percent = percent > 100 ? 100 : percent;
+    for (uint32_t x = 0; x < 256; x++) {
+        uint32_t scaled = div100(x * percent);
+        // Only rebuilt when the brightness changes, so float is fine here
+        lut[x] = gamma ? (uint8_t)(powf(scaled / 255.0f, 2.2f) * 255.0f + 0.5f) : scaled;
+    }
+}
+
+uint32_t led_color_lerp(uint32_t c0, uint32_t c1, uint32_t t)
+{
+    uint32_t c = 0;
+    for (int shift = 0; shift <= 16; shift += 8) {
+        uint32_t a = (c0 >> shift) & 0xFF;
+        uint32_t b = (c1 >> shift) & 0xFF;
+        c |= ((a * (65536 - t) + b * t) >> 16) << shift;
+    }
+    return c;
+}
@@ -0,0 +1,80 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Convert HSV to RGB using integer arithmetic only
+ *
+ * Bit-exact with the original float converter for hue in any range,
+ * saturation and value in [0, 100]. Larger saturation and value are
+ * clamped to 100.
+ *
+ * @param h: hue in degrees
+ * @param s: saturation in percent
+ * @param v: value (brightness) in percent
+ * @param[out] r: red part of color
+ * @param[out] g: green part of color
+ * @param[out] b: blue part of color
+ */
+void led_color_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint8_t *r, uint8_t *g, uint8_t *b);
+
+/**
+ * @brief Fill a GRB framebuffer with one color
+ *
+ * @param grb: framebuffer, 3 bytes per pixel in the order of GRB
+ * @param num_pixels: number of pixels to fill
+ * @param r: red part of color
+ * @param g: green part of color
+ * @param b: blue part of color
+ */
+void led_color_fill_grb(uint8_t *grb, uint32_t num_pixels, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Convert HSV once and fill a whole GRB framebuffer with the result
+ *
+ * @param grb: framebuffer, 3 bytes per pixel in the order of GRB
+ * @param num_pixels: number of pixels to fill
+ * @param h: hue in degrees
+ * @param s: saturation in percent
+ * @param v: value (brightness) in percent
+ */
+void led_color_hsv2grb_fill(uint8_t *grb, uint32_t num_pixels, uint32_t h, uint32_t s, uint32_t v);
+
+/**
+ * @brief Build a table scaling a channel value by a brightness percentage
+ *
+ * Without gamma, lut[x] is x * percent / 100, which matches the float
+ * expression (uint8_t)(x * percent * 0.01f) for every input. With gamma, the
+ * scaled value is also mapped through a 2.2 power curve so that steps look
+ * even to the eye.
+ *
+ * @param[out] lut: table of 256 entries, indexed by channel value
+ * @param percent: brightness in percent, clamped to 100
+ * @param gamma: fold perceptual gamma into the table
+ */
+void led_color_scale_lut(uint8_t lut[256], uint32_t percent, bool gamma);
+
+/**
+ * @brief Blend two 0xRRGGBB colors
+ *
+ * @param c0: color at t = 0
+ * @param c1: color at t = 65536
+ * @param t: position between the two in Q16, [0, 65536]
+ * @return Blended 0xRRGGBB color, each channel truncated
+ */
+uint32_t led_color_lerp(uint32_t c0, uint32_t c1, uint32_t t);
+
+#ifdef __cplusplus
+}
+#endif
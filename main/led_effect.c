@@ -0,0 +1,254 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <esp_cpu.h>
+#include "led_color.h"
+#include "led_effect.h"
+
+#define LED_EFFECT_DEFAULT_PERIOD_MS 1000
+#define LED_EFFECT_MAX_PERIOD_MS     3600000
+#define LED_EFFECT_CACHE_MAX_SIZE    0x8000
+#define LED_EFFECT_CACHE_SOLID       0x8000  // index flag: frame stored as one GRB pixel
+
+/*
+ * Effects are periodic: a frame is a function of the position within the period.
+ * Unless player->redraw is set, the strip still holds the previous frame of the
+ * effect, so an effect may draw only the pixels that changed.
+ */
+typedef struct {
+    const char *name;
+    void (*init)(led_effect_player_t *player);                   /*!< optional, prepares player->state */
+    void (*render)(led_effect_player_t *player, uint32_t phase); /*!< phase in Q16, [0, 65536) */
+} led_effect_desc_t;
+
+static inline void led_effect_set(led_effect_player_t *player, uint32_t index, uint32_t c)
+{
+    const uint8_t *scale = player->scale;
+    uint8_t r = c >> 16, g = c >> 8, b = c;
+    if (scale) {
+        r = scale[r];
+        g = scale[g];
+        b = scale[b];
+    }
+    player->strip->set_pixel(player->strip, index, r, g, b);
+}
+
+static inline void led_effect_fill(led_effect_player_t *player, uint32_t c)
+{
+    const uint8_t *scale = player->scale;
+    uint8_t r = c >> 16, g = c >> 8, b = c;
+    if (scale) {
+        r = scale[r];
+        g = scale[g];
+        b = scale[b];
+    }
+    player->strip->fill(player->strip, r, g, b);
+}
+
+// Up and back down once per period, Q16
+static inline uint32_t led_effect_triangle(uint32_t phase)
+{
+    return phase < 32768 ? phase * 2 : (65536 - phase) * 2;
+}
+
+// state[0]: position drawn by the previous frame
+static void spinner_render(led_effect_player_t *player, uint32_t phase)
+{
+    uint32_t n = player->num_pixels;
+    uint32_t pos = (uint32_t)(((uint64_t)phase * n) >> 16);
+    uint32_t last = player->state[0];
+    if (player->redraw) {
+        led_effect_fill(player, player->params.color_a);
+    } else if (pos == last) {
+        return;
+    } else {
+        // Only the two pixels left behind and the two entered change
+        led_effect_set(player, last, player->params.color_a);
+        led_effect_set(player, (last + 1) % n, player->params.color_a);
+    }
+    led_effect_set(player, pos, player->params.color_b);
+    led_effect_set(player, (pos + 1) % n, player->params.color_b);
+    player->state[0] = pos;
+}
+
+static void pulse_render(led_effect_player_t *player, uint32_t phase)
+{
+    uint32_t t = led_effect_triangle(phase);
+    led_effect_fill(player, led_color_lerp(player->params.color_a, player->params.color_b, t));
+}
+
+static void breathe_render(led_effect_player_t *player, uint32_t phase)
+{
+    uint32_t t = led_effect_triangle(phase);
+    // Squared ramp: slow out of the dim end, quick through the bright one
+    t = (t * t) >> 16;
+    led_effect_fill(player, led_color_lerp(player->params.color_a, player->params.color_b, t));
+}
+
+// state[0]: hue step between neighbouring pixels in Q16 degrees
+static void rainbow_init(led_effect_player_t *player)
+{
+    player->state[0] = (360U << 16) / player->num_pixels;
+}
+
+static void rainbow_render(led_effect_player_t *player, uint32_t phase)
+{
+    uint32_t hue = phase * 360U;
+    for (uint32_t i = 0; i < player->num_pixels; i++) {
+        uint8_t r, g, b;
+        led_color_hsv2rgb(hue >> 16, 100, 100, &r, &g, &b);
+        led_effect_set(player, i, ((uint32_t)r << 16) | ((uint32_t)g << 8) | b);
+        hue += player->state[0];
+    }
+}
+
+static void chase_render(led_effect_player_t *player, uint32_t phase)
+{
+    uint32_t step = (phase * 3) >> 16;
+    led_effect_fill(player, player->params.color_a);
+    for (uint32_t i = step; i < player->num_pixels; i += 3) {
+        led_effect_set(player, i, player->params.color_b);
+    }
+}
+
+// Position of `offset_us` within the period in Q16, [0, 65536)
+static inline uint32_t led_effect_phase(const led_effect_player_t *player, uint32_t offset_us)
+{
+    return (uint32_t)(((uint64_t)offset_us * player->phase_scale) >> 24);
+}
+
+/*
+ * Cache layout: a uint16_t index per frame (byte offset of the frame data,
+ * LED_EFFECT_CACHE_SOLID set for a single pixel filling the strip), then the
+ * frame data in GRB order.
+ */
+static bool led_effect_cache_build(led_effect_player_t *player, const led_effect_desc_t *effect)
+{
+    uint32_t frames = player->period_us / player->frame_us;
+    frames = frames ? frames : 1;
+    uint32_t frame_bytes = player->num_pixels * 3;
+    uint32_t size = player->cache_size < LED_EFFECT_CACHE_MAX_SIZE ? player->cache_size : LED_EFFECT_CACHE_MAX_SIZE;
+    uint32_t used = frames * sizeof(uint16_t);
+    player->redraw = true;
+    for (uint32_t k = 0; k < frames; k++) {
+        // Room for a full frame is needed to read it back, even if it turns out solid
+        if (used + frame_bytes > size) {
+            return false;
+        }
+        effect->render(player, led_effect_phase(player, k * player->frame_us));
+        player->redraw = false;
+        uint8_t *data = player->cache + used;
+        player->strip->read(player->strip, 0, data, player->num_pixels);
+        uint16_t index = used;
+        if (memcmp(data, data + 3, frame_bytes - 3) == 0) {
+            index |= LED_EFFECT_CACHE_SOLID;
+            used += 3;
+        } else {
+            used += frame_bytes;
+        }
+        memcpy(player->cache + k * sizeof(uint16_t), &index, sizeof(index));
+    }
+    player->cache_frames = frames;
+    player->cache_used = used;
+    return true;
+}
+
+static void led_effect_cache_replay(led_effect_player_t *player, uint32_t offset_us)
+{
+    uint32_t k = offset_us / player->frame_us;
+    k = k < player->cache_frames ? k : player->cache_frames - 1;
+    uint16_t index;
+    memcpy(&index, player->cache + k * sizeof(uint16_t), sizeof(index));
+    const uint8_t *data = player->cache + (index & ~LED_EFFECT_CACHE_SOLID);
+    if (index & LED_EFFECT_CACHE_SOLID) {
+        player->strip->fill(player->strip, data[1], data[0], data[2]);
+    } else {
+        player->strip->write(player->strip, 0, data, player->num_pixels);
+    }
+}
+
+static const led_effect_desc_t s_effects[LED_EFFECT_MAX] = {
+    [LED_EFFECT_SPINNER] = { "spinner", NULL,         spinner_render },
+    [LED_EFFECT_PULSE]   = { "pulse",   NULL,         pulse_render   },
+    [LED_EFFECT_BREATHE] = { "breathe", NULL,         breathe_render },
+    [LED_EFFECT_RAINBOW] = { "rainbow", rainbow_init, rainbow_render },
+    [LED_EFFECT_CHASE]   = { "chase",   NULL,         chase_render   },
+};
+
+esp_err_t led_effect_start(led_effect_player_t *player, led_effect_id_t id, const led_effect_params_t *params,
+                           int64_t now_us)
+{
+    if (!player || !player->strip || !player->num_pixels || !params || id >= LED_EFFECT_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    player->id = id;
+    player->params = *params;
+    if (!player->params.period_ms) {
+        player->params.period_ms = LED_EFFECT_DEFAULT_PERIOD_MS;
+    }
+    if (player->params.period_ms > LED_EFFECT_MAX_PERIOD_MS) {
+        player->params.period_ms = LED_EFFECT_MAX_PERIOD_MS;
+    }
+    player->period_us = player->params.period_ms * 1000U;
+    player->phase_scale = (uint32_t)((1ULL << 40) / player->period_us);
+    player->cycle_start_us = now_us;
+    memset(player->state, 0, sizeof(player->state));
+    led_effect_invalidate(player);
+    if (s_effects[id].init) {
+        s_effects[id].init(player);
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_effect_render(led_effect_player_t *player, int64_t now_us)
+{
+    if (!player || !player->strip || player->id >= LED_EFFECT_MAX) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t offset = now_us - player->cycle_start_us;
+    if (offset < 0) {
+        offset = 0;
+    } else if (offset >= player->period_us) {
+        // Once per period: drop the whole periods, the rest of the math is 32 bit
+        player->cycle_start_us += offset - offset % player->period_us;
+        offset %= player->period_us;
+    }
+    const led_effect_desc_t *effect = &s_effects[player->id];
+    led_effect_stats_t *stats = &player->stats[player->id];
+    uint32_t start = esp_cpu_get_ccount();
+    if (player->cache && player->frame_us && !player->cache_frames && !player->cache_over_budget) {
+        player->cache_over_budget = !led_effect_cache_build(player, effect);
+    }
+    if (player->cache_frames) {
+        led_effect_cache_replay(player, (uint32_t)offset);
+        stats->replayed++;
+    } else {
+        effect->render(player, led_effect_phase(player, (uint32_t)offset));
+        player->redraw = false;
+    }
+    uint32_t cycles = esp_cpu_get_ccount() - start;
+    stats->frames++;
+    stats->cycles += cycles;
+    if (cycles > stats->max_cycles) {
+        stats->max_cycles = cycles;
+    }
+    return ESP_OK;
+}
+
+void led_effect_invalidate(led_effect_player_t *player)
+{
+    player->cache_frames = 0;
+    player->cache_over_budget = false;
+    player->redraw = true;
+}
+
+const char *led_effect_name(led_effect_id_t id)
+{
+    return id < LED_EFFECT_MAX ? s_effects[id].name : "unknown";
+}
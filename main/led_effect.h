@@ -0,0 +1,132 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "led_strip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Effects known to the registry
+ *
+ * Adding an effect takes an id here and an entry in the registry of
+ * led_effect.c; players and timer callbacks do not change.
+ */
+typedef enum {
+    LED_EFFECT_SPINNER = 0, /*!< two color_b pixels circling over color_a, one turn per period, drawn sparsely */
+    LED_EFFECT_PULSE,       /*!< linear color_a -> color_b -> color_a over a period */
+    LED_EFFECT_BREATHE,     /*!< like pulse, eased so the dim end lingers */
+    LED_EFFECT_RAINBOW,     /*!< hue wheel spread over the strip, one rotation per period */
+    LED_EFFECT_CHASE,       /*!< every third pixel color_b over color_a, stepping three times per period */
+    LED_EFFECT_MAX,
+} led_effect_id_t;
+
+/**
+ * @brief Parameters of a running effect
+ */
+typedef struct {
+    uint32_t color_a;   /*!< 0xRRGGBB, background or start color */
+    uint32_t color_b;   /*!< 0xRRGGBB, foreground or end color */
+    uint32_t period_ms; /*!< length of one cycle, 0 for 1000 ms, at most an hour */
+} led_effect_params_t;
+
+/**
+ * @brief Render cost of one effect
+ */
+typedef struct {
+    uint32_t frames;        /*!< frames drawn */
+    uint32_t replayed;      /*!< of which copied from the frame cache */
+    uint64_t cycles;        /*!< CPU cycles spent drawing them */
+    uint32_t max_cycles;    /*!< worst single frame, a cache build included */
+} led_effect_stats_t;
+
+#define LED_EFFECT_STATE_WORDS 4
+
+/**
+ * @brief Plays effects on a strip; frames are a function of the time since start
+ *
+ * With a cache buffer and frame_us set, the first frame of an effect renders
+ * its whole period at frame_us steps into the cache, and later frames are
+ * copied from there. Frames where every pixel has the same color take 3
+ * bytes, other frames num_pixels * 3, plus 2 bytes of index per frame. An
+ * effect that does not fit is rendered live.
+ */
+typedef struct {
+    led_strip_t *strip;             /*!< strip to draw into, refreshing is left to the caller */
+    uint32_t num_pixels;            /*!< pixels of the strip */
+    const uint8_t *scale;           /*!< 256-entry brightness table applied to every channel, NULL for none */
+    led_effect_id_t id;             /*!< running effect */
+    led_effect_params_t params;     /*!< its parameters */
+    int64_t cycle_start_us;         /*!< start of the current period */
+    uint32_t period_us;
+    uint32_t phase_scale;           /*!< 2^40 / period_us, turns time into a Q16 phase */
+    uint32_t state[LED_EFFECT_STATE_WORDS]; /*!< private to the running effect */
+    bool redraw;                    /*!< strip content unknown: the next frame is drawn in full */
+    uint8_t *cache;                 /*!< frame cache, NULL to always render live */
+    uint32_t cache_size;            /*!< its size in bytes: the memory budget, at most 32 KiB are used */
+    uint32_t frame_us;              /*!< frame period the cache is built for */
+    uint32_t cache_frames;          /*!< frames in the cache, 0 until built */
+    uint32_t cache_used;            /*!< bytes of the cache they take */
+    bool cache_over_budget;         /*!< running effect did not fit, rendered live */
+    led_effect_stats_t stats[LED_EFFECT_MAX];
+} led_effect_player_t;
+
+/**
+ * @brief Start an effect on a player
+ *
+ * @param player: player with strip, num_pixels and scale set
+ * @param id: effect to play
+ * @param params: effect parameters, copied
+ * @param now_us: current time, e.g. esp_timer_get_time()
+ *
+ * @return
+ *      - ESP_OK: Effect started
+ *      - ESP_ERR_INVALID_ARG: Unknown effect or missing strip
+ */
+esp_err_t led_effect_start(led_effect_player_t *player, led_effect_id_t id, const led_effect_params_t *params,
+                           int64_t now_us);
+
+/**
+ * @brief Draw the frame of the running effect due at `now_us` into the strip buffer
+ *
+ * Late or skipped calls do not slow the effect down: the frame only depends
+ * on the time elapsed since led_effect_start(). The render time is added to
+ * the effect's stats.
+ *
+ * @param player: player of the effect
+ * @param now_us: current time, e.g. esp_timer_get_time()
+ *
+ * @return
+ *      - ESP_OK: Frame drawn
+ *      - ESP_ERR_INVALID_STATE: No effect started
+ */
+esp_err_t led_effect_render(led_effect_player_t *player, int64_t now_us);
+
+/**
+ * @brief Drop the cached frames, e.g. after the brightness table changed
+ *
+ * The cache is rebuilt by the next led_effect_render(), and effects that only
+ * draw what moved redraw the whole strip. Call it as well when something else
+ * has drawn on the strip.
+ *
+ * @param player: player of the effect
+ */
+void led_effect_invalidate(led_effect_player_t *player);
+
+/**
+ * @brief Name of an effect, for logs
+ */
+const char *led_effect_name(led_effect_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
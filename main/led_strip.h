@@ -17,6 +17,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include "esp_err.h"
 
 /**
@@ -31,6 +32,14 @@ typedef struct led_strip_s led_strip_t;
 */
 typedef void *led_strip_dev_t;
 
+/**
+* @brief Frame transmitted callback, invoked from the RMT interrupt handler
+*
+* @param strip: LED strip whose frame has left the wire
+* @param arg: user argument from the configuration
+*/
+typedef void (*led_strip_done_cb_t)(led_strip_t *strip, void *arg);
+
 /**
 * @brief Declare of LED Strip Type
 *
@@ -52,6 +61,48 @@ struct led_strip_s {
     */
     esp_err_t (*set_pixel)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
 
+    /**
+    * @brief Set the same RGB for every pixel of the strip in one pass
+    *
+    * @param strip: LED strip
+    * @param red: red part of color
+    * @param green: green part of color
+    * @param blue: blue part of color
+    *
+    * @return
+    *      - ESP_OK: Set RGB for all pixels successfully
+    *      - ESP_FAIL: Set RGB for all pixels failed because some other error occurred
+    */
+    esp_err_t (*fill)(led_strip_t *strip, uint32_t red, uint32_t green, uint32_t blue);
+
+    /**
+    * @brief Copy raw pixels into the strip memory
+    *
+    * @param strip: LED strip
+    * @param index: first pixel to write
+    * @param grb: pixel data, 3 bytes per pixel in the order of GRB
+    * @param count: number of pixels
+    *
+    * @return
+    *      - ESP_OK: Pixels written
+    *      - ESP_ERR_INVALID_ARG: Range out of the strip
+    */
+    esp_err_t (*write)(led_strip_t *strip, uint32_t index, const uint8_t *grb, uint32_t count);
+
+    /**
+    * @brief Copy raw pixels out of the strip memory
+    *
+    * @param strip: LED strip
+    * @param index: first pixel to read
+    * @param[out] grb: pixel data, 3 bytes per pixel in the order of GRB
+    * @param count: number of pixels
+    *
+    * @return
+    *      - ESP_OK: Pixels read
+    *      - ESP_ERR_INVALID_ARG: Range out of the strip
+    */
+    esp_err_t (*read)(led_strip_t *strip, uint32_t index, uint8_t *grb, uint32_t count);
+
     /**
     * @brief Refresh memory colors to LEDs
     *
@@ -65,9 +116,27 @@ struct led_strip_s {
     *
     * @note:
     *      After updating the LED colors in the memory, a following invocation of this API is needed to flush colors to strip.
+    *      Nothing is sent when the colors in memory match the ones already on the strip, and a frame
+    *      only extends up to the last changed pixel: the pixels after it keep their color.
     */
     esp_err_t (*refresh)(led_strip_t *strip, uint32_t timeout_ms);
 
+    /**
+    * @brief Start flushing memory colors to LEDs without waiting for the transmission
+    *
+    * @param strip: LED strip
+    *
+    * @return
+    *      - ESP_OK: Frame handed to the hardware, completion is reported through the done callback
+    *      - ESP_ERR_INVALID_STATE: Previous frame is still on the wire, this frame was dropped
+    *      - ESP_FAIL: Refresh failed because some other error occurred
+    *
+    * @note:
+    *      The colors are copied before this returns, so the next frame can be drawn right away.
+    *      A dropped frame is not queued: call refresh() when the last frame must reach the strip.
+    */
+    esp_err_t (*refresh_async)(led_strip_t *strip);
+
     /**
     * @brief Clear LED strip (turn off all LEDs)
     *
@@ -100,6 +169,9 @@ struct led_strip_s {
 typedef struct {
     uint32_t max_leds;   /*!< Maximum LEDs in a single strip */
     led_strip_dev_t dev; /*!< LED strip device (e.g. RMT channel, PWM channel, etc) */
+    led_strip_done_cb_t done_cb; /*!< Called from ISR when a frame has been transmitted, optional */
+    bool pre_encode;     /*!< Keep the strip encoded for the hardware and patch only what changes (RMT: 96 bytes per LED, encoded while transmitting when that is not available) */
+    void *done_arg;      /*!< User argument passed to done_cb */
 } led_strip_config_t;
 
 /**
@@ -16,7 +16,10 @@
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
 #include "led_strip.h"
+#include "led_color.h"
 #include "driver/rmt.h"
 
 static const char *TAG = "ws2812";
@@ -42,17 +45,38 @@ static uint32_t ws2812_t1h_ticks = 0;
 static uint32_t ws2812_t0l_ticks = 0;
 static uint32_t ws2812_t1l_ticks = 0;
 
+// RMT items of every nibble value, MSB first, built once the timing is known
+static DRAM_ATTR rmt_item32_t ws2812_nibble_items[16][4];
+
 typedef struct {
     led_strip_t parent;
     rmt_channel_t rmt_channel;
     uint32_t strip_len;
-    uint8_t buffer[0];
+    led_strip_done_cb_t done_cb;
+    void *done_arg;
+    volatile bool tx_busy;
+    volatile int64_t tx_end_us; // last frame off the wire, the strip latches it WS2812_RESET_US later
+    uint32_t frames_dropped;
+    uint32_t frames_skipped;
+    uint32_t dirty_start;  // pixels [dirty_start, dirty_end) of buffer may differ from front
+    uint32_t dirty_end;
+    bool front_stale;      // strip content unknown, send the next frame whatever it holds
+    uint8_t *front;        // what is on (or going to) the strip, read by the RMT translator
+    rmt_item32_t *items;   // pre_encode: front as RMT items, transmitted without the translator
+    uint8_t *buffer;       // back buffer the caller draws into
 } ws2812_t;
 
+// Strips by RMT channel, for dispatching the (driver wide) TX end callback
+static ws2812_t *ws2812_channels[RMT_CHANNEL_MAX];
+static portMUX_TYPE ws2812_lock = portMUX_INITIALIZER_UNLOCKED;
+
 /**
  * @brief Conver RGB data to RMT format.
  *
  * @note For WS2812, R,G,B each contains 256 different choices (i.e. uint8_t)
+ * @note Each byte is emitted as two 4-item copies from ws2812_nibble_items
+ * @note The RMT driver calls this once for the whole channel memory and then from its ISR for every
+ *       half block the hardware has sent, so a frame is never encoded beyond mem_block_num * 64 items
  *
  * @param[in] src: source data, to converted to RMT format
  * @param[in] dest: place where to store the convert result
@@ -69,28 +93,17 @@ static void IRAM_ATTR ws2812_rmt_adapter(const void *src, rmt_item32_t *dest, si
         *item_num = 0;
         return;
     }
-    const rmt_item32_t bit0 = {{{ ws2812_t0h_ticks, 1, ws2812_t0l_ticks, 0 }}}; //Logical 0
-    const rmt_item32_t bit1 = {{{ ws2812_t1h_ticks, 1, ws2812_t1l_ticks, 0 }}}; //Logical 1
-    size_t size = 0;
-    size_t num = 0;
-    uint8_t *psrc = (uint8_t *)src;
+    // Whole bytes that fit the chunk, 8 items each
+    size_t size = wanted_num / 8 < src_size ? wanted_num / 8 : src_size;
+    const uint8_t *psrc = (const uint8_t *)src;
     rmt_item32_t *pdest = dest;
-    while (size < src_size && num < wanted_num) {
-        for (int i = 0; i < 8; i++) {
-            // MSB first
-            if (*psrc & (1 << (7 - i))) {
-                pdest->val =  bit1.val;
-            } else {
-                pdest->val =  bit0.val;
-            }
-            num++;
-            pdest++;
-        }
-        size++;
-        psrc++;
+    for (size_t i = 0; i < size; i++, pdest += 8) {
+        // MSB first
+        memcpy(pdest, ws2812_nibble_items[psrc[i] >> 4], sizeof(ws2812_nibble_items[0]));
+        memcpy(pdest + 4, ws2812_nibble_items[psrc[i] & 0x0F], sizeof(ws2812_nibble_items[0]));
     }
     *translated_size = size;
-    *item_num = num;
+    *item_num = size * 8;
 }
 
 static esp_err_t ws2812_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
@@ -98,39 +111,259 @@ static esp_err_t ws2812_set_pixel(led_strip_t *strip, uint32_t index, uint32_t r
     esp_err_t ret = ESP_OK;
     ws2812_t *ws2812 = __containerof(strip, ws2812_t, parent);
     STRIP_CHECK(index < ws2812->strip_len, "index out of the maximum number of leds", err, ESP_ERR_INVALID_ARG);
-    uint32_t start = index * 3;
+    uint8_t *pixel = &ws2812->buffer[index * 3];
     // In thr order of GRB
-    ws2812->buffer[start + 0] = green & 0xFF;
-    ws2812->buffer[start + 1] = red & 0xFF;
-    ws2812->buffer[start + 2] = blue & 0xFF;
+    if (pixel[0] == (green & 0xFF) && pixel[1] == (red & 0xFF) && pixel[2] == (blue & 0xFF)) {
+        return ESP_OK;
+    }
+    pixel[0] = green & 0xFF;
+    pixel[1] = red & 0xFF;
+    pixel[2] = blue & 0xFF;
+    if (index < ws2812->dirty_start) {
+        ws2812->dirty_start = index;
+    }
+    if (index >= ws2812->dirty_end) {
+        ws2812->dirty_end = index + 1;
+    }
+    return ESP_OK;
+err:
+    return ret;
+}
+
+static esp_err_t ws2812_fill(led_strip_t *strip, uint32_t red, uint32_t green, uint32_t blue)
+{
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, parent);
+    led_color_fill_grb(ws2812->buffer, ws2812->strip_len, red & 0xFF, green & 0xFF, blue & 0xFF);
+    ws2812->dirty_start = 0;
+    ws2812->dirty_end = ws2812->strip_len;
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_write(led_strip_t *strip, uint32_t index, const uint8_t *grb, uint32_t count)
+{
+    esp_err_t ret = ESP_OK;
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, parent);
+    STRIP_CHECK(index <= ws2812->strip_len && count <= ws2812->strip_len - index, "range out of the strip", err,
+                ESP_ERR_INVALID_ARG);
+    if (!count) {
+        return ESP_OK;
+    }
+    memcpy(ws2812->buffer + index * 3, grb, count * 3);
+    if (index < ws2812->dirty_start) {
+        ws2812->dirty_start = index;
+    }
+    if (index + count > ws2812->dirty_end) {
+        ws2812->dirty_end = index + count;
+    }
+    return ESP_OK;
+err:
+    return ret;
+}
+
+static esp_err_t ws2812_read(led_strip_t *strip, uint32_t index, uint8_t *grb, uint32_t count)
+{
+    esp_err_t ret = ESP_OK;
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, parent);
+    STRIP_CHECK(index <= ws2812->strip_len && count <= ws2812->strip_len - index, "range out of the strip", err,
+                ESP_ERR_INVALID_ARG);
+    memcpy(grb, ws2812->buffer + index * 3, count * 3);
     return ESP_OK;
 err:
     return ret;
 }
 
+static void IRAM_ATTR ws2812_tx_end(rmt_channel_t channel, void *arg)
+{
+    ws2812_t *ws2812 = ws2812_channels[channel];
+    if (!ws2812) {
+        return;
+    }
+    portENTER_CRITICAL_ISR(&ws2812_lock);
+    ws2812->tx_end_us = esp_timer_get_time();
+    ws2812->tx_busy = false;
+    portEXIT_CRITICAL_ISR(&ws2812_lock);
+    if (ws2812->done_cb) {
+        ws2812->done_cb(&ws2812->parent, ws2812->done_arg);
+    }
+}
+
+static bool ws2812_claim_tx(ws2812_t *ws2812)
+{
+    bool claimed = false;
+    portENTER_CRITICAL(&ws2812_lock);
+    if (!ws2812->tx_busy) {
+        ws2812->tx_busy = true;
+        claimed = true;
+    }
+    portEXIT_CRITICAL(&ws2812_lock);
+    return claimed;
+}
+
+static void ws2812_release_tx(ws2812_t *ws2812)
+{
+    portENTER_CRITICAL(&ws2812_lock);
+    ws2812->tx_busy = false;
+    portEXIT_CRITICAL(&ws2812_lock);
+}
+
+// A frame sent before the line has been low for WS2812_RESET_US runs into the previous one and is lost
+static uint32_t ws2812_latch_wait_us(ws2812_t *ws2812)
+{
+    int64_t wait_us = ws2812->tx_end_us + WS2812_RESET_US - esp_timer_get_time();
+    return wait_us > 0 ? (uint32_t)wait_us : 0;
+}
+
+static inline bool ws2812_is_dirty(ws2812_t *ws2812)
+{
+    return ws2812->dirty_start < ws2812->dirty_end;
+}
+
+// Re-encode bytes [start, end) of the front buffer into its RMT items
+static void ws2812_encode(ws2812_t *ws2812, uint32_t start, uint32_t end)
+{
+    rmt_item32_t *item = ws2812->items + start * 8;
+    for (uint32_t i = start; i < end; i++, item += 8) {
+        uint8_t byte = ws2812->front[i];
+        memcpy(item, ws2812_nibble_items[byte >> 4], sizeof(ws2812_nibble_items[0]));
+        memcpy(item + 4, ws2812_nibble_items[byte & 0x0F], sizeof(ws2812_nibble_items[0]));
+    }
+}
+
+/**
+ * @brief Copy the dirty range of the back buffer to the front buffer, with the TX claimed
+ *
+ * @return Bytes to transmit, 0 when the strip already shows the back buffer.
+ *         Pixels after the last changed one keep their color, so only that prefix is sent.
+ *         fill() dirties the whole strip, so the range is trimmed to the bytes that differ.
+ */
+static uint32_t ws2812_commit(ws2812_t *ws2812)
+{
+    uint32_t start = ws2812->dirty_start * 3;
+    uint32_t end = ws2812->dirty_end * 3;
+    ws2812->dirty_start = ws2812->strip_len;
+    ws2812->dirty_end = 0;
+    if (start >= end) {
+        return 0;
+    }
+    if (ws2812->front_stale) {
+        ws2812->front_stale = false;
+        memcpy(ws2812->front, ws2812->buffer, ws2812->strip_len * 3);
+        if (ws2812->items) {
+            ws2812_encode(ws2812, 0, ws2812->strip_len * 3);
+        }
+        return ws2812->strip_len * 3;
+    }
+    while (start < end && ws2812->front[start] == ws2812->buffer[start]) {
+        start++;
+    }
+    while (end > start && ws2812->front[end - 1] == ws2812->buffer[end - 1]) {
+        end--;
+    }
+    if (start == end) {
+        ws2812->frames_skipped++;
+        return 0;
+    }
+    memcpy(ws2812->front + start, ws2812->buffer + start, end - start);
+    if (ws2812->items) {
+        ws2812_encode(ws2812, start, end);
+    }
+    return (end + 2) / 3 * 3;
+}
+
+// The RMT translator reads front until the frame is out, so the caller may draw into buffer meanwhile
+static esp_err_t ws2812_transmit(ws2812_t *ws2812, uint32_t size)
+{
+    esp_err_t err = ws2812->items ? rmt_write_items(ws2812->rmt_channel, ws2812->items, size * 8, false) :
+                    rmt_write_sample(ws2812->rmt_channel, ws2812->front, size, false);
+    if (err != ESP_OK) {
+        ws2812_release_tx(ws2812);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 static esp_err_t ws2812_refresh(led_strip_t *strip, uint32_t timeout_ms)
 {
     esp_err_t ret = ESP_OK;
     ws2812_t *ws2812 = __containerof(strip, ws2812_t, parent);
-    STRIP_CHECK(rmt_write_sample(ws2812->rmt_channel, ws2812->buffer, ws2812->strip_len * 3, true) == ESP_OK,
-                "transmit RMT samples failed", err, ESP_FAIL);
+    if (!ws2812_is_dirty(ws2812)) {
+        return ESP_OK;
+    }
+    // The TX semaphore is released just before the TX end callback runs, so wait for both
+    while (!ws2812_claim_tx(ws2812)) {
+        STRIP_CHECK(rmt_wait_tx_done(ws2812->rmt_channel, pdMS_TO_TICKS(timeout_ms)) == ESP_OK,
+                    "previous frame still transmitting", err, ESP_ERR_TIMEOUT);
+    }
+    uint32_t latch_us = ws2812_latch_wait_us(ws2812);
+    if (latch_us) {
+        esp_rom_delay_us(latch_us);
+    }
+    uint32_t size = ws2812_commit(ws2812);
+    if (!size) {
+        ws2812_release_tx(ws2812);
+        return ESP_OK;
+    }
+    STRIP_CHECK(ws2812_transmit(ws2812, size) == ESP_OK, "transmit RMT samples failed", err, ESP_FAIL);
     return rmt_wait_tx_done(ws2812->rmt_channel, pdMS_TO_TICKS(timeout_ms));
 err:
     return ret;
 }
 
+static esp_err_t ws2812_refresh_async(led_strip_t *strip)
+{
+    ws2812_t *ws2812 = __containerof(strip, ws2812_t, parent);
+    if (!ws2812_is_dirty(ws2812)) {
+        return ESP_OK;
+    }
+    // A dropped frame stays dirty, the next refresh sends it
+    if (!ws2812_claim_tx(ws2812)) {
+        ws2812->frames_dropped++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Still latching the previous frame counts as busy too: refresh() waits it out
+    if (ws2812_latch_wait_us(ws2812)) {
+        ws2812_release_tx(ws2812);
+        ws2812->frames_dropped++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t size = ws2812_commit(ws2812);
+    if (!size) {
+        ws2812_release_tx(ws2812);
+        return ESP_OK;
+    }
+    if (ws2812_transmit(ws2812, size) != ESP_OK) {
+        ESP_LOGE(TAG, "%s(%d): transmit RMT samples failed", __FUNCTION__, __LINE__);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 static esp_err_t ws2812_clear(led_strip_t *strip, uint32_t timeout_ms)
 {
     ws2812_t *ws2812 = __containerof(strip, ws2812_t, parent);
     // Write zero to turn off all leds
     memset(ws2812->buffer, 0, ws2812->strip_len * 3);
+    ws2812->dirty_start = 0;
+    ws2812->dirty_end = ws2812->strip_len;
     return ws2812_refresh(strip, timeout_ms);
 }
 
+static void ws2812_free(ws2812_t *ws2812)
+{
+    free(ws2812->items);
+    free(ws2812->front);
+    free(ws2812->buffer);
+    free(ws2812);
+}
+
 static esp_err_t ws2812_del(led_strip_t *strip)
 {
     ws2812_t *ws2812 = __containerof(strip, ws2812_t, parent);
-    free(ws2812);
+    rmt_wait_tx_done(ws2812->rmt_channel, portMAX_DELAY);
+    ws2812_channels[ws2812->rmt_channel] = NULL;
+    ESP_LOGD(TAG, "%u frames dropped while transmitting, %u unchanged frames skipped",
+             ws2812->frames_dropped, ws2812->frames_skipped);
+    ws2812_free(ws2812);
     return ESP_OK;
 }
 
@@ -139,14 +372,26 @@ led_strip_t *led_strip_new_rmt_ws2812(const led_strip_config_t *config)
     led_strip_t *ret = NULL;
     STRIP_CHECK(config, "configuration can't be null", err, NULL);
 
-    // 24 bits per led
-    uint32_t ws2812_size = sizeof(ws2812_t) + config->max_leds * 3;
-    ws2812_t *ws2812 = calloc(1, ws2812_size);
+    STRIP_CHECK(config->max_leds, "strip can't be empty", err, NULL);
+    ws2812_t *ws2812 = calloc(1, sizeof(ws2812_t));
     STRIP_CHECK(ws2812, "request memory for ws2812 failed", err, NULL);
+    // 24 bits per led, drawn into the back buffer and transmitted from the front one.
+    // Separate blocks, so a long strip does not need one contiguous run of heap.
+    ws2812->buffer = calloc(config->max_leds, 3);
+    ws2812->front = calloc(config->max_leds, 3);
+    STRIP_CHECK(ws2812->buffer && ws2812->front, "request memory for %u leds failed", err_mem, NULL,
+                config->max_leds);
+    if (config->pre_encode) {
+        // One RMT item per bit; without them frames are encoded while streaming, so only warn
+        ws2812->items = malloc(config->max_leds * 24 * sizeof(rmt_item32_t));
+        if (!ws2812->items) {
+            ESP_LOGW(TAG, "no memory to pre-encode %u leds, encoding while transmitting", config->max_leds);
+        }
+    }
 
     uint32_t counter_clk_hz = 0;
     STRIP_CHECK(rmt_get_counter_clock((rmt_channel_t)config->dev, &counter_clk_hz) == ESP_OK,
-                "get rmt counter clock failed", err, NULL);
+                "get rmt counter clock failed", err_mem, NULL);
     // ns -> ticks
     float ratio = (float)counter_clk_hz / 1e9;
     ws2812_t0h_ticks = (uint32_t)(ratio * WS2812_T0H_NS);
@@ -154,18 +399,40 @@ led_strip_t *led_strip_new_rmt_ws2812(const led_strip_config_t *config)
     ws2812_t1h_ticks = (uint32_t)(ratio * WS2812_T1H_NS);
     ws2812_t1l_ticks = (uint32_t)(ratio * WS2812_T1L_NS);
 
+    const rmt_item32_t bit0 = {{{ ws2812_t0h_ticks, 1, ws2812_t0l_ticks, 0 }}}; //Logical 0
+    const rmt_item32_t bit1 = {{{ ws2812_t1h_ticks, 1, ws2812_t1l_ticks, 0 }}}; //Logical 1
+    for (int nibble = 0; nibble < 16; nibble++) {
+        for (int i = 0; i < 4; i++) {
+            ws2812_nibble_items[nibble][i] = (nibble & (1 << (3 - i))) ? bit1 : bit0;
+        }
+    }
+
     // set ws2812 to rmt adapter
     rmt_translator_init((rmt_channel_t)config->dev, ws2812_rmt_adapter);
 
     ws2812->rmt_channel = (rmt_channel_t)config->dev;
     ws2812->strip_len = config->max_leds;
+    // Whatever the strip shows after a reset, the first frame goes out in full
+    ws2812->front_stale = true;
+    ws2812->dirty_start = 0;
+    ws2812->dirty_end = ws2812->strip_len;
+    ws2812->done_cb = config->done_cb;
+    ws2812->done_arg = config->done_arg;
+    ws2812_channels[ws2812->rmt_channel] = ws2812;
+    rmt_register_tx_end_callback(ws2812_tx_end, NULL);
 
     ws2812->parent.set_pixel = ws2812_set_pixel;
+    ws2812->parent.fill = ws2812_fill;
+    ws2812->parent.write = ws2812_write;
+    ws2812->parent.read = ws2812_read;
     ws2812->parent.refresh = ws2812_refresh;
+    ws2812->parent.refresh_async = ws2812_refresh_async;
     ws2812->parent.clear = ws2812_clear;
     ws2812->parent.del = ws2812_del;
 
     return &ws2812->parent;
+err_mem:
+    ws2812_free(ws2812);
 err:
     return ret;
 }
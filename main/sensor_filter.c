@@ -0,0 +1,72 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include "sensor_filter.h"
+
+void sensor_filter_reset(sensor_filter_t *filter)
+{
+    filter->primed = false;
+    filter->count = 0;
+    filter->next = 0;
+    filter->run = 0;
+}
+
+/* Insertion sort of a copy: the window is a handful of samples */
+static int32_t sensor_filter_median(const sensor_filter_t *filter)
+{
+    int32_t sorted[SENSOR_FILTER_MEDIAN_MAX];
+    for (uint8_t i = 0; i < filter->count; i++) {
+        int32_t v = filter->window[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+    return sorted[(filter->count - 1) / 2];
+}
+
+bool sensor_filter_apply(sensor_filter_t *filter, int32_t value, int32_t *out)
+{
+    if (filter->primed && filter->outlier > 0 && llabs((int64_t)value - filter->last) > filter->outlier) {
+        // A real step repeats itself, spikes scatter
+        filter->run = filter->run && llabs((int64_t)value - filter->pending) <= filter->outlier ? filter->run + 1 : 1;
+        filter->pending = value;
+        if (filter->run <= filter->outlier_max) {
+            filter->rejected++;
+            return false;
+        }
+        // Still there: the signal stepped, follow it instead of averaging towards it
+        sensor_filter_reset(filter);
+        filter->restarts++;
+    }
+    filter->run = 0;
+
+    uint8_t len = filter->median > SENSOR_FILTER_MEDIAN_MAX ? SENSOR_FILTER_MEDIAN_MAX : filter->median;
+    if (len > 1) {
+        filter->window[filter->next] = value;
+        filter->next = (filter->next + 1) % len;
+        if (filter->count < len) {
+            filter->count++;
+        }
+        value = sensor_filter_median(filter);
+    }
+
+    int64_t fixed = (int64_t)value * (1 << SENSOR_FILTER_EMA_FRAC);
+    if (!filter->primed || !filter->ema_shift) {
+        filter->ema = fixed;
+    } else {
+        filter->ema += (fixed - filter->ema) / (1 << filter->ema_shift);
+    }
+    filter->primed = true;
+    // Round half up: >> floors negative values as well
+    filter->last = (int32_t)((filter->ema + (1 << (SENSOR_FILTER_EMA_FRAC - 1))) >> SENSOR_FILTER_EMA_FRAC);
+    *out = filter->last;
+    return true;
+}
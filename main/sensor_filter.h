@@ -0,0 +1,69 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SENSOR_FILTER_MEDIAN_MAX
+#define SENSOR_FILTER_MEDIAN_MAX  7 /*!< longest median window, in samples */
+#endif
+#define SENSOR_FILTER_EMA_FRAC    8 /*!< fractional bits of the moving average */
+
+/**
+ * @brief Noise filter of one sensor param
+ *
+ * Samples go through, in order: outlier rejection against the last output,
+ * a median of the latest samples and an exponential moving average. Each
+ * stage is skipped when left at 0. Values are integers in the param's
+ * fixed-point unit, e.g. hundredths; the state is a few dozen bytes
+ * whatever the settings.
+ */
+typedef struct {
+    uint8_t median;             /*!< median of this many latest samples, odd, up to SENSOR_FILTER_MEDIAN_MAX */
+    uint8_t ema_shift;          /*!< a sample weighs 1/2^ema_shift in the moving average */
+    uint8_t outlier_max;        /*!< outliers in a row, close to each other, taken as a real step: the filter restarts there */
+    int32_t outlier;            /*!< samples further than this from the last output are rejected, in value units */
+    uint32_t rejected;          /*!< samples rejected as outliers */
+    uint32_t restarts;          /*!< steps followed by restarting the filter */
+    /* Private */
+    bool primed;                /*!< a sample went through */
+    uint8_t count;              /*!< samples in the window */
+    uint8_t next;               /*!< where the next one goes */
+    uint8_t run;                /*!< outliers in a row */
+    int32_t pending;            /*!< last outlier */
+    int32_t last;               /*!< last output */
+    int64_t ema;                /*!< moving average, SENSOR_FILTER_EMA_FRAC fractional bits */
+    int32_t window[SENSOR_FILTER_MEDIAN_MAX];
+} sensor_filter_t;
+
+/**
+ * @brief Filter a sample
+ *
+ * @param filter: filter of the param
+ * @param value: new sample
+ * @param out: filtered value, set unless the sample was rejected
+ *
+ * @return false when the sample was rejected as an outlier and there is no
+ *         new value
+ */
+bool sensor_filter_apply(sensor_filter_t *filter, int32_t value, int32_t *out);
+
+/**
+ * @brief Forget past samples, e.g. after the sensor was reconfigured; the next one goes through as is
+ *
+ * @param filter: filter of the param
+ */
+void sensor_filter_reset(sensor_filter_t *filter);
+
+#ifdef __cplusplus
+}
+#endif
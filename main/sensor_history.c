@@ -0,0 +1,96 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "sensor_history.h"
+
+static const uint32_t s_tier_span_s[SENSOR_HISTORY_TIERS] = { 0, 60, 3600 };
+static const uint16_t s_tier_len[SENSOR_HISTORY_TIERS] = {
+    SENSOR_HISTORY_RAW_LEN, SENSOR_HISTORY_MINUTE_LEN, SENSOR_HISTORY_HOUR_LEN,
+};
+
+static inline sensor_history_bucket_t *tier_buckets(const sensor_history_t *history, sensor_history_tier_t tier)
+{
+    const sensor_history_bucket_t *buckets[SENSOR_HISTORY_TIERS] = { history->raw, history->minute, history->hour };
+    return (sensor_history_bucket_t *)buckets[tier];
+}
+
+void sensor_history_init(sensor_history_t *history)
+{
+    memset(history, 0, sizeof(*history));
+}
+
+void sensor_history_add(sensor_history_t *history, int32_t value, uint32_t now_s)
+{
+    // A clock stepped back would open buckets out of order
+    const sensor_history_bucket_t *last = &history->raw[history->ring[SENSOR_HISTORY_RAW].head];
+    if (history->ring[SENSOR_HISTORY_RAW].used && now_s < last->start_s) {
+        now_s = last->start_s;
+    }
+    for (int tier = 0; tier < SENSOR_HISTORY_TIERS; tier++) {
+        sensor_history_bucket_t *buckets = tier_buckets(history, tier);
+        uint32_t span_s = s_tier_span_s[tier];
+        uint32_t start_s = span_s ? now_s - now_s % span_s : now_s;
+        sensor_history_ring_t *ring = &history->ring[tier];
+        sensor_history_bucket_t *bucket = &buckets[ring->head];
+
+        if (!ring->used || !span_s || bucket->start_s != start_s) {
+            if (ring->used) {
+                ring->head = (ring->head + 1) % s_tier_len[tier];
+                bucket = &buckets[ring->head];
+            }
+            if (ring->used < s_tier_len[tier]) {
+                ring->used++;
+            }
+            bucket->start_s = start_s;
+            bucket->count = 0;
+            bucket->min = value;
+            bucket->max = value;
+            ring->sum = 0;
+        }
+        bucket->count++;
+        ring->sum += value;
+        if (value < bucket->min) {
+            bucket->min = value;
+        }
+        if (value > bucket->max) {
+            bucket->max = value;
+        }
+        // Rounded half away from zero
+        int64_t half = bucket->count / 2;
+        bucket->mean = (ring->sum >= 0 ? ring->sum + half : ring->sum - half) / (int64_t)bucket->count;
+    }
+}
+
+void sensor_history_rebase(sensor_history_t *history, uint32_t offset_s)
+{
+    for (int tier = 0; tier < SENSOR_HISTORY_TIERS; tier++) {
+        sensor_history_bucket_t *buckets = tier_buckets(history, tier);
+        uint32_t span_s = s_tier_span_s[tier];
+        // Starts are whole periods apart, so they stay apart and in order once rounded down
+        for (uint16_t i = 0; i < history->ring[tier].used; i++) {
+            uint32_t start_s = buckets[i].start_s + offset_s;
+            buckets[i].start_s = span_s ? start_s - start_s % span_s : start_s;
+        }
+    }
+}
+
+size_t sensor_history_count(const sensor_history_t *history, sensor_history_tier_t tier)
+{
+    return tier < SENSOR_HISTORY_TIERS ? history->ring[tier].used : 0;
+}
+
+const sensor_history_bucket_t *sensor_history_get(const sensor_history_t *history, sensor_history_tier_t tier,
+                                                  size_t age)
+{
+    if (tier >= SENSOR_HISTORY_TIERS || age >= history->ring[tier].used) {
+        return NULL;
+    }
+    uint16_t len = s_tier_len[tier];
+    return &tier_buckets(history, tier)[(history->ring[tier].head + len - age) % len];
+}
@@ -0,0 +1,120 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SENSOR_HISTORY_RAW_LEN
+#define SENSOR_HISTORY_RAW_LEN    64 /*!< latest samples kept as they came */
+#endif
+#ifndef SENSOR_HISTORY_MINUTE_LEN
+#define SENSOR_HISTORY_MINUTE_LEN 60 /*!< minutes of min/max/mean: an hour */
+#endif
+#ifndef SENSOR_HISTORY_HOUR_LEN
+#define SENSOR_HISTORY_HOUR_LEN   48 /*!< hours of min/max/mean: two days */
+#endif
+
+/**
+ * @brief Resolutions a history is kept at
+ */
+typedef enum {
+    SENSOR_HISTORY_RAW = 0, /*!< one bucket per sample */
+    SENSOR_HISTORY_MINUTE,  /*!< one bucket per minute with samples, wall-clock minutes given Unix time */
+    SENSOR_HISTORY_HOUR,    /*!< one bucket per hour with samples, likewise */
+    SENSOR_HISTORY_TIERS,
+} sensor_history_tier_t;
+
+/**
+ * @brief Samples of one period, in the param's fixed-point unit
+ */
+typedef struct {
+    uint32_t start_s;   /*!< start of the period (time of the sample for raw), seconds */
+    uint32_t count;     /*!< samples in it */
+    int32_t min;
+    int32_t max;
+    int32_t mean;       /*!< rounded, kept up to date while the period is open */
+} sensor_history_bucket_t;
+
+/**
+ * @brief Bookkeeping of one tier, private
+ */
+typedef struct {
+    uint16_t head;      /*!< newest bucket */
+    uint16_t used;      /*!< buckets holding data */
+    int64_t sum;        /*!< of the newest bucket */
+} sensor_history_ring_t;
+
+/**
+ * @brief Fixed-size history of one param
+ *
+ * Each tier is a ring: a sample updates the newest bucket of every tier,
+ * or opens the next one, in constant time. Periods without samples take
+ * no bucket, so look at start_s rather than counting buckets back.
+ */
+typedef struct {
+    sensor_history_bucket_t raw[SENSOR_HISTORY_RAW_LEN];
+    sensor_history_bucket_t minute[SENSOR_HISTORY_MINUTE_LEN];
+    sensor_history_bucket_t hour[SENSOR_HISTORY_HOUR_LEN];
+    sensor_history_ring_t ring[SENSOR_HISTORY_TIERS];
+} sensor_history_t;
+
+/**
+ * @brief Empty a history
+ */
+void sensor_history_init(sensor_history_t *history);
+
+/**
+ * @brief Add a sample to every tier
+ *
+ * @param history: history of the param
+ * @param value: sample, e.g. in hundredths
+ * @param now_s: time of the sample in seconds, held at the previous sample's if it
+ *               goes backwards; periods are multiples of 60 and 3600 of it, so Unix
+ *               time aligns them to the clock
+ */
+void sensor_history_add(sensor_history_t *history, int32_t value, uint32_t now_s);
+
+/**
+ * @brief Move every bucket later in time, e.g. from seconds since boot to Unix time once the clock is set
+ *
+ * Minute and hour buckets start on a period of the new time base again,
+ * so the samples that follow go on in the same buckets.
+ *
+ * @param history: history of the param
+ * @param offset_s: added to the start of every bucket
+ */
+void sensor_history_rebase(sensor_history_t *history, uint32_t offset_s);
+
+/**
+ * @brief Number of buckets a tier holds
+ */
+size_t sensor_history_count(const sensor_history_t *history, sensor_history_tier_t tier);
+
+/**
+ * @brief A bucket of a tier, in place
+ *
+ * The newest bucket (age 0) keeps changing while its period is open, and
+ * a bucket is reused once the tier wraps: read from the task that adds
+ * samples, or accept a torn bucket now and then.
+ *
+ * @param history: history of the param
+ * @param tier: resolution
+ * @param age: 0 for the newest bucket, 1 for the one before...
+ *
+ * @return The bucket, NULL if the tier holds no more than `age` buckets
+ */
+const sensor_history_bucket_t *sensor_history_get(const sensor_history_t *history, sensor_history_tier_t tier,
+                                                  size_t age);
+
+#ifdef __cplusplus
+}
+#endif
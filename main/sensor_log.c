@@ -0,0 +1,471 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <stddef.h>
+#include <esp_log.h>
+#include "sensor_log.h"
+
+static const char *TAG = "sensor_log";
+
+#define SENSOR_LOG_MAGIC        0x474f4c53 /* "SLOG" */
+#define SENSOR_LOG_REC_KEY      0x10       /* | channel, time u32, value varint */
+#define SENSOR_LOG_REC_DELTA    0x20       /* | channel, time delta varint, value delta varint */
+#define SENSOR_LOG_ACK_CHUNKS   32
+
+/* Start of every sector; acked loses one bit per SENSOR_LOG_ACK_CHUNK uploaded, from bit 0 */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t first_s;
+    uint32_t acked;
+} sensor_log_header_t;
+
+#define SENSOR_LOG_HEADER_SIZE  sizeof(sensor_log_header_t)
+
+static inline uint32_t sector_addr(const sensor_log_t *log, uint32_t seq)
+{
+    return (seq % log->sectors) * SENSOR_LOG_SECTOR_SIZE;
+}
+
+static inline uint32_t tail_seq(const sensor_log_t *log)
+{
+    return log->writer.seq + 1 - log->used;
+}
+
+static void cursor_start(sensor_log_cursor_t *cursor, uint32_t seq)
+{
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->seq = seq;
+    cursor->offset = SENSOR_LOG_HEADER_SIZE;
+}
+
+/* Records are decoded a few bytes at a time: read ahead, up to the end of the sector */
+static esp_err_t log_read(sensor_log_t *log, uint32_t addr, void *dst, size_t len)
+{
+    if (addr < log->cache_addr || addr + len > log->cache_addr + log->cache_len) {
+        size_t n = SENSOR_LOG_SECTOR_SIZE - addr % SENSOR_LOG_SECTOR_SIZE;
+        n = n < sizeof(log->cache) ? n : sizeof(log->cache);
+        if (len > n) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        esp_err_t err = esp_partition_read(log->partition, addr, log->cache, n);
+        if (err != ESP_OK) {
+            log->cache_len = 0;
+            return err;
+        }
+        log->cache_addr = addr;
+        log->cache_len = n;
+    }
+    memcpy(dst, log->cache + (addr - log->cache_addr), len);
+    return ESP_OK;
+}
+
+static esp_err_t log_write(sensor_log_t *log, uint32_t addr, const void *src, size_t len)
+{
+    log->cache_len = 0;
+    esp_err_t err = esp_partition_write(log->partition, addr, src, len);
+    if (err == ESP_OK) {
+        log->stats.bytes += len;
+    }
+    return err;
+}
+
+static esp_err_t read_header(sensor_log_t *log, uint32_t seq, sensor_log_header_t *header)
+{
+    return log_read(log, sector_addr(log, seq), header, sizeof(*header));
+}
+
+/* Varints hold 7 bits a byte, low bits first; signed values are zigzag encoded */
+static size_t put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    return n;
+}
+
+static bool get_varint(const uint8_t *p, size_t len, size_t *pos, uint32_t *v)
+{
+    uint32_t x = 0;
+    for (int shift = 0; shift < 35 && *pos < len; shift += 7) {
+        uint8_t b = p[(*pos)++];
+        x |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = x;
+            return true;
+        }
+    }
+    // Erased flash reads as endless continuation bytes: a torn record ends up here
+    return false;
+}
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u)
+{
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+/* Encode a sample after the state of `cursor`, as a keyframe if its channel has none before it in the sector */
+static size_t encode(const sensor_log_cursor_t *cursor, const sensor_log_sample_t *sample, uint8_t *rec)
+{
+    uint8_t ch = sample->channel;
+    if ((cursor->known & (1U << ch)) && sample->time_s >= cursor->time_s[ch]) {
+        rec[0] = SENSOR_LOG_REC_DELTA | ch;
+        size_t n = 1 + put_varint(rec + 1, sample->time_s - cursor->time_s[ch]);
+        // Wrapping arithmetic, any two values have a delta
+        return n + put_varint(rec + n, zigzag((int32_t)((uint32_t)sample->value - (uint32_t)cursor->value[ch])));
+    }
+    rec[0] = SENSOR_LOG_REC_KEY | ch;
+    memcpy(rec + 1, &sample->time_s, sizeof(sample->time_s));
+    return 5 + put_varint(rec + 5, zigzag(sample->value));
+}
+
+static void cursor_apply(sensor_log_cursor_t *cursor, const sensor_log_sample_t *sample, size_t len)
+{
+    cursor->known |= 1U << sample->channel;
+    cursor->time_s[sample->channel] = sample->time_s;
+    cursor->value[sample->channel] = sample->value;
+    cursor->offset += len;
+}
+
+/* Decode the record at the cursor: ESP_ERR_NOT_FOUND past the last one of the sector, ESP_ERR_INVALID_RESPONSE if torn */
+static esp_err_t decode(sensor_log_t *log, sensor_log_cursor_t *cursor, sensor_log_sample_t *sample)
+{
+    uint8_t rec[SENSOR_LOG_RECORD_MAX];
+    size_t len = SENSOR_LOG_SECTOR_SIZE - cursor->offset;
+    if (!len) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    len = len < sizeof(rec) ? len : sizeof(rec);
+    esp_err_t err = log_read(log, sector_addr(log, cursor->seq) + cursor->offset, rec, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (rec[0] == 0xff) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint8_t ch = rec[0] & 0x0f;
+    size_t pos = 1;
+    uint32_t dt, dv;
+    if (ch >= SENSOR_LOG_CHANNELS) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if ((rec[0] & 0xf0) == SENSOR_LOG_REC_KEY && len >= 5) {
+        memcpy(&sample->time_s, rec + 1, sizeof(sample->time_s));
+        pos = 5;
+        if (!get_varint(rec, len, &pos, &dv)) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        sample->value = unzigzag(dv);
+    } else if ((rec[0] & 0xf0) == SENSOR_LOG_REC_DELTA && (cursor->known & (1U << ch))) {
+        if (!get_varint(rec, len, &pos, &dt) || !get_varint(rec, len, &pos, &dv)) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        sample->time_s = cursor->time_s[ch] + dt;
+        sample->value = (int32_t)((uint32_t)cursor->value[ch] + (uint32_t)unzigzag(dv));
+    } else {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    sample->channel = ch;
+    cursor_apply(cursor, sample, pos);
+    return ESP_OK;
+}
+
+/* Erase the next sector, the oldest one once the log is full, and give it a header */
+static esp_err_t open_sector(sensor_log_t *log, uint32_t time_s)
+{
+    uint32_t seq = log->used ? log->writer.seq + 1 : log->writer.seq;
+    if (log->used == log->sectors) {
+        if (log->backlog.seq <= tail_seq(log)) {
+            log->stats.lost++;
+        }
+        log->used--;
+    }
+    uint32_t addr = sector_addr(log, seq);
+    log->cache_len = 0;
+    esp_err_t err = esp_partition_erase_range(log->partition, addr, SENSOR_LOG_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    log->stats.erases++;
+    // The upload mark stays erased until samples of the sector are uploaded
+    sensor_log_header_t header = { .magic = SENSOR_LOG_MAGIC, .seq = seq, .first_s = time_s };
+    err = log_write(log, addr, &header, offsetof(sensor_log_header_t, acked));
+    if (err != ESP_OK) {
+        return err;
+    }
+    cursor_start(&log->writer, seq);
+    log->used++;
+    return ESP_OK;
+}
+
+/* Write the records encoded in the batch, which end at `end` */
+static esp_err_t write_batch(sensor_log_t *log, const sensor_log_cursor_t *end, size_t len)
+{
+    if (!len) {
+        return ESP_OK;
+    }
+    esp_err_t err = log_write(log, sector_addr(log, log->writer.seq) + log->writer.offset, log->batch, len);
+    if (err != ESP_OK) {
+        // A record may be half written, nothing more goes after it
+        log->writer.offset = SENSOR_LOG_SECTOR_SIZE;
+        return err;
+    }
+    log->writer = *end;
+    return ESP_OK;
+}
+
+esp_err_t sensor_log_open(sensor_log_t *log, const esp_partition_t *partition)
+{
+    memset(log, 0, sizeof(*log));
+    portMUX_INITIALIZE(&log->lock);
+    log->partition = partition;
+    log->sectors = partition->size / SENSOR_LOG_SECTOR_SIZE;
+    if (log->sectors < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // The newest sector is the head, the valid ones before it the rest of the log
+    sensor_log_header_t header;
+    bool found = false;
+    uint32_t head = 0;
+    for (uint32_t i = 0; i < log->sectors; i++) {
+        esp_err_t err = log_read(log, i * SENSOR_LOG_SECTOR_SIZE, &header, sizeof(header));
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (header.magic == SENSOR_LOG_MAGIC && header.seq % log->sectors == i && (!found || header.seq > head)) {
+            head = header.seq;
+            found = true;
+        }
+    }
+    cursor_start(&log->writer, head);
+    cursor_start(&log->backlog, head);
+    if (!found) {
+        ESP_LOGI(TAG, "New log, %u sectors", (unsigned)log->sectors);
+        return ESP_OK;
+    }
+    for (log->used = 1; log->used < log->sectors && head >= log->used; log->used++) {
+        esp_err_t err = read_header(log, head - log->used, &header);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (header.magic != SENSOR_LOG_MAGIC || header.seq != head - log->used) {
+            break;
+        }
+    }
+
+    // Find the end of the head sector
+    sensor_log_sample_t sample;
+    esp_err_t err;
+    while ((err = decode(log, &log->writer, &sample)) == ESP_OK) {
+    }
+    if (err == ESP_ERR_INVALID_RESPONSE) {
+        ESP_LOGW(TAG, "Torn record at %u:%u, continuing in the next sector", (unsigned)head,
+                 (unsigned)log->writer.offset);
+        log->writer.offset = SENSOR_LOG_SECTOR_SIZE;
+    } else if (err != ESP_ERR_NOT_FOUND) {
+        return err;
+    }
+
+    // Resume uploading after the last sample marked uploaded
+    log->backlog = log->writer;
+    for (uint32_t seq = tail_seq(log); seq <= head; seq++) {
+        err = read_header(log, seq, &header);
+        if (err != ESP_OK) {
+            return err;
+        }
+        uint32_t chunks = header.acked ? __builtin_ctz(header.acked) : SENSOR_LOG_ACK_CHUNKS;
+        if (chunks == SENSOR_LOG_ACK_CHUNKS) {
+            continue;
+        }
+        uint32_t acked_end = SENSOR_LOG_HEADER_SIZE + chunks * SENSOR_LOG_ACK_CHUNK;
+        cursor_start(&log->backlog, seq);
+        for (;;) {
+            sensor_log_cursor_t next = log->backlog;
+            if (decode(log, &next, &sample) != ESP_OK || next.offset > acked_end) {
+                break;
+            }
+            log->backlog = next;
+        }
+        break;
+    }
+    ESP_LOGI(TAG, "%u of %u sectors in use, writing at %u:%u", (unsigned)log->used, (unsigned)log->sectors,
+             (unsigned)head, (unsigned)log->writer.offset);
+    return ESP_OK;
+}
+
+esp_err_t sensor_log_append(sensor_log_t *log, uint8_t channel, int32_t value, uint32_t time_s)
+{
+    if (channel >= SENSOR_LOG_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    portENTER_CRITICAL(&log->lock);
+    if (log->queue_len < SENSOR_LOG_QUEUE_LEN) {
+        sensor_log_sample_t *sample = &log->queue[log->queue_len++];
+        sample->time_s = time_s;
+        sample->value = value;
+        sample->channel = channel;
+        log->stats.appended++;
+    } else {
+        log->stats.dropped++;
+        err = ESP_ERR_NO_MEM;
+    }
+    portEXIT_CRITICAL(&log->lock);
+    return err;
+}
+
+esp_err_t sensor_log_flush(sensor_log_t *log)
+{
+    // Appends only add after the samples taken here
+    portENTER_CRITICAL(&log->lock);
+    size_t queued = log->queue_len;
+    portEXIT_CRITICAL(&log->lock);
+
+    // One flash write per sector the samples go to
+    size_t done = 0, batched = 0, len = 0;
+    sensor_log_cursor_t end = log->writer;
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && batched < queued) {
+        const sensor_log_sample_t *sample = &log->queue[batched];
+        size_t n = encode(&end, sample, log->batch + len);
+        if (log->used && end.offset + n <= SENSOR_LOG_SECTOR_SIZE) {
+            cursor_apply(&end, sample, n);
+            len += n;
+            batched++;
+            continue;
+        }
+        if ((err = write_batch(log, &end, len)) == ESP_OK) {
+            done = batched;
+            len = 0;
+            err = open_sector(log, sample->time_s);
+            end = log->writer;
+        }
+    }
+    if (err == ESP_OK && (err = write_batch(log, &end, len)) == ESP_OK) {
+        done = batched;
+    }
+    log->stats.written += done;
+
+    portENTER_CRITICAL(&log->lock);
+    memmove(log->queue, log->queue + done, (log->queue_len - done) * sizeof(log->queue[0]));
+    log->queue_len -= done;
+    portEXIT_CRITICAL(&log->lock);
+    return err;
+}
+
+size_t sensor_log_read(sensor_log_t *log, sensor_log_cursor_t *cursor, sensor_log_sample_t *out, size_t max)
+{
+    size_t n = 0;
+    if (!log->used) {
+        return 0;
+    }
+    if (cursor->seq < tail_seq(log)) {
+        cursor_start(cursor, tail_seq(log));
+    }
+    while (n < max) {
+        if (cursor->seq == log->writer.seq && cursor->offset >= log->writer.offset) {
+            break;
+        }
+        esp_err_t err = decode(log, cursor, &out[n]);
+        if (err == ESP_OK) {
+            n++;
+            continue;
+        }
+        if (cursor->seq >= log->writer.seq || (err != ESP_ERR_NOT_FOUND && err != ESP_ERR_INVALID_RESPONSE)) {
+            break;
+        }
+        // Past the last record of the sector, or at a torn one
+        cursor_start(cursor, cursor->seq + 1);
+    }
+    return n;
+}
+
+esp_err_t sensor_log_seek(sensor_log_t *log, uint32_t time_s, sensor_log_cursor_t *cursor)
+{
+    *cursor = log->writer;
+    if (!log->used) {
+        return ESP_OK;
+    }
+    // Last sector starting at or before time_s
+    uint32_t lo = tail_seq(log), hi = log->writer.seq;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        sensor_log_header_t header;
+        esp_err_t err = read_header(log, mid, &header);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (header.first_s <= time_s) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    cursor_start(cursor, lo);
+    for (;;) {
+        sensor_log_cursor_t at = *cursor;
+        sensor_log_sample_t sample;
+        if (!sensor_log_read(log, cursor, &sample, 1)) {
+            break;
+        }
+        if (sample.time_s >= time_s) {
+            *cursor = at;
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+void sensor_log_backlog(sensor_log_t *log, sensor_log_cursor_t *cursor)
+{
+    *cursor = log->backlog;
+    if (log->used && cursor->seq < tail_seq(log)) {
+        cursor_start(cursor, tail_seq(log));
+    }
+}
+
+/* Clear the upload mark of a sector up to `chunks`; bits are only ever cleared, no erase needed */
+static esp_err_t mark_uploaded(sensor_log_t *log, uint32_t seq, uint32_t chunks)
+{
+    sensor_log_header_t header;
+    esp_err_t err = read_header(log, seq, &header);
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint32_t acked = chunks >= SENSOR_LOG_ACK_CHUNKS ? 0 : header.acked & ~((1U << chunks) - 1);
+    if (acked == header.acked) {
+        return ESP_OK;
+    }
+    return log_write(log, sector_addr(log, seq) + offsetof(sensor_log_header_t, acked), &acked, sizeof(acked));
+}
+
+esp_err_t sensor_log_ack(sensor_log_t *log, const sensor_log_cursor_t *cursor)
+{
+    esp_err_t err = ESP_OK;
+    if (log->used) {
+        uint32_t seq = log->backlog.seq > tail_seq(log) ? log->backlog.seq : tail_seq(log);
+        for (; seq < cursor->seq && seq <= log->writer.seq && err == ESP_OK; seq++) {
+            err = mark_uploaded(log, seq, SENSOR_LOG_ACK_CHUNKS);
+        }
+        if (err == ESP_OK && cursor->seq <= log->writer.seq) {
+            err = mark_uploaded(log, cursor->seq, (cursor->offset - SENSOR_LOG_HEADER_SIZE) / SENSOR_LOG_ACK_CHUNK);
+        }
+    }
+    log->backlog = *cursor;
+    return err;
+}
@@ -0,0 +1,170 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_partition.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_LOG_SECTOR_SIZE  4096 /*!< flash erase unit, the log fills one at a time */
+#define SENSOR_LOG_CHANNELS     8    /*!< series one log holds */
+#define SENSOR_LOG_QUEUE_LEN    32   /*!< samples waiting for sensor_log_flush() */
+#define SENSOR_LOG_ACK_CHUNK    128  /*!< granularity of the upload mark in a sector, bytes */
+#define SENSOR_LOG_RECORD_MAX   11   /*!< longest encoded sample */
+
+/**
+ * @brief One sample of a series
+ */
+typedef struct {
+    uint32_t time_s;    /*!< wall clock, seconds */
+    int32_t value;      /*!< e.g. in hundredths */
+    uint8_t channel;    /*!< series, below SENSOR_LOG_CHANNELS */
+} sensor_log_sample_t;
+
+/**
+ * @brief Position in the log, with what is needed to decode from there
+ */
+typedef struct {
+    uint32_t seq;                           /*!< sector, counted since the log was created */
+    uint16_t offset;                        /*!< next record in the sector */
+    uint8_t known;                          /*!< channels with a keyframe earlier in the sector */
+    uint32_t time_s[SENSOR_LOG_CHANNELS];   /*!< last time and value of each channel */
+    int32_t value[SENSOR_LOG_CHANNELS];
+} sensor_log_cursor_t;
+
+/**
+ * @brief Record of the log since sensor_log_open()
+ */
+typedef struct {
+    uint32_t appended;      /*!< samples queued */
+    uint32_t dropped;       /*!< samples refused, the queue was full */
+    uint32_t written;       /*!< samples written to flash */
+    uint32_t bytes;         /*!< bytes written to flash, headers and upload marks included */
+    uint32_t erases;        /*!< sectors erased */
+    uint32_t lost;          /*!< sectors reused before their samples were uploaded */
+} sensor_log_stats_t;
+
+/**
+ * @brief Append-only log of sensor samples in a flash partition
+ *
+ * Sectors fill in order around the partition and the oldest is erased
+ * when the log wraps, so every sector wears at the same rate. Each one
+ * starts with a header holding its sequence number and first timestamp,
+ * which is what seeking by time searches.
+ *
+ * A record is one byte of channel and kind, then either a keyframe (time
+ * and value in full) or the time and value deltas to the channel's
+ * previous sample as varints: 3 to 4 bytes for a slowly moving signal.
+ * The first sample of a channel in a sector is always a keyframe, so each
+ * sector decodes on its own.
+ *
+ * Upload progress is kept in the sector headers by clearing bits, without
+ * an erase, and survives a reboot.
+ *
+ * sensor_log_append() can be called from any task. Everything else must
+ * be called from a single task, which does all the flash access.
+ */
+typedef struct {
+    const esp_partition_t *partition;
+    uint32_t sectors;               /*!< in the partition */
+    uint32_t used;                  /*!< sectors holding data, the newest being writer.seq */
+    sensor_log_cursor_t writer;     /*!< end of the log */
+    sensor_log_cursor_t backlog;    /*!< first sample not uploaded */
+    sensor_log_stats_t stats;
+    /* Private */
+    portMUX_TYPE lock;
+    uint8_t queue_len;
+    sensor_log_sample_t queue[SENSOR_LOG_QUEUE_LEN];
+    uint32_t cache_addr;            /*!< partition offset of cache[0] */
+    uint16_t cache_len;
+    uint8_t cache[64];
+    uint8_t batch[SENSOR_LOG_QUEUE_LEN * SENSOR_LOG_RECORD_MAX]; /*!< records of a flush, encoded */
+} sensor_log_t;
+
+/**
+ * @brief Open the log kept in a partition, creating it if the partition holds none
+ *
+ * A record torn by a power cut ends its sector: writing resumes in the next one.
+ *
+ * @param log: log to set up
+ * @param partition: data partition, a multiple of SENSOR_LOG_SECTOR_SIZE and at least two sectors
+ *
+ * @return
+ *      - ESP_OK: Open
+ *      - ESP_ERR_INVALID_SIZE: The partition is too small
+ *      - others: The partition could not be read
+ */
+esp_err_t sensor_log_open(sensor_log_t *log, const esp_partition_t *partition);
+
+/**
+ * @brief Queue a sample for the next sensor_log_flush(), from any task
+ *
+ * @return
+ *      - ESP_OK: Queued
+ *      - ESP_ERR_INVALID_ARG: No such channel
+ *      - ESP_ERR_NO_MEM: The queue is full, the sample is dropped
+ */
+esp_err_t sensor_log_append(sensor_log_t *log, uint8_t channel, int32_t value, uint32_t time_s);
+
+/**
+ * @brief Write the queued samples to flash, in one write per sector they go to
+ *
+ * @return
+ *      - ESP_OK: The queue is empty
+ *      - others: A flash write or erase failed, the samples not written stay
+ *        queued; some of them may be in the failed write too, and will be
+ *        read twice
+ */
+esp_err_t sensor_log_flush(sensor_log_t *log);
+
+/**
+ * @brief Read samples from a cursor on, moving it past them
+ *
+ * A cursor whose sector was reused since moves to the oldest sample.
+ *
+ * @return Number of samples read, 0 at the end of the log
+ */
+size_t sensor_log_read(sensor_log_t *log, sensor_log_cursor_t *cursor, sensor_log_sample_t *out, size_t max);
+
+/**
+ * @brief Place a cursor on the first sample at or after a time
+ *
+ * Sectors are binary searched by their first timestamp, which assumes the
+ * clock does not go backwards, then one sector is decoded.
+ *
+ * @return
+ *      - ESP_OK: Placed, at the end of the log if every sample is older
+ *      - others: The partition could not be read
+ */
+esp_err_t sensor_log_seek(sensor_log_t *log, uint32_t time_s, sensor_log_cursor_t *cursor);
+
+/**
+ * @brief Place a cursor on the first sample not uploaded yet
+ */
+void sensor_log_backlog(sensor_log_t *log, sensor_log_cursor_t *cursor);
+
+/**
+ * @brief Mark everything before a cursor as uploaded
+ *
+ * The mark in flash is kept to SENSOR_LOG_ACK_CHUNK bytes, so after a
+ * reboot a few samples may come out of the backlog a second time.
+ *
+ * @return
+ *      - ESP_OK: Marked
+ *      - others: The mark could not be written, it is kept in RAM
+ */
+esp_err_t sensor_log_ack(sensor_log_t *log, const sensor_log_cursor_t *cursor);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,56 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include "sensor_rate.h"
+
+uint32_t sensor_rate_update(sensor_rate_t *rate, int32_t value, int64_t now_us)
+{
+    uint32_t min_ms = rate->min_period_ms ? rate->min_period_ms : 1;
+    uint32_t max_ms = rate->max_period_ms > min_ms ? rate->max_period_ms : min_ms;
+    if (!rate->period_ms) {
+        rate->period_ms = min_ms;
+    }
+    if (!rate->primed) {
+        rate->primed = true;
+        rate->last = value;
+        rate->last_us = now_us;
+        return rate->period_ms;
+    }
+
+    int64_t elapsed_ms = (now_us - rate->last_us) / 1000;
+    int64_t moved = llabs((int64_t)value - rate->last);
+    int64_t step = llabs((int64_t)value) * rate->step_pct / 100;
+    if (step < rate->step) {
+        step = rate->step;
+    }
+    if (step < 1) {
+        step = 1;
+    }
+    rate->last = value;
+    rate->last_us = now_us;
+
+    // One step per sample at the speed it moved since the last one; a still value backs off gradually
+    int64_t want_ms = 2 * (int64_t)rate->period_ms;
+    if (moved && elapsed_ms > 0 && elapsed_ms * step / moved < want_ms) {
+        want_ms = elapsed_ms * step / moved;
+    }
+    if (want_ms > max_ms) {
+        want_ms = max_ms;
+    }
+    if (want_ms < min_ms) {
+        want_ms = min_ms;
+    }
+    // Whole multiples: sensors with whole-second bounds keep their sub-second phases apart
+    uint32_t period_ms = (uint32_t)want_ms / min_ms * min_ms;
+    if (period_ms < rate->period_ms) {
+        rate->speedups++;
+    }
+    rate->period_ms = period_ms;
+    return period_ms;
+}
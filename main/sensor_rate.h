@@ -0,0 +1,52 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sampling period of one sensor param, following how fast it moves
+ *
+ * The period aims at the value moving by about one step between samples:
+ * it shortens at once when the value starts to move, and doubles at most
+ * per sample while it holds still. It stays between the bounds, in whole
+ * multiples of min_period_ms. Values are integers in the param's
+ * fixed-point unit, e.g. hundredths.
+ */
+typedef struct {
+    uint32_t min_period_ms;     /*!< fastest sampling, while the value moves */
+    uint32_t max_period_ms;     /*!< slowest sampling, while it holds still */
+    int32_t step;               /*!< change aimed for between samples, in value units */
+    uint8_t step_pct;           /*!< or this percentage of the value, whichever is larger */
+    uint32_t period_ms;         /*!< current period, min_period_ms until it is set */
+    uint32_t speedups;          /*!< times the period got shorter */
+    /* Private */
+    bool primed;                /*!< a sample came in */
+    int32_t last;               /*!< last sample */
+    int64_t last_us;            /*!< when */
+} sensor_rate_t;
+
+/**
+ * @brief Take a sample into account and work out the next period
+ *
+ * @param rate: period of the param
+ * @param value: new sample, as measured: a change the filter has yet to
+ *               confirm is worth sampling faster for
+ * @param now_us: current time, e.g. esp_timer_get_time()
+ *
+ * @return the new period_ms
+ */
+uint32_t sensor_rate_update(sensor_rate_t *rate, int32_t value, int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include "sensor_report.h"
+
+bool sensor_report_check(sensor_report_t *report, int32_t value, int64_t now_us)
+{
+    bool due = !report->reported;
+    if (!due) {
+        int64_t delta = llabs((int64_t)value - report->last);
+        int64_t band = llabs((int64_t)report->last) * report->deadband_pct / 100;
+        if (band < report->deadband) {
+            band = report->deadband;
+        }
+        due = delta >= band ||
+              (report->max_silent_ms && now_us - report->last_us >= (int64_t)report->max_silent_ms * 1000);
+    }
+    if (!due) {
+        report->suppressed++;
+        return false;
+    }
+    report->reported = true;
+    report->last = value;
+    report->last_us = now_us;
+    report->sent++;
+    return true;
+}
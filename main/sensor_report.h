@@ -0,0 +1,49 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Report-on-change filter of one sensor param
+ *
+ * A sample is reported when it moved past the deadband from the value
+ * reported last, or when nothing was reported for max_silent_ms. Values
+ * are integers in the param's fixed-point unit, e.g. hundredths.
+ */
+typedef struct {
+    int32_t deadband;           /*!< change always reported, in value units */
+    uint8_t deadband_pct;       /*!< or this percentage of the last reported value, whichever is larger */
+    uint32_t max_silent_ms;     /*!< longest time without a report, 0 to report changes only */
+    uint32_t sent;              /*!< samples reported */
+    uint32_t suppressed;        /*!< samples within the deadband, not reported */
+    /* Private */
+    bool reported;              /*!< a value was reported */
+    int32_t last;               /*!< last value reported */
+    int64_t last_us;            /*!< when */
+} sensor_report_t;
+
+/**
+ * @brief Decide whether a sample is reported, and count it
+ *
+ * @param report: filter of the param
+ * @param value: new sample
+ * @param now_us: current time, e.g. esp_timer_get_time()
+ *
+ * @return true when the sample is to be reported; it becomes the reference
+ *         for the deadband
+ */
+bool sensor_report_check(sensor_report_t *report, int32_t value, int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
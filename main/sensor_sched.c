@@ -0,0 +1,205 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <esp_log.h>
+#include "sensor_sched.h"
+
+/* The done callbacks filter, report and log the samples on this task */
+#define SENSOR_SCHED_TASK_STACK 4096
+
+static const char *TAG = "sensor_sched";
+
+static sensor_sched_entry_t *s_entries;
+static sensor_sched_entry_t *s_completed;
+static TaskHandle_t s_task;
+/* Guards deadlines, periods, errors, backoff and completions, which other tasks change through the API */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t sensor_sched_add(sensor_sched_entry_t *entry)
+{
+    if (!entry || !entry->sample || !entry->period_ms) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    entry->deadline_us = esp_timer_get_time() + (int64_t)entry->phase_ms * 1000;
+    entry->sampled_us = entry->deadline_us;
+    entry->errors = 0;
+    entry->backoff = 1;
+    memset(&entry->stats, 0, sizeof(entry->stats));
+    // Added before the task starts, the list is not locked
+    entry->next = s_entries;
+    s_entries = entry;
+    return ESP_OK;
+}
+
+void sensor_sched_complete(sensor_sched_entry_t *entry)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool queued = !entry->completed;
+    if (queued) {
+        entry->completed = true;
+        entry->next_completed = s_completed;
+        s_completed = entry;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (queued && s_task) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void sensor_sched_process(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    sensor_sched_entry_t *entry = s_completed;
+    s_completed = NULL;
+    for (sensor_sched_entry_t *e = entry; e; e = e->next_completed) {
+        e->completed = false;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    while (entry) {
+        sensor_sched_entry_t *next = entry->next_completed;
+        entry->done(entry);
+        entry = next;
+    }
+}
+
+int64_t sensor_sched_step(void)
+{
+    // Finished samples first: a result may pick the range of the next sample
+    sensor_sched_process();
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_us = INT64_MAX;
+    for (sensor_sched_entry_t *entry = s_entries; entry; entry = entry->next) {
+        portENTER_CRITICAL(&s_lock);
+        int64_t late_us = now_us - entry->deadline_us;
+        bool due = late_us >= 0;
+        if (due) {
+            int64_t step_us = (int64_t)entry->period_ms * 1000 * entry->backoff;
+            // Next deadline on the grid, not from now: lateness does not add up
+            entry->sampled_us = entry->deadline_us;
+            entry->deadline_us += step_us;
+            if (entry->deadline_us <= now_us) {
+                int64_t missed = (now_us - entry->deadline_us) / step_us + 1;
+                entry->deadline_us += missed * step_us;
+                entry->stats.skipped += missed;
+            }
+        }
+        int64_t deadline_us = entry->deadline_us;
+        portEXIT_CRITICAL(&s_lock);
+
+        if (due) {
+            if (late_us > entry->stats.max_late_us) {
+                entry->stats.max_late_us = late_us > UINT32_MAX ? UINT32_MAX : late_us;
+            }
+            entry->stats.samples++;
+            entry->sample(entry);
+        }
+        if (deadline_us < next_us) {
+            next_us = deadline_us;
+        }
+    }
+    if (next_us == INT64_MAX) {
+        return -1;
+    }
+    now_us = esp_timer_get_time();
+    return next_us > now_us ? next_us - now_us : 0;
+}
+
+void sensor_sched_set_period(sensor_sched_entry_t *entry, uint32_t period_ms)
+{
+    if (!period_ms) {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    entry->period_ms = period_ms;
+    int64_t step_us = (int64_t)period_ms * 1000 * entry->backoff;
+    int64_t due_us = entry->sampled_us + step_us;
+    // Overdue already: the first deadline from now on the new grid, not deadlines missed
+    if (due_us < now_us) {
+        due_us += (now_us - due_us + step_us - 1) / step_us * step_us;
+    }
+    bool sooner = due_us < entry->deadline_us;
+    if (sooner) {
+        entry->deadline_us = due_us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    // The task sleeps until the old deadline otherwise
+    if (sooner && s_task) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void sensor_sched_report(sensor_sched_entry_t *entry, esp_err_t result)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint8_t backoff = entry->backoff;
+    bool exhausted = false;
+    if (result == ESP_OK) {
+        entry->errors = 0;
+        entry->backoff = 1;
+    } else {
+        entry->stats.failures++;
+        if (++entry->errors > entry->error_budget) {
+            entry->errors = 0;
+            entry->stats.backoffs++;
+            if (entry->backoff < SENSOR_SCHED_MAX_BACKOFF) {
+                entry->backoff *= 2;
+            }
+            exhausted = true;
+        }
+    }
+    uint8_t new_backoff = entry->backoff;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (exhausted) {
+        ESP_LOGW(TAG, "%s: %u failed samples in a row, sampling every %u ms", entry->name,
+                 (unsigned)entry->error_budget + 1, (unsigned)(entry->period_ms * new_backoff));
+    } else if (result == ESP_OK && backoff > 1) {
+        ESP_LOGI(TAG, "%s: recovered, sampling every %u ms", entry->name, (unsigned)entry->period_ms);
+    }
+}
+
+sensor_sched_entry_t *sensor_sched_find(const char *name)
+{
+    for (sensor_sched_entry_t *entry = s_entries; entry; entry = entry->next) {
+        if (!strcmp(entry->name, name)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void sensor_sched_task(void *arg)
+{
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+    while (1) {
+        int64_t wait_us = sensor_sched_step();
+        // Rounded up: a sample starts at most one tick late, never early. A shorter period wakes it sooner
+        TickType_t ticks = wait_us < 0 ? portMAX_DELAY : (wait_us + tick_us - 1) / tick_us;
+        ulTaskNotifyTake(pdTRUE, ticks ? ticks : 1);
+    }
+}
+
+esp_err_t sensor_sched_start(UBaseType_t priority)
+{
+    if (s_task) {
+        return ESP_OK;
+    }
+    if (xTaskCreate(sensor_sched_task, "sensor_sched", SENSOR_SCHED_TASK_STACK, NULL, priority, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Could not create the scheduler task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,159 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_SCHED_MAX_BACKOFF 8 /*!< longest period stretch of a failing sensor */
+
+/**
+ * @brief Sampling record of one sensor
+ */
+typedef struct {
+    uint32_t samples;       /*!< samples started */
+    uint32_t failures;      /*!< samples reported failed */
+    uint32_t skipped;       /*!< deadlines dropped because the scheduler was late by whole periods */
+    uint32_t backoffs;      /*!< times the error budget ran out */
+    uint32_t max_late_us;   /*!< worst delay between a deadline and its sample */
+} sensor_sched_stats_t;
+
+struct sensor_sched_entry;
+
+/**
+ * @brief Starts one sample of a sensor, called from the scheduler task
+ *
+ * It must not wait on the sensor: queue the bus transactions, and hand
+ * their outcome back with sensor_sched_complete() when they are done.
+ */
+typedef void (*sensor_sched_sample_t)(struct sensor_sched_entry *entry);
+
+/**
+ * @brief Finishes a sample on the scheduler task, once sensor_sched_complete() was called
+ *
+ * Converts, filters and reports what was read, then reports the outcome
+ * with sensor_sched_report(). It may talk to the sensor, e.g. to change
+ * its range: the bus task is free.
+ */
+typedef void (*sensor_sched_done_t)(struct sensor_sched_entry *entry);
+
+/**
+ * @brief A sensor sampled by the scheduler
+ *
+ * Deadlines are kept on a fixed grid, phase_ms + k * period_ms after
+ * sensor_sched_add(), so a late sample does not delay the following ones.
+ * Give sensors different phases to keep their samples apart.
+ *
+ * A sensor that fails more than error_budget samples in a row is sampled
+ * less often, its period doubling up to SENSOR_SCHED_MAX_BACKOFF times,
+ * until a sample succeeds again.
+ *
+ * The period may change at runtime with sensor_sched_set_period(), e.g. to
+ * follow how fast the signal moves.
+ */
+typedef struct sensor_sched_entry {
+    const char *name;               /*!< for logs and sensor_sched_find() */
+    sensor_sched_sample_t sample;   /*!< starts a sample */
+    sensor_sched_done_t done;       /*!< finishes it, NULL if the sample reports by itself */
+    void *arg;                      /*!< user argument */
+    uint32_t period_ms;             /*!< sampling period, see sensor_sched_set_period() to change it later */
+    uint32_t phase_ms;              /*!< first sample this long after sensor_sched_add() */
+    uint8_t error_budget;           /*!< failed samples in a row tolerated before backing off */
+    /* Private */
+    int64_t deadline_us;            /*!< next sample due */
+    int64_t sampled_us;             /*!< deadline of the last sample */
+    uint8_t errors;                 /*!< failed samples in a row */
+    uint8_t backoff;                /*!< period multiplier, 1 while the sensor is healthy */
+    bool completed;                 /*!< done is pending */
+    sensor_sched_stats_t stats;
+    struct sensor_sched_entry *next;
+    struct sensor_sched_entry *next_completed;
+} sensor_sched_entry_t;
+
+/**
+ * @brief Add a sensor to the scheduler
+ *
+ * @param entry: sensor with name, sample and period_ms set; must stay valid
+ *
+ * @return
+ *      - ESP_OK: Added, the first sample is due phase_ms from now
+ *      - ESP_ERR_INVALID_ARG: Missing sample callback or zero period
+ */
+esp_err_t sensor_sched_add(sensor_sched_entry_t *entry);
+
+/**
+ * @brief Start the scheduler task
+ *
+ * @param priority: task priority
+ *
+ * @return
+ *      - ESP_OK: Running, or already running
+ *      - ESP_FAIL: The task could not be created
+ */
+esp_err_t sensor_sched_start(UBaseType_t priority);
+
+/**
+ * @brief Start every sample that is due, in the calling context
+ *
+ * This is the body of the scheduler task.
+ *
+ * @return Microseconds until the next deadline, -1 if no sensor was added
+ */
+int64_t sensor_sched_step(void);
+
+/**
+ * @brief Change the sampling period of a sensor, from any task
+ *
+ * A shorter period counts from the last sample: the next one is moved in,
+ * waking the scheduler task if needed. A longer one applies after the
+ * next sample.
+ *
+ * @param entry: sensor added with sensor_sched_add()
+ * @param period_ms: new period, 0 is ignored
+ */
+void sensor_sched_set_period(sensor_sched_entry_t *entry, uint32_t period_ms);
+
+/**
+ * @brief Hand a sample over to the scheduler task, from any task
+ *
+ * Keeps bus callbacks short: the entry's done callback runs next on the
+ * scheduler task. The entry need not be added to the scheduler, e.g. a
+ * sensor read along with another one.
+ *
+ * @param entry: sensor whose bus transactions are over, with done set
+ */
+void sensor_sched_complete(sensor_sched_entry_t *entry);
+
+/**
+ * @brief Run the done callbacks of the completed samples, in the calling context
+ *
+ * sensor_sched_step() starts with this.
+ */
+void sensor_sched_process(void);
+
+/**
+ * @brief Report the outcome of a sample, from any task
+ *
+ * @param entry: sensor the sample belongs to
+ * @param result: ESP_OK, or why the sample failed
+ */
+void sensor_sched_report(sensor_sched_entry_t *entry, esp_err_t result);
+
+/**
+ * @brief Look a sensor up by name, NULL if there is none
+ */
+sensor_sched_entry_t *sensor_sched_find(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
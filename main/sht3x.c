@@ -28,6 +28,7 @@ const char *TAG = "SHT3x";
 #define SHT3X_FETCH_DATA_CMD           0xE000
 #define SHT3X_HEATER_ON_CMD            0x306D
 #define SHT3X_HEATER_OFF_CMD           0x3066
+#define SHT3X_BREAK_CMD                0x3093
 
 static const uint16_t SHT3X_MEASURE_CMD[6][3] = {
         {0x2400, 0x240b, 0x2416}, // [SINGLE_SHOT][H,M,L] without clock stretching
@@ -47,13 +48,16 @@ static const uint16_t SHT3X_MEASURE_CMD[6][3] = {
 #define SHT3X_MEAS_DURATION_REP_MEDIUM 6
 #define SHT3X_MEAS_DURATION_REP_LOW    4
 
-// measurement durations in us
+// measurement durations in us, the datasheet maximum (typical + 0.5 ms) so a timer never fetches early
 static const uint16_t SHT3X_MEAS_DURATION_US[3] = {
-        SHT3X_MEAS_DURATION_REP_HIGH   * 1000,
-        SHT3X_MEAS_DURATION_REP_MEDIUM * 1000,
-        SHT3X_MEAS_DURATION_REP_LOW    * 1000
+        SHT3X_MEAS_DURATION_REP_HIGH   * 1000 + 500,
+        SHT3X_MEAS_DURATION_REP_MEDIUM * 1000 + 500,
+        SHT3X_MEAS_DURATION_REP_LOW    * 1000 + 500
 };
 
+// periodic mode: the first result is out a whole period after the start, [mode]
+static const uint32_t SHT3X_PERIOD_US[6] = { 0, 2000000, 1000000, 500000, 250000, 100000 };
+
 // measurement durations in RTOS ticks
 static const uint8_t SHT3X_MEAS_DURATION_TICKS[3] = {
         TIME_TO_TICKS(SHT3X_MEAS_DURATION_REP_HIGH),
@@ -64,24 +68,34 @@ static const uint8_t SHT3X_MEAS_DURATION_TICKS[3] = {
 #define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
 #define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
 
-#define G_POLYNOM 0x31
+// CRC-8, polynomial 0x31 (x^8 + x^5 + x^4 + 1), one lookup per byte
+static const uint8_t CRC8_TABLE[256] = {
+        0x00, 0x31, 0x62, 0x53, 0xc4, 0xf5, 0xa6, 0x97, 0xb9, 0x88, 0xdb, 0xea, 0x7d, 0x4c, 0x1f, 0x2e,
+        0x43, 0x72, 0x21, 0x10, 0x87, 0xb6, 0xe5, 0xd4, 0xfa, 0xcb, 0x98, 0xa9, 0x3e, 0x0f, 0x5c, 0x6d,
+        0x86, 0xb7, 0xe4, 0xd5, 0x42, 0x73, 0x20, 0x11, 0x3f, 0x0e, 0x5d, 0x6c, 0xfb, 0xca, 0x99, 0xa8,
+        0xc5, 0xf4, 0xa7, 0x96, 0x01, 0x30, 0x63, 0x52, 0x7c, 0x4d, 0x1e, 0x2f, 0xb8, 0x89, 0xda, 0xeb,
+        0x3d, 0x0c, 0x5f, 0x6e, 0xf9, 0xc8, 0x9b, 0xaa, 0x84, 0xb5, 0xe6, 0xd7, 0x40, 0x71, 0x22, 0x13,
+        0x7e, 0x4f, 0x1c, 0x2d, 0xba, 0x8b, 0xd8, 0xe9, 0xc7, 0xf6, 0xa5, 0x94, 0x03, 0x32, 0x61, 0x50,
+        0xbb, 0x8a, 0xd9, 0xe8, 0x7f, 0x4e, 0x1d, 0x2c, 0x02, 0x33, 0x60, 0x51, 0xc6, 0xf7, 0xa4, 0x95,
+        0xf8, 0xc9, 0x9a, 0xab, 0x3c, 0x0d, 0x5e, 0x6f, 0x41, 0x70, 0x23, 0x12, 0x85, 0xb4, 0xe7, 0xd6,
+        0x7a, 0x4b, 0x18, 0x29, 0xbe, 0x8f, 0xdc, 0xed, 0xc3, 0xf2, 0xa1, 0x90, 0x07, 0x36, 0x65, 0x54,
+        0x39, 0x08, 0x5b, 0x6a, 0xfd, 0xcc, 0x9f, 0xae, 0x80, 0xb1, 0xe2, 0xd3, 0x44, 0x75, 0x26, 0x17,
+        0xfc, 0xcd, 0x9e, 0xaf, 0x38, 0x09, 0x5a, 0x6b, 0x45, 0x74, 0x27, 0x16, 0x81, 0xb0, 0xe3, 0xd2,
+        0xbf, 0x8e, 0xdd, 0xec, 0x7b, 0x4a, 0x19, 0x28, 0x06, 0x37, 0x64, 0x55, 0xc2, 0xf3, 0xa0, 0x91,
+        0x47, 0x76, 0x25, 0x14, 0x83, 0xb2, 0xe1, 0xd0, 0xfe, 0xcf, 0x9c, 0xad, 0x3a, 0x0b, 0x58, 0x69,
+        0x04, 0x35, 0x66, 0x57, 0xc0, 0xf1, 0xa2, 0x93, 0xbd, 0x8c, 0xdf, 0xee, 0x79, 0x48, 0x1b, 0x2a,
+        0xc1, 0xf0, 0xa3, 0x92, 0x05, 0x34, 0x67, 0x56, 0x78, 0x49, 0x1a, 0x2b, 0xbc, 0x8d, 0xde, 0xef,
+        0x82, 0xb3, 0xe0, 0xd1, 0x46, 0x77, 0x24, 0x15, 0x3b, 0x0a, 0x59, 0x68, 0xff, 0xce, 0x9d, 0xac,
+};
 
-static uint8_t crc8(uint8_t data[], int len)
+static uint8_t crc8(const uint8_t data[], int len)
 {
     // initialization value
     uint8_t crc = 0xff;
 
-    // iterate over all bytes
     for (int i = 0; i < len; i++)
-    {
-        crc ^= data[i];
-        for (int i = 0; i < 8; i++)
-        {
-            bool xor = crc & 0x80;
-            crc = crc << 1;
-            crc = xor ? crc ^ G_POLYNOM : crc;
-        }
-    }
+        crc = CRC8_TABLE[crc ^ data[i]];
+
     return crc;
 }
 
@@ -132,17 +146,26 @@ static inline esp_err_t sht3x_reset(sht3x_t *dev)
     return ESP_OK;
 }
 
-static inline bool sht3x_is_measuring(sht3x_t *dev)
+static uint32_t sht3x_time_to_result_us(sht3x_t *dev)
 {
-    // not running if measurement is not started at all or
+    // nothing to wait for if measurement is not started at all or
     // it is not the first measurement in periodic mode
     if (!dev->meas_started || !dev->meas_first)
-      return false;
+      return 0;
+
+    uint32_t duration = SHT3X_MEAS_DURATION_US[dev->repeatability];
+    if (SHT3X_PERIOD_US[dev->mode] > duration)
+      duration = SHT3X_PERIOD_US[dev->mode];
 
-    // not running if time elapsed is greater than duration
+    // nothing to wait for if time elapsed is greater than duration
     uint64_t elapsed = esp_timer_get_time() - dev->meas_start_time;
 
-    return elapsed < SHT3X_MEAS_DURATION_US[dev->repeatability];
+    return elapsed < duration ? duration - elapsed : 0;
+}
+
+static inline bool sht3x_is_measuring(sht3x_t *dev)
+{
+    return sht3x_time_to_result_us(dev) > 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -207,12 +230,24 @@ uint8_t sht3x_get_measurement_duration(sht3x_repeat_t repeat)
     return SHT3X_MEAS_DURATION_TICKS[repeat];  // in RTOS ticks
 }
 
+uint32_t sht3x_get_measurement_duration_us(sht3x_repeat_t repeat)
+{
+    return SHT3X_MEAS_DURATION_US[repeat];
+}
+
+uint32_t sht3x_get_result_wait_us(sht3x_t *dev)
+{
+    return dev ? sht3x_time_to_result_us(dev) : 0;
+}
+
 esp_err_t sht3x_start_measurement(sht3x_t *dev, sht3x_mode_t mode, sht3x_repeat_t repeat)
 {
     CHECK_ARG(dev);
 
     CHECK(sht3x_send_command(dev, SHT3X_MEASURE_CMD[mode][repeat]));
 
+    dev->mode = mode;
+    dev->repeatability = repeat;
     dev->meas_start_time = esp_timer_get_time();
     dev->meas_started = true;
     dev->meas_first = true;
@@ -220,10 +255,65 @@ esp_err_t sht3x_start_measurement(sht3x_t *dev, sht3x_mode_t mode, sht3x_repeat_
     return ESP_OK;
 }
 
-esp_err_t sht3x_get_raw_data(sht3x_t *dev, sht3x_raw_data_t raw_data)
+esp_err_t sht3x_stop_periodic_measurement(sht3x_t *dev)
 {
-    CHECK_ARG(dev && raw_data);
+    CHECK_ARG(dev);
+
+    CHECK(sht3x_send_command(dev, SHT3X_BREAK_CMD));
+    dev->mode = SHT3X_SINGLE_SHOT;
+    dev->meas_started = false;
+    dev->meas_first = false;
+    // the sensor takes up to 1 ms to leave periodic mode
+    vTaskDelay(TIME_TO_TICKS(1));
 
+    return ESP_OK;
+}
+
+esp_err_t sht3x_set_repeatability(sht3x_t *dev, sht3x_repeat_t repeat)
+{
+    CHECK_ARG(dev);
+
+    if (dev->mode == SHT3X_SINGLE_SHOT || !dev->meas_started)
+    {
+        // applies to the next measurement started
+        dev->repeatability = repeat;
+        return ESP_OK;
+    }
+    if (dev->repeatability == repeat)
+        return ESP_OK;
+
+    sht3x_mode_t mode = dev->mode;
+    CHECK(sht3x_stop_periodic_measurement(dev));
+    return sht3x_start_measurement(dev, mode, repeat);
+}
+
+esp_err_t sht3x_start_measurement_async(sht3x_t *dev, i2c_dev_request_t *req, sht3x_mode_t mode, sht3x_repeat_t repeat)
+{
+    CHECK_ARG(dev && req);
+
+    uint16_t cmd = SHT3X_MEASURE_CMD[mode][repeat];
+    dev->cmd[0] = cmd >> 8;
+    dev->cmd[1] = cmd & 0xff;
+    req->dev = &dev->i2c_dev;
+    req->write = true;
+    req->out_data = NULL;
+    req->out_size = 0;
+    req->data = dev->cmd;
+    req->size = sizeof(dev->cmd);
+    CHECK(i2c_dev_submit(req));
+
+    // The measurement starts a little later, when the bus task sends the command
+    dev->mode = mode;
+    dev->repeatability = repeat;
+    dev->meas_start_time = esp_timer_get_time();
+    dev->meas_started = true;
+    dev->meas_first = true;
+
+    return ESP_OK;
+}
+
+static esp_err_t sht3x_check_fetch(sht3x_t *dev)
+{
     if (!dev->meas_started)
     {
         ESP_LOGE(TAG, "Measurement is not started");
@@ -236,9 +326,43 @@ esp_err_t sht3x_get_raw_data(sht3x_t *dev, sht3x_raw_data_t raw_data)
         return ESP_ERR_INVALID_STATE;
     }
 
+    return ESP_OK;
+}
+
+esp_err_t sht3x_get_raw_data(sht3x_t *dev, sht3x_raw_data_t raw_data)
+{
+    CHECK_ARG(dev && raw_data);
+
+    CHECK(sht3x_check_fetch(dev));
+
     // read raw data
     CHECK(sht3x_read_data(dev, SHT3X_FETCH_DATA_CMD, raw_data, sizeof(sht3x_raw_data_t)));
 
+    return sht3x_check_raw_data(dev, raw_data);
+}
+
+esp_err_t sht3x_get_raw_data_async(sht3x_t *dev, i2c_dev_request_t *req, sht3x_raw_data_t raw_data)
+{
+    CHECK_ARG(dev && req && raw_data);
+
+    CHECK(sht3x_check_fetch(dev));
+
+    dev->cmd[0] = SHT3X_FETCH_DATA_CMD >> 8;
+    dev->cmd[1] = SHT3X_FETCH_DATA_CMD & 0xff;
+    req->dev = &dev->i2c_dev;
+    req->write = false;
+    req->out_data = dev->cmd;
+    req->out_size = sizeof(dev->cmd);
+    req->data = raw_data;
+    req->size = sizeof(sht3x_raw_data_t);
+
+    return i2c_dev_submit(req);
+}
+
+esp_err_t sht3x_check_raw_data(sht3x_t *dev, sht3x_raw_data_t raw_data)
+{
+    CHECK_ARG(dev && raw_data);
+
     // reset first measurement flag
     dev->meas_first = false;
 
@@ -263,16 +387,35 @@ esp_err_t sht3x_get_raw_data(sht3x_t *dev, sht3x_raw_data_t raw_data)
     return ESP_OK;
 }
 
+esp_err_t sht3x_compute_values_centi(sht3x_raw_data_t raw_data, int16_t *temperature, int16_t *humidity)
+{
+    CHECK_ARG(raw_data);
+    CHECK_ARG(temperature || humidity);
+
+    // T = -45 + 175 * S / 65535 and RH = 100 * S / 65535, scaled by 100 and
+    // rounded to nearest; the products stay below 2^31
+    if (temperature)
+        *temperature = (int16_t)((((raw_data[0] << 8) | raw_data[1]) * 17500 + 32767) / 65535) - 4500;
+
+    if (humidity)
+        *humidity = (int16_t)((((raw_data[3] << 8) | raw_data[4]) * 10000 + 32767) / 65535);
+
+    return ESP_OK;
+}
+
 esp_err_t sht3x_compute_values(sht3x_raw_data_t raw_data, float *temperature, float *humidity)
 {
     CHECK_ARG(raw_data);
     CHECK_ARG(temperature || humidity);
 
+    int16_t t, h;
+    sht3x_compute_values_centi(raw_data, &t, &h);
+
     if (temperature)
-        *temperature = ((((raw_data[0] * 256.0) + raw_data[1]) * 175) / 65535.0) - 45;
+        *temperature = t / 100.0f;
 
     if (humidity)
-        *humidity = ((((raw_data[3] * 256.0) + raw_data[4]) * 100) / 65535.0);
+        *humidity = h / 100.0f;
 
     return ESP_OK;
 }
@@ -66,6 +66,8 @@ typedef struct
     bool meas_started;            //!< indicates whether measurement started
     uint64_t meas_start_time;     //!< measurement start time in us
     bool meas_first;              //!< first measurement in periodic mode
+
+    uint8_t cmd[2];               //!< command sent by the pending asynchronous request
 } sht3x_t;
 
 /**
@@ -146,6 +148,25 @@ esp_err_t sht3x_measure(sht3x_t *dev, float *temperature, float *humidity);
  */
 uint8_t sht3x_get_measurement_duration(sht3x_repeat_t repeat);
 
+/**
+ * @brief Get the duration of a measurement in microseconds
+ * Same as *sht3x_get_measurement_duration*, for waiting with a timer
+ * rather than with *vTaskDelay*.
+ * @param repeat    Repeatability, see type *sht3x_repeat_t*
+ * @return          Measurement duration in us
+ */
+uint32_t sht3x_get_measurement_duration_us(sht3x_repeat_t repeat);
+
+/**
+ * @brief Time until the first result of the started measurement can be fetched
+ * In single shot mode this is the rest of the measurement duration. In
+ * periodic mode the first result takes a whole period, e.g. 2 s at 0.5 mps;
+ * later results can be fetched any time.
+ * @param dev       Device descriptor
+ * @return          Time left in us, 0 if the results can be fetched now
+ */
+uint32_t sht3x_get_result_wait_us(sht3x_t *dev);
+
 /**
  * @brief Start the measurement in single shot or periodic mode
  *
@@ -174,6 +195,27 @@ uint8_t sht3x_get_measurement_duration(sht3x_repeat_t repeat);
  */
 esp_err_t sht3x_start_measurement(sht3x_t *dev, sht3x_mode_t mode, sht3x_repeat_t repeat);
 
+/**
+ * @brief Stop periodic measurements
+ * Sends the break command; the sensor is back in single shot mode when
+ * the function returns.
+ * @param dev       Device descriptor
+ * @return          `ESP_OK` on success
+ */
+esp_err_t sht3x_stop_periodic_measurement(sht3x_t *dev);
+
+/**
+ * @brief Change the repeatability
+ * Higher repeatability means less noise but longer conversions, i.e. more
+ * power. In periodic mode the measurement is stopped and restarted with
+ * the new repeatability, and the first result is available after the
+ * measurement duration again. Otherwise it applies to the next measurement.
+ * @param dev       Device descriptor
+ * @param repeat    Repeatability, see type *sht3x_repeat_t*
+ * @return          `ESP_OK` on success
+ */
+esp_err_t sht3x_set_repeatability(sht3x_t *dev, sht3x_repeat_t repeat);
+
 /**
  * @brief Read measurement results from sensor as raw data
  *
@@ -195,9 +237,58 @@ esp_err_t sht3x_start_measurement(sht3x_t *dev, sht3x_mode_t mode, sht3x_repeat_
  */
 esp_err_t sht3x_get_raw_data(sht3x_t *dev, sht3x_raw_data_t raw_data);
 
+/**
+ * @brief Check raw data fetched without *sht3x_get_raw_data*
+ * Verifies the CRC checksums and updates the measurement state, as
+ * *sht3x_get_raw_data* does after its read.
+ * @param dev       Device descriptor
+ * @param raw_data  Byte array read from the sensor
+ * @return          `ESP_OK` on success
+ */
+esp_err_t sht3x_check_raw_data(sht3x_t *dev, sht3x_raw_data_t raw_data);
+
+/**
+ * @brief Start the measurement on the I2C bus task
+ * Asynchronous *sht3x_start_measurement*: fills `req` and submits it, the
+ * caller sets `callback` and `arg` beforehand. Wait for the measurement
+ * duration after the request is done, then fetch the results with
+ * *sht3x_get_raw_data_async*.
+ * @param dev       Device descriptor, holds the command until the request is done
+ * @param req       Request, see *i2c_dev_submit*
+ * @param mode      Measurement mode, see type *sht3x_mode_t*
+ * @param repeat    Repeatability, see type *sht3x_repeat_t*
+ * @return          `ESP_OK` when submitted
+ */
+esp_err_t sht3x_start_measurement_async(sht3x_t *dev, i2c_dev_request_t *req, sht3x_mode_t mode, sht3x_repeat_t repeat);
+
+/**
+ * @brief Read measurement results on the I2C bus task
+ * Asynchronous *sht3x_get_raw_data*: fills `req` and submits it. Pass
+ * `raw_data` to *sht3x_check_raw_data* once the request is done.
+ * @param dev       Device descriptor, holds the command until the request is done
+ * @param req       Request, see *i2c_dev_submit*
+ * @param raw_data  Byte array the raw data are read into
+ * @return          `ESP_OK` when submitted
+ */
+esp_err_t sht3x_get_raw_data_async(sht3x_t *dev, i2c_dev_request_t *req, sht3x_raw_data_t raw_data);
+
+/**
+ * @brief Computes sensor values from raw data in hundredths
+ *
+ * Integer only, rounded to the nearest hundredth.
+ *
+ * @param raw_data    Byte array that contains raw data
+ * @param temperature Temperature in hundredths of a degree Celsius
+ * @param humidity    Humidity in hundredths of a percent
+ * @return            `ESP_OK` on success
+ */
+esp_err_t sht3x_compute_values_centi(sht3x_raw_data_t raw_data, int16_t *temperature, int16_t *humidity);
+
 /**
  * @brief Computes sensor values from raw data
  *
+ * Wraps *sht3x_compute_values_centi*, the results have a resolution of 0.01.
+ *
  * @param raw_data    Byte array that contains raw data
  * @param temperature Temperature in degree Celsius
  * @param humidity    Humidity in percent